@@ -0,0 +1,68 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "tkc/mem.h"
+#include "tkc/time_now.h"
+#include "bench_common.h"
+
+uint64_t bench_now_us(void) {
+  return time_now_us();
+}
+
+void bench_report(const char* bench, const char* variant, uint64_t ops, uint64_t elapsed_us) {
+  double secs = elapsed_us > 0 ? elapsed_us / 1000000.0 : 0.000001;
+
+  printf("{\"bench\":\"%s\",\"variant\":\"%s\",\"ops\":%llu,\"us\":%llu,\"ops_per_sec\":%.1f,"
+         "\"ns_per_op\":%.2f}\n",
+         bench, variant, (unsigned long long)ops, (unsigned long long)elapsed_us, ops / secs,
+         ops > 0 ? (elapsed_us * 1000.0) / ops : 0.0);
+  fflush(stdout);
+}
+
+void bench_report_metric(const char* bench, const char* variant, const char* metric, double value) {
+  printf("{\"bench\":\"%s\",\"variant\":\"%s\",\"metric\":\"%s\",\"value\":%.3f}\n", bench,
+         variant, metric, value);
+  fflush(stdout);
+}
+
+ret_t bench_latency_init(bench_latency_t* lat, uint32_t capacity) {
+  lat->size = 0;
+  lat->capacity = capacity;
+  lat->samples_us = TKMEM_ZALLOCN(uint32_t, capacity > 0 ? capacity : 1);
+
+  return lat->samples_us != NULL ? RET_OK : RET_OOM;
+}
+
+void bench_latency_add(bench_latency_t* lat, uint64_t us) {
+  if (lat->size < lat->capacity) {
+    lat->samples_us[lat->size++] = (uint32_t)us;
+  }
+}
+
+static int bench_latency_cmp(const void* a, const void* b) {
+  uint32_t x = *(const uint32_t*)a;
+  uint32_t y = *(const uint32_t*)b;
+
+  return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static uint32_t bench_latency_at(bench_latency_t* lat, uint32_t pct) {
+  uint32_t i = (uint32_t)(((uint64_t)lat->size * pct) / 100);
+
+  return lat->size > 0 ? lat->samples_us[i < lat->size ? i : lat->size - 1] : 0;
+}
+
+void bench_latency_report(bench_latency_t* lat, const char* bench, const char* variant) {
+  qsort(lat->samples_us, lat->size, sizeof(uint32_t), bench_latency_cmp);
+
+  printf("{\"bench\":\"%s\",\"variant\":\"%s\",\"samples\":%u,\"p50_us\":%u,\"p90_us\":%u,"
+         "\"p99_us\":%u,\"max_us\":%u}\n",
+         bench, variant, lat->size, bench_latency_at(lat, 50), bench_latency_at(lat, 90),
+         bench_latency_at(lat, 99), bench_latency_at(lat, 100));
+  fflush(stdout);
+}
+
+void bench_latency_deinit(bench_latency_t* lat) {
+  TKMEM_FREE(lat->samples_us);
+  lat->size = 0;
+  lat->capacity = 0;
+}
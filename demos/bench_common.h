@@ -0,0 +1,42 @@
+#ifndef TK_SQLITE3_BENCH_COMMON_H
+#define TK_SQLITE3_BENCH_COMMON_H
+
+#include "tkc/types_def.h"
+
+BEGIN_C_DECLS
+
+/*
+ * benchmark helpers shared by the bench_* programs.
+ *
+ * every result is printed as one JSON object per line on stdout, so the
+ * output of several programs can be concatenated and parsed by scripts.
+ */
+
+uint64_t bench_now_us(void);
+
+/* print {"bench":..,"variant":..,"ops":..,"us":..,"ops_per_sec":..,"ns_per_op":..} */
+void bench_report(const char* bench, const char* variant, uint64_t ops, uint64_t elapsed_us);
+
+/* print {"bench":..,"variant":..,"metric":..,"value":..} for non-throughput results */
+void bench_report_metric(const char* bench, const char* variant, const char* metric, double value);
+
+/* per-operation latencies of one benchmark step, reported as percentiles */
+typedef struct _bench_latency_t {
+  uint32_t* samples_us;
+  uint32_t size;
+  uint32_t capacity;
+} bench_latency_t;
+
+ret_t bench_latency_init(bench_latency_t* lat, uint32_t capacity);
+void bench_latency_add(bench_latency_t* lat, uint64_t us);
+
+/* print {"bench":..,"variant":..,"samples":..,"p50_us":..,"p90_us":..,"p99_us":..,"max_us":..} */
+void bench_latency_report(bench_latency_t* lat, const char* bench, const char* variant);
+void bench_latency_deinit(bench_latency_t* lat);
+
+/* the "posix" reference VFS of bench_posix_vfs.c, SQLITE_NOTFOUND where it is not available */
+int bench_posix_vfs_register(void);
+
+END_C_DECLS
+
+#endif /*TK_SQLITE3_BENCH_COMMON_H*/
@@ -0,0 +1,315 @@
+#include "sqlite3.h"
+#include "tkc/mem.h"
+#include "tkc/utils.h"
+#include "tkc/thread.h"
+#include "tkc/platform.h"
+#include "bench_common.h"
+
+/*
+ * N reader and M writer threads on one database for a fixed time. Readers
+ * sum a range of rows, writers update a row and append to a log table in
+ * a BEGIN IMMEDIATE transaction. SQLITE_BUSY is counted and the operation
+ * retried; the latency of an operation includes its retries.
+ *
+ *   bench_concurrency [db]                    run the built-in scenarios
+ *   bench_concurrency db name readers writers ms journal_mode busy_ms shared [vfs]
+ *
+ * shared=1 makes every thread use one serialized connection instead of one
+ * connection per thread; writers then share its transaction, so give it a
+ * single writer. Connections on the awtk VFS share one lock per database
+ * path, and every lock at or above SHARED is exclusive there, so readers on
+ * their own connections wait for each other as well as for the writers.
+ */
+#define BENCH_CONCURRENCY_ROWS 10000
+#define BENCH_CONCURRENCY_MAX_THREADS 32
+#define BENCH_CONCURRENCY_MAX_RETRIES 1000
+#define BENCH_CONCURRENCY_SAMPLES 100000
+
+typedef struct _concurrency_scenario_t {
+  const char* name;
+  uint32_t readers;
+  uint32_t writers;
+  uint32_t duration_ms;
+  const char* journal_mode;
+  uint32_t busy_ms;
+  bool_t shared;
+} concurrency_scenario_t;
+
+static const concurrency_scenario_t s_scenarios[] = {
+    {"delete_busy0", 4, 1, 2000, "DELETE", 0, FALSE},
+    {"delete_busy100", 4, 1, 2000, "DELETE", 100, FALSE},
+    {"truncate_busy100", 4, 1, 2000, "TRUNCATE", 100, FALSE},
+    {"persist_busy100", 4, 1, 2000, "PERSIST", 100, FALSE},
+    {"delete_busy100_w4", 4, 4, 2000, "DELETE", 100, FALSE},
+    {"delete_shared_conn", 4, 1, 2000, "DELETE", 100, TRUE},
+};
+
+typedef struct _concurrency_ctx_t {
+  const concurrency_scenario_t* scenario;
+  const char* path;
+  const char* vfs;
+  sqlite3* shared_db;
+  bool_t writer;
+  uint32_t seed;
+  uint64_t end_us;
+  uint64_t ops;
+  uint64_t busy;
+  uint64_t retries;
+  uint64_t errors;
+  bench_latency_t lat;
+} concurrency_ctx_t;
+
+static uint32_t concurrency_rand(uint32_t* seed) {
+  *seed = *seed * 1103515245 + 12345;
+  return (*seed >> 8) & 0xffffff;
+}
+
+/* step a statement to completion, retrying on SQLITE_BUSY */
+static int concurrency_step(concurrency_ctx_t* ctx, sqlite3_stmt* stmt) {
+  int rc = SQLITE_OK;
+  uint32_t tries = 0;
+
+  for (;;) {
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+    }
+    sqlite3_reset(stmt);
+
+    if (rc != SQLITE_BUSY && rc != SQLITE_LOCKED) {
+      break;
+    }
+
+    ctx->busy++;
+    if (++tries > BENCH_CONCURRENCY_MAX_RETRIES) {
+      break;
+    }
+    ctx->retries++;
+    sleep_ms(1);
+  }
+
+  if (rc != SQLITE_DONE) {
+    ctx->errors++;
+  }
+
+  return rc;
+}
+
+/* prepare a statement, retrying while the schema is locked by another connection */
+static sqlite3_stmt* concurrency_prepare_stmt(concurrency_ctx_t* ctx, sqlite3* db, const char* sql) {
+  uint32_t tries = 0;
+  sqlite3_stmt* stmt = NULL;
+
+  while (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_BUSY &&
+         ++tries <= BENCH_CONCURRENCY_MAX_RETRIES) {
+    ctx->busy++;
+    ctx->retries++;
+    sleep_ms(1);
+  }
+
+  return stmt;
+}
+
+static void* concurrency_entry(void* args) {
+  sqlite3* db = NULL;
+  sqlite3_stmt* read = NULL;
+  sqlite3_stmt* begin = NULL;
+  sqlite3_stmt* update = NULL;
+  sqlite3_stmt* insert = NULL;
+  sqlite3_stmt* commit = NULL;
+  concurrency_ctx_t* ctx = (concurrency_ctx_t*)args;
+
+  if (ctx->shared_db != NULL) {
+    db = ctx->shared_db;
+  } else {
+    sqlite3_open_v2(ctx->path, &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX, ctx->vfs);
+    sqlite3_busy_timeout(db, ctx->scenario->busy_ms);
+  }
+
+  read = concurrency_prepare_stmt(ctx, db,
+                                  "SELECT sum(v) FROM t WHERE id BETWEEN ?1 AND ?1 + 99;");
+  begin = concurrency_prepare_stmt(ctx, db, "BEGIN IMMEDIATE;");
+  update = concurrency_prepare_stmt(ctx, db, "UPDATE t SET v = v + 1 WHERE id = ?1;");
+  insert = concurrency_prepare_stmt(ctx, db, "INSERT INTO log(id, at) VALUES(?1, ?2);");
+  commit = concurrency_prepare_stmt(ctx, db, "COMMIT;");
+  if (read == NULL || begin == NULL || update == NULL || insert == NULL || commit == NULL) {
+    ctx->errors++;
+    ctx->end_us = 0;
+  }
+
+  while (bench_now_us() < ctx->end_us) {
+    uint64_t start = bench_now_us();
+    uint32_t key = concurrency_rand(&ctx->seed) % BENCH_CONCURRENCY_ROWS;
+
+    if (ctx->writer) {
+      if (concurrency_step(ctx, begin) != SQLITE_DONE) {
+        continue;
+      }
+      sqlite3_bind_int(update, 1, key);
+      concurrency_step(ctx, update);
+      sqlite3_bind_int(insert, 1, key);
+      sqlite3_bind_int64(insert, 2, (sqlite3_int64)start);
+      concurrency_step(ctx, insert);
+      if (concurrency_step(ctx, commit) != SQLITE_DONE) {
+        sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
+        continue;
+      }
+    } else {
+      sqlite3_bind_int(read, 1, key);
+      if (concurrency_step(ctx, read) != SQLITE_DONE) {
+        continue;
+      }
+    }
+
+    ctx->ops++;
+    bench_latency_add(&ctx->lat, bench_now_us() - start);
+  }
+
+  sqlite3_finalize(read);
+  sqlite3_finalize(begin);
+  sqlite3_finalize(update);
+  sqlite3_finalize(insert);
+  sqlite3_finalize(commit);
+  if (ctx->shared_db == NULL) {
+    sqlite3_close(db);
+  }
+
+  return NULL;
+}
+
+static void concurrency_prepare(const char* path, const concurrency_scenario_t* s,
+                                const char* vfs) {
+  char sql[64];
+  sqlite3* db = NULL;
+
+  sqlite3_open_v2(path, &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, vfs);
+  tk_snprintf(sql, sizeof(sql), "PRAGMA journal_mode=%s;", s->journal_mode);
+  sqlite3_exec(db, sql, NULL, NULL, NULL);
+  sqlite3_exec(db,
+               "DROP TABLE IF EXISTS t; DROP TABLE IF EXISTS log;"
+               "CREATE TABLE t(id INTEGER PRIMARY KEY, v INTEGER);"
+               "CREATE TABLE log(id INTEGER, at INTEGER);"
+               "WITH RECURSIVE c(x) AS (SELECT 0 UNION ALL SELECT x + 1 FROM c WHERE x < 9999)"
+               " INSERT INTO t SELECT x, 0 FROM c;",
+               NULL, NULL, NULL);
+  sqlite3_close(db);
+}
+
+/* fold the per-thread results of one role into a single report */
+static void concurrency_report(const concurrency_scenario_t* s, concurrency_ctx_t* ctxs, uint32_t n,
+                               bool_t writer, uint64_t elapsed_us) {
+  uint32_t i, j;
+  char bench[32];
+  uint64_t ops = 0;
+  uint64_t busy = 0;
+  uint64_t retries = 0;
+  uint64_t errors = 0;
+  bench_latency_t lat;
+
+  bench_latency_init(&lat, n * BENCH_CONCURRENCY_SAMPLES);
+  for (i = 0; i < n; i++) {
+    if (ctxs[i].writer == writer) {
+      ops += ctxs[i].ops;
+      busy += ctxs[i].busy;
+      retries += ctxs[i].retries;
+      errors += ctxs[i].errors;
+      for (j = 0; j < ctxs[i].lat.size; j++) {
+        bench_latency_add(&lat, ctxs[i].lat.samples_us[j]);
+      }
+    }
+  }
+
+  tk_snprintf(bench, sizeof(bench), "concurrency_%s", writer ? "write" : "read");
+  bench_report(bench, s->name, ops, elapsed_us);
+  bench_report_metric(bench, s->name, "busy", (double)busy);
+  bench_report_metric(bench, s->name, "retries", (double)retries);
+  bench_report_metric(bench, s->name, "errors", (double)errors);
+  bench_latency_report(&lat, bench, s->name);
+  bench_latency_deinit(&lat);
+}
+
+static void concurrency_run(const char* path, const concurrency_scenario_t* s, const char* vfs) {
+  uint32_t i;
+  uint64_t start = 0;
+  sqlite3* shared_db = NULL;
+  uint32_t n = s->readers + s->writers;
+  concurrency_ctx_t ctxs[BENCH_CONCURRENCY_MAX_THREADS];
+  tk_thread_t* threads[BENCH_CONCURRENCY_MAX_THREADS];
+
+  if (n == 0 || n > BENCH_CONCURRENCY_MAX_THREADS) {
+    log_info("bench_concurrency: %s needs 1..%d threads\n", s->name, BENCH_CONCURRENCY_MAX_THREADS);
+    return;
+  }
+
+  concurrency_prepare(path, s, vfs);
+  if (s->shared) {
+    sqlite3_open_v2(path, &shared_db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_FULLMUTEX, vfs);
+    sqlite3_busy_timeout(shared_db, s->busy_ms);
+  }
+
+  start = bench_now_us();
+  for (i = 0; i < n; i++) {
+    memset(&ctxs[i], 0, sizeof(ctxs[i]));
+    ctxs[i].scenario = s;
+    ctxs[i].path = path;
+    ctxs[i].vfs = vfs;
+    ctxs[i].shared_db = shared_db;
+    ctxs[i].writer = i >= s->readers;
+    ctxs[i].seed = i + 1;
+    ctxs[i].end_us = start + s->duration_ms * 1000;
+    bench_latency_init(&ctxs[i].lat, BENCH_CONCURRENCY_SAMPLES);
+
+    threads[i] = tk_thread_create(concurrency_entry, &ctxs[i]);
+    tk_thread_start(threads[i]);
+  }
+
+  for (i = 0; i < n; i++) {
+    tk_thread_join(threads[i]);
+    tk_thread_destroy(threads[i]);
+  }
+  start = bench_now_us() - start;
+
+  if (s->readers > 0) {
+    concurrency_report(s, ctxs, n, FALSE, start);
+  }
+  if (s->writers > 0) {
+    concurrency_report(s, ctxs, n, TRUE, start);
+  }
+
+  for (i = 0; i < n; i++) {
+    bench_latency_deinit(&ctxs[i].lat);
+  }
+  sqlite3_close(shared_db);
+}
+
+int main(int argc, char* argv[]) {
+  uint32_t i;
+  const char* path = argc > 1 ? argv[1] : "bench_concurrency.db";
+
+  platform_prepare();
+  sqlite3_initialize();
+
+  if (sqlite3_threadsafe() == 0) {
+    log_info("bench_concurrency: SQLite was built with SQLITE_THREADSAFE=0\n");
+    return 0;
+  }
+
+  if (argc > 8) {
+    concurrency_scenario_t s;
+
+    s.name = argv[2];
+    s.readers = (uint32_t)atoi(argv[3]);
+    s.writers = (uint32_t)atoi(argv[4]);
+    s.duration_ms = (uint32_t)atoi(argv[5]);
+    s.journal_mode = argv[6];
+    s.busy_ms = (uint32_t)atoi(argv[7]);
+    s.shared = atoi(argv[8]) != 0;
+    concurrency_run(path, &s, argc > 9 ? argv[9] : NULL);
+  } else {
+    for (i = 0; i < ARRAY_SIZE(s_scenarios); i++) {
+      concurrency_run(path, s_scenarios + i, NULL);
+    }
+  }
+
+  sqlite3_shutdown();
+
+  return 0;
+}
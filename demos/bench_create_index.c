@@ -0,0 +1,65 @@
+#include "sqlite3.h"
+#include "tkc/utils.h"
+#include "tkc/platform.h"
+#include "bench_common.h"
+
+/*
+ * build the same index with PRAGMA threads = 1, 2 and 4. The sorter only
+ * hands work to worker threads once the keys no longer fit in the page
+ * cache, so the table has to be much larger than cache_size.
+ */
+#define BENCH_CREATE_INDEX_ROWS 10000000
+
+static void bench_create_index_populate(sqlite3* db, uint32_t rows) {
+  uint32_t i;
+  sqlite3_stmt* stmt = NULL;
+
+  sqlite3_exec(db, "DROP TABLE IF EXISTS t;", NULL, NULL, NULL);
+  sqlite3_exec(db, "CREATE TABLE t(id INTEGER PRIMARY KEY, k INTEGER, v TEXT);", NULL, NULL, NULL);
+  sqlite3_exec(db, "BEGIN;", NULL, NULL, NULL);
+  sqlite3_prepare_v2(db, "INSERT INTO t(k, v) VALUES(random(), 'v');", -1, &stmt, NULL);
+  for (i = 0; i < rows; i++) {
+    sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+  }
+  sqlite3_finalize(stmt);
+  sqlite3_exec(db, "COMMIT;", NULL, NULL, NULL);
+}
+
+static void bench_create_index_run(sqlite3* db, uint32_t rows, int threads) {
+  char sql[64];
+  char variant[32];
+  uint64_t start = 0;
+
+  sqlite3_exec(db, "DROP INDEX IF EXISTS t_k;", NULL, NULL, NULL);
+  tk_snprintf(sql, sizeof(sql), "PRAGMA threads=%d;", threads);
+  sqlite3_exec(db, sql, NULL, NULL, NULL);
+  tk_snprintf(variant, sizeof(variant), "threads_%d", threads);
+
+  start = bench_now_us();
+  sqlite3_exec(db, "CREATE INDEX t_k ON t(k);", NULL, NULL, NULL);
+  bench_report("create_index", variant, rows, bench_now_us() - start);
+}
+
+int main(int argc, char* argv[]) {
+  sqlite3* db = NULL;
+  const char* path = argc > 1 ? argv[1] : "bench_create_index.db";
+  uint32_t rows = argc > 2 ? (uint32_t)atoi(argv[2]) : BENCH_CREATE_INDEX_ROWS;
+
+  platform_prepare();
+  sqlite3_initialize();
+
+  sqlite3_open(path, &db);
+  sqlite3_exec(db, "PRAGMA journal_mode=OFF; PRAGMA synchronous=OFF; PRAGMA cache_size=-2000;",
+               NULL, NULL, NULL);
+  bench_create_index_populate(db, rows);
+
+  bench_create_index_run(db, rows, 1);
+  bench_create_index_run(db, rows, 2);
+  bench_create_index_run(db, rows, 4);
+
+  sqlite3_close(db);
+  sqlite3_shutdown();
+
+  return 0;
+}
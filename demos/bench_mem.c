@@ -0,0 +1,98 @@
+#include "sqlite3.h"
+#include "sqlite3_awtk.h"
+#include "tkc/utils.h"
+#include "tkc/platform.h"
+#include "bench_common.h"
+
+/*
+ * run the same insert/index/query/delete workload with SQLite's default
+ * allocator and with the AWTK size-class pool (SQLITE_AWTK_ENABLE_MEM_POOL),
+ * and report throughput, peak heap use, pool fragmentation and what the pool
+ * still holds after sqlite3_awtk_mem_pool_release(). The pool variant needs
+ * SQLITE_AWTK_ENABLE_MEM_POOL (scons SQLITE_MEM_POOL=1).
+ */
+#define BENCH_MEM_ROWS 20000
+
+static uint64_t bench_mem_workload(uint32_t rows) {
+  uint32_t i;
+  sqlite3* db = NULL;
+  sqlite3_stmt* stmt = NULL;
+  uint64_t start = bench_now_us();
+
+  sqlite3_open(":memory:", &db);
+  sqlite3_exec(db, "CREATE TABLE t(id INTEGER PRIMARY KEY, name TEXT, val REAL);", NULL, NULL,
+               NULL);
+
+  sqlite3_exec(db, "BEGIN;", NULL, NULL, NULL);
+  sqlite3_prepare_v2(db, "INSERT INTO t(name, val) VALUES(hex(randomblob(?1)), ?2);", -1, &stmt,
+                     NULL);
+  for (i = 0; i < rows; i++) {
+    sqlite3_bind_int(stmt, 1, 4 + i % 60);
+    sqlite3_bind_double(stmt, 2, i * 0.5);
+    sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+  }
+  sqlite3_finalize(stmt);
+  sqlite3_exec(db, "COMMIT;", NULL, NULL, NULL);
+
+  sqlite3_exec(db, "CREATE INDEX t_name ON t(name);", NULL, NULL, NULL);
+  sqlite3_exec(db, "SELECT name, count(*) FROM t GROUP BY substr(name, 1, 2) ORDER BY 2;", NULL,
+               NULL, NULL);
+  sqlite3_exec(db, "DELETE FROM t WHERE id % 3 = 0;", NULL, NULL, NULL);
+  sqlite3_exec(db, "UPDATE t SET name = name || name WHERE id % 5 = 0;", NULL, NULL, NULL);
+  sqlite3_close(db);
+
+  return bench_now_us() - start;
+}
+
+static void bench_mem_run(const char* variant, uint32_t rows) {
+  sqlite3_int64 cur = 0;
+  sqlite3_int64 peak = 0;
+  uint64_t us = 0;
+
+  sqlite3_initialize();
+  sqlite3_status64(SQLITE_STATUS_MEMORY_USED, &cur, &peak, 1);
+  us = bench_mem_workload(rows);
+  sqlite3_status64(SQLITE_STATUS_MEMORY_USED, &cur, &peak, 0);
+
+  bench_report("mem_workload", variant, rows, us);
+  bench_report_metric("mem_workload", variant, "peak_bytes", (double)peak);
+
+#ifdef SQLITE_AWTK_ENABLE_MEM_POOL
+  if (tk_str_eq(variant, "awtk_pool")) {
+    sqlite3_awtk_mem_pool_stats stats;
+
+    /* slabs stay until released, so nReserved is the pool's heap peak */
+    sqlite3_awtk_mem_pool_stats_get(&stats);
+    bench_report_metric("mem_workload", variant, "reserved_bytes", (double)stats.nReserved);
+    bench_report_metric("mem_workload", variant, "fragmentation_pct",
+                        stats.nReserved ? 100.0 - 100.0 * peak / stats.nReserved : 0.0);
+    sqlite3_awtk_mem_pool_dump();
+
+    /* what is left once the empty slabs are back on the AWTK heap */
+    sqlite3_awtk_mem_pool_release();
+    sqlite3_awtk_mem_pool_stats_get(&stats);
+    bench_report_metric("mem_workload", variant, "released_reserved_bytes",
+                        (double)stats.nReserved);
+  }
+#endif
+
+  sqlite3_shutdown();
+}
+
+int main(int argc, char* argv[]) {
+  uint32_t rows = argc > 1 ? (uint32_t)atoi(argv[1]) : BENCH_MEM_ROWS;
+
+  platform_prepare();
+
+  /* the default allocator must run first: once replaced it cannot be restored */
+  bench_mem_run("default", rows);
+
+#ifdef SQLITE_AWTK_ENABLE_MEM_POOL
+  if (sqlite3_awtk_mem_pool_install() == SQLITE_OK) {
+    bench_mem_run("awtk_pool", rows);
+  }
+#endif
+
+  return 0;
+}
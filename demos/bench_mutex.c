@@ -0,0 +1,130 @@
+#include "sqlite3.h"
+#include "sqlite3_awtk.h"
+#include "tkc/platform.h"
+#include "tkc/thread.h"
+#include "tkc/utils.h"
+#include "bench_common.h"
+
+/*
+ * uncontended sqlite3_mutex_enter/sqlite3_mutex_leave pairs, for the mutex
+ * types SQLite uses on its hot paths, then 1 to 16 threads hammering one
+ * static mutex with a critical section as short as SQLITE_MUTEX_STATIC_MEM's.
+ */
+#define BENCH_MUTEX_LOOPS 2000000
+#define BENCH_MUTEX_MAX_THREADS 16
+
+static void bench_mutex_pairs(const char* name, sqlite3_mutex* mutex, uint32_t loops) {
+  uint32_t i;
+  uint64_t start;
+
+  /* warm up */
+  for (i = 0; i < 1000; i++) {
+    sqlite3_mutex_enter(mutex);
+    sqlite3_mutex_leave(mutex);
+  }
+
+  start = bench_now_us();
+  for (i = 0; i < loops; i++) {
+    sqlite3_mutex_enter(mutex);
+    sqlite3_mutex_leave(mutex);
+  }
+
+  bench_report("mutex_enter_leave", name, loops, bench_now_us() - start);
+}
+
+static void bench_mutex_try(const char* name, sqlite3_mutex* mutex, uint32_t loops) {
+  uint32_t i;
+  uint64_t start = bench_now_us();
+
+  for (i = 0; i < loops; i++) {
+    if (sqlite3_mutex_try(mutex) == SQLITE_OK) {
+      sqlite3_mutex_leave(mutex);
+    }
+  }
+
+  bench_report("mutex_try_leave", name, loops, bench_now_us() - start);
+}
+
+typedef struct _contention_ctx_t {
+  sqlite3_mutex* mutex;
+  uint32_t loops;
+  volatile uint64_t* counter;
+} contention_ctx_t;
+
+static void* contention_entry(void* args) {
+  uint32_t i;
+  contention_ctx_t* ctx = (contention_ctx_t*)args;
+
+  for (i = 0; i < ctx->loops; i++) {
+    sqlite3_mutex_enter(ctx->mutex);
+    (*ctx->counter)++;
+    sqlite3_mutex_leave(ctx->mutex);
+  }
+
+  return NULL;
+}
+
+static void bench_mutex_contention(const char* name, int kind, uint32_t loops) {
+  uint32_t n, i;
+  char variant[64];
+  volatile uint64_t counter = 0;
+  tk_thread_t* threads[BENCH_MUTEX_MAX_THREADS];
+  contention_ctx_t ctx;
+
+  sqlite3_shutdown();
+  if (sqlite3_awtk_mutex_set_kind(SQLITE_MUTEX_STATIC_APP1, kind) != SQLITE_OK) {
+    return;
+  }
+  sqlite3_initialize();
+
+  ctx.mutex = sqlite3_mutex_alloc(SQLITE_MUTEX_STATIC_APP1);
+  ctx.counter = &counter;
+
+  for (n = 1; n <= BENCH_MUTEX_MAX_THREADS; n *= 2) {
+    uint64_t start = 0;
+
+    ctx.loops = loops / n;
+    counter = 0;
+    start = bench_now_us();
+    for (i = 0; i < n; i++) {
+      threads[i] = tk_thread_create(contention_entry, &ctx);
+      tk_thread_start(threads[i]);
+    }
+    for (i = 0; i < n; i++) {
+      tk_thread_join(threads[i]);
+      tk_thread_destroy(threads[i]);
+    }
+
+    tk_snprintf(variant, sizeof(variant), "%s_t%u", name, n);
+    bench_report("mutex_contention", variant, counter, bench_now_us() - start);
+  }
+}
+
+int main(int argc, char* argv[]) {
+  sqlite3_mutex* fast = NULL;
+  sqlite3_mutex* recursive = NULL;
+  uint32_t loops = argc > 1 ? (uint32_t)atoi(argv[1]) : BENCH_MUTEX_LOOPS;
+
+  platform_prepare();
+  sqlite3_initialize();
+
+  fast = sqlite3_mutex_alloc(SQLITE_MUTEX_FAST);
+  recursive = sqlite3_mutex_alloc(SQLITE_MUTEX_RECURSIVE);
+
+  bench_mutex_pairs("fast", fast, loops);
+  bench_mutex_pairs("recursive", recursive, loops);
+  bench_mutex_pairs("static_mem", sqlite3_mutex_alloc(SQLITE_MUTEX_STATIC_MEM), loops);
+  bench_mutex_pairs("static_lru", sqlite3_mutex_alloc(SQLITE_MUTEX_STATIC_LRU), loops);
+  bench_mutex_try("fast", fast, loops);
+  bench_mutex_try("recursive", recursive, loops);
+
+  sqlite3_mutex_free(fast);
+  sqlite3_mutex_free(recursive);
+
+  bench_mutex_contention("plain", SQLITE_AWTK_MUTEX_PLAIN, loops);
+  bench_mutex_contention("nest", SQLITE_AWTK_MUTEX_NEST, loops);
+  bench_mutex_contention("adaptive", SQLITE_AWTK_MUTEX_ADAPTIVE, loops);
+  sqlite3_shutdown();
+
+  return 0;
+}
@@ -0,0 +1,129 @@
+#include "sqlite3.h"
+#include "sqlite3_awtk.h"
+#include "tkc/utils.h"
+#include "tkc/platform.h"
+#include "bench_common.h"
+
+/*
+ * several connections read the same database file with a skewed load: the
+ * first connection does most of the lookups. The same page budget is given
+ * to SQLite's pcache1 (split evenly by cache_size), to the AWTK page cache
+ * with private caches and to the AWTK page cache with one shared budget
+ * (SQLITE_AWTK_ENABLE_PCACHE). Reports lookups per second and hit rate.
+ */
+#define BENCH_PCACHE_ROWS 50000
+#define BENCH_PCACHE_CONNS 4
+#define BENCH_PCACHE_BUDGET 400
+#define BENCH_PCACHE_LOOKUPS 200000
+
+static uint32_t s_seed = 1;
+
+static uint32_t bench_pcache_rand(void) {
+  s_seed = s_seed * 1103515245 + 12345;
+  return (s_seed >> 8) & 0xffffff;
+}
+
+static void bench_pcache_populate(const char* path, uint32_t rows) {
+  uint32_t i;
+  sqlite3* db = NULL;
+  sqlite3_stmt* stmt = NULL;
+
+  sqlite3_open(path, &db);
+  sqlite3_exec(db, "DROP TABLE IF EXISTS t; CREATE TABLE t(id INTEGER PRIMARY KEY, v TEXT);", NULL,
+               NULL, NULL);
+  sqlite3_exec(db, "BEGIN;", NULL, NULL, NULL);
+  sqlite3_prepare_v2(db, "INSERT INTO t(id, v) VALUES(?1, hex(randomblob(48)));", -1, &stmt, NULL);
+  for (i = 0; i < rows; i++) {
+    sqlite3_bind_int(stmt, 1, i);
+    sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+  }
+  sqlite3_finalize(stmt);
+  sqlite3_exec(db, "COMMIT;", NULL, NULL, NULL);
+  sqlite3_close(db);
+}
+
+static void bench_pcache_run(const char* variant, const char* path, uint32_t rows,
+                             uint32_t lookups, int cache_size) {
+  int i;
+  uint32_t n;
+  int cur = 0;
+  int hit = 0;
+  int miss = 0;
+  int64_t hits = 0;
+  int64_t misses = 0;
+  uint64_t start = 0;
+  char sql[64];
+  sqlite3* db[BENCH_PCACHE_CONNS];
+  sqlite3_stmt* stmt[BENCH_PCACHE_CONNS];
+
+  sqlite3_initialize();
+  tk_snprintf(sql, sizeof(sql), "PRAGMA cache_size=%d;", cache_size);
+  for (i = 0; i < BENCH_PCACHE_CONNS; i++) {
+    sqlite3_open(path, &db[i]);
+    sqlite3_exec(db[i], sql, NULL, NULL, NULL);
+    sqlite3_prepare_v2(db[i], "SELECT v FROM t WHERE id=?1;", -1, &stmt[i], NULL);
+  }
+
+  s_seed = 1;
+  start = bench_now_us();
+  for (n = 0; n < lookups; n++) {
+    /* 70% of the lookups go to connection 0, each connection favours its own range */
+    uint32_t r = bench_pcache_rand();
+    int c = (r % 10) < 7 ? 0 : 1 + (int)(r % (BENCH_PCACHE_CONNS - 1));
+    uint32_t hot = rows / BENCH_PCACHE_CONNS;
+    uint32_t key = (bench_pcache_rand() % 10) < 8 ? c * hot + bench_pcache_rand() % hot
+                                                   : bench_pcache_rand() % rows;
+
+    sqlite3_bind_int(stmt[c], 1, key);
+    sqlite3_step(stmt[c]);
+    sqlite3_reset(stmt[c]);
+  }
+  bench_report("pcache_lookup", variant, lookups, bench_now_us() - start);
+
+  for (i = 0; i < BENCH_PCACHE_CONNS; i++) {
+    sqlite3_db_status(db[i], SQLITE_DBSTATUS_CACHE_HIT, &hit, &cur, 0);
+    sqlite3_db_status(db[i], SQLITE_DBSTATUS_CACHE_MISS, &miss, &cur, 0);
+    hits += hit;
+    misses += miss;
+    sqlite3_finalize(stmt[i]);
+    sqlite3_close(db[i]);
+  }
+  bench_report_metric("pcache_lookup", variant, "hit_pct",
+                      hits + misses ? 100.0 * hits / (hits + misses) : 0.0);
+
+#ifdef SQLITE_AWTK_ENABLE_PCACHE
+  if (!tk_str_eq(variant, "pcache1")) {
+    sqlite3_awtk_pcache_dump();
+  }
+#endif
+
+  sqlite3_shutdown();
+}
+
+int main(int argc, char* argv[]) {
+  const char* path = argc > 1 ? argv[1] : "bench_pcache.db";
+  uint32_t rows = argc > 2 ? (uint32_t)atoi(argv[2]) : BENCH_PCACHE_ROWS;
+  uint32_t lookups = argc > 3 ? (uint32_t)atoi(argv[3]) : BENCH_PCACHE_LOOKUPS;
+  int share = BENCH_PCACHE_BUDGET / BENCH_PCACHE_CONNS;
+
+  platform_prepare();
+
+  sqlite3_initialize();
+  bench_pcache_populate(path, rows);
+  sqlite3_shutdown();
+
+  /* pcache1 first: once replaced it cannot be restored */
+  bench_pcache_run("pcache1", path, rows, lookups, share);
+
+#ifdef SQLITE_AWTK_ENABLE_PCACHE
+  sqlite3_awtk_pcache_install(0, 0);
+  bench_pcache_run("awtk_private", path, rows, lookups, share);
+
+  /* every connection may grow to the whole budget but keeps a quarter of its share */
+  sqlite3_awtk_pcache_install(BENCH_PCACHE_BUDGET, share / 4);
+  bench_pcache_run("awtk_shared", path, rows, lookups, BENCH_PCACHE_BUDGET);
+#endif
+
+  return 0;
+}
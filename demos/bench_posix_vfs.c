@@ -0,0 +1,230 @@
+#include "sqlite3.h"
+#include "bench_common.h"
+
+/*
+ * a minimal VFS straight on POSIX calls, registered as "posix". Builds with
+ * SQLITE_OS_OTHER have no unix VFS, so the benchmarks use this one as the
+ * native reference for the awtk VFS. It does no file locking: one process,
+ * one connection per database file.
+ */
+#if defined(WIN32) || defined(_WIN32)
+
+int bench_posix_vfs_register(void) {
+  return SQLITE_NOTFOUND;
+}
+
+#else
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_POSIX_MAX_PATHNAME 512
+
+typedef struct _posix_file_t {
+  sqlite3_file base;
+  int fd;
+  int delete_on_close;
+  char path[BENCH_POSIX_MAX_PATHNAME + 1];
+} posix_file_t;
+
+static int posix_close(sqlite3_file* file) {
+  posix_file_t* p = (posix_file_t*)file;
+
+  close(p->fd);
+  if (p->delete_on_close) {
+    unlink(p->path);
+  }
+
+  return SQLITE_OK;
+}
+
+static int posix_read(sqlite3_file* file, void* buf, int amt, sqlite3_int64 offset) {
+  posix_file_t* p = (posix_file_t*)file;
+  ssize_t n = pread(p->fd, buf, amt, offset);
+
+  if (n == amt) {
+    return SQLITE_OK;
+  } else if (n >= 0) {
+    memset((char*)buf + n, 0, amt - n);
+    return SQLITE_IOERR_SHORT_READ;
+  }
+
+  return SQLITE_IOERR_READ;
+}
+
+static int posix_write(sqlite3_file* file, const void* buf, int amt, sqlite3_int64 offset) {
+  posix_file_t* p = (posix_file_t*)file;
+
+  return pwrite(p->fd, buf, amt, offset) == amt ? SQLITE_OK : SQLITE_IOERR_WRITE;
+}
+
+static int posix_truncate(sqlite3_file* file, sqlite3_int64 size) {
+  return ftruncate(((posix_file_t*)file)->fd, size) == 0 ? SQLITE_OK : SQLITE_IOERR_TRUNCATE;
+}
+
+static int posix_sync(sqlite3_file* file, int flags) {
+  return fsync(((posix_file_t*)file)->fd) == 0 ? SQLITE_OK : SQLITE_IOERR_FSYNC;
+}
+
+static int posix_file_size(sqlite3_file* file, sqlite3_int64* size) {
+  struct stat st;
+
+  if (fstat(((posix_file_t*)file)->fd, &st) != 0) {
+    return SQLITE_IOERR_FSTAT;
+  }
+  *size = st.st_size;
+
+  return SQLITE_OK;
+}
+
+static int posix_lock(sqlite3_file* file, int lock) {
+  return SQLITE_OK;
+}
+
+static int posix_check_reserved_lock(sqlite3_file* file, int* out) {
+  *out = 0;
+  return SQLITE_OK;
+}
+
+static int posix_file_control(sqlite3_file* file, int op, void* arg) {
+  return SQLITE_NOTFOUND;
+}
+
+static int posix_sector_size(sqlite3_file* file) {
+  return 4096;
+}
+
+static int posix_device_characteristics(sqlite3_file* file) {
+  return 0;
+}
+
+static int posix_open(sqlite3_vfs* vfs, const char* name, sqlite3_file* file, int flags,
+                      int* out_flags) {
+  static const sqlite3_io_methods methods = {
+      1,
+      posix_close,
+      posix_read,
+      posix_write,
+      posix_truncate,
+      posix_sync,
+      posix_file_size,
+      posix_lock,
+      posix_lock,
+      posix_check_reserved_lock,
+      posix_file_control,
+      posix_sector_size,
+      posix_device_characteristics,
+  };
+  static int temp_seq = 0;
+  int oflags = 0;
+  posix_file_t* p = (posix_file_t*)file;
+
+  memset(p, 0, sizeof(*p));
+  if (name == NULL) {
+    snprintf(p->path, sizeof(p->path), "/tmp/bench_posix_%d_%d", (int)getpid(), temp_seq++);
+  } else {
+    snprintf(p->path, sizeof(p->path), "%s", name);
+  }
+
+  oflags |= (flags & SQLITE_OPEN_READWRITE) ? O_RDWR : O_RDONLY;
+  oflags |= (flags & SQLITE_OPEN_CREATE) ? O_CREAT : 0;
+  oflags |= (flags & SQLITE_OPEN_EXCLUSIVE) ? O_EXCL : 0;
+
+  p->fd = open(p->path, oflags, 0644);
+  if (p->fd < 0) {
+    return SQLITE_CANTOPEN;
+  }
+
+  p->delete_on_close = (flags & SQLITE_OPEN_DELETEONCLOSE) || name == NULL;
+  p->base.pMethods = &methods;
+  if (out_flags != NULL) {
+    *out_flags = flags;
+  }
+
+  return SQLITE_OK;
+}
+
+static int posix_delete(sqlite3_vfs* vfs, const char* name, int sync_dir) {
+  if (unlink(name) != 0 && errno != ENOENT) {
+    return SQLITE_IOERR_DELETE;
+  }
+
+  return SQLITE_OK;
+}
+
+static int posix_access(sqlite3_vfs* vfs, const char* name, int flags, int* out) {
+  int mode = F_OK;
+
+  if (flags == SQLITE_ACCESS_READWRITE) {
+    mode = R_OK | W_OK;
+  } else if (flags == SQLITE_ACCESS_READ) {
+    mode = R_OK;
+  }
+  *out = access(name, mode) == 0;
+
+  return SQLITE_OK;
+}
+
+static int posix_full_pathname(sqlite3_vfs* vfs, const char* name, int n, char* out) {
+  char cwd[BENCH_POSIX_MAX_PATHNAME + 1];
+
+  if (name[0] == '/' || getcwd(cwd, sizeof(cwd)) == NULL) {
+    snprintf(out, n, "%s", name);
+  } else {
+    snprintf(out, n, "%s/%s", cwd, name);
+  }
+
+  return SQLITE_OK;
+}
+
+static int posix_randomness(sqlite3_vfs* vfs, int n, char* out) {
+  int i;
+
+  for (i = 0; i < n; i++) {
+    out[i] = (char)(rand() & 0xff);
+  }
+
+  return n;
+}
+
+static int posix_sleep(sqlite3_vfs* vfs, int us) {
+  usleep(us);
+  return us;
+}
+
+static int posix_current_time(sqlite3_vfs* vfs, double* now) {
+  *now = time(NULL) / 86400.0 + 2440587.5;
+  return SQLITE_OK;
+}
+
+int bench_posix_vfs_register(void) {
+  static sqlite3_vfs vfs = {
+      1,                        /* iVersion */
+      sizeof(posix_file_t),     /* szOsFile */
+      BENCH_POSIX_MAX_PATHNAME, /* mxPathname */
+      0,                        /* pNext */
+      "posix",                  /* zName */
+      0,                        /* pAppData */
+      posix_open,               /* xOpen */
+      posix_delete,             /* xDelete */
+      posix_access,             /* xAccess */
+      posix_full_pathname,      /* xFullPathname */
+      0,                        /* xDlOpen */
+      0,                        /* xDlError */
+      0,                        /* xDlSym */
+      0,                        /* xDlClose */
+      posix_randomness,         /* xRandomness */
+      posix_sleep,              /* xSleep */
+      posix_current_time,       /* xCurrentTime */
+      0,                        /* xGetLastError */
+  };
+
+  return sqlite3_vfs_register(&vfs, 0);
+}
+
+#endif /*WIN32*/
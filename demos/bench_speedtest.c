@@ -0,0 +1,201 @@
+#include "sqlite3.h"
+#include "tkc/utils.h"
+#include "tkc/platform.h"
+#include "bench_common.h"
+
+/*
+ * speedtest1-style suite: bulk inserts, point lookups, range scans, joins,
+ * ORDER BY, updates, deletes, CREATE INDEX and VACUUM at several table
+ * sizes, once through the awtk VFS and once through the native one ("unix"
+ * when SQLite has it, else the "posix" VFS of bench_posix_vfs.c).
+ *
+ * every step prints its throughput (bench_report) and its per-statement
+ * latency percentiles (bench_latency_report), e.g.
+ *   bench_speedtest [db_prefix] [max_rows]
+ */
+#define BENCH_SPEEDTEST_MIN_ROWS 1000
+#define BENCH_SPEEDTEST_MAX_ROWS 100000
+
+typedef void (*speedtest_bind_t)(sqlite3_stmt* stmt, uint32_t i, uint32_t rows);
+
+typedef struct _speedtest_step_t {
+  const char* name;
+  const char* sql;
+  uint32_t div; /* Runs the statement rows / div times, at least 10 */
+  bool_t txn;   /* All runs in one transaction */
+  speedtest_bind_t bind;
+} speedtest_step_t;
+
+static uint32_t s_seed = 1;
+
+static uint32_t speedtest_rand(void) {
+  s_seed = s_seed * 1103515245 + 12345;
+  return (s_seed >> 8) & 0xffffff;
+}
+
+static void speedtest_bind_text(sqlite3_stmt* stmt, int idx, uint32_t v) {
+  char text[32];
+
+  tk_snprintf(text, sizeof(text), "%08x-%u", v * 2654435761u, v);
+  sqlite3_bind_text(stmt, idx, text, -1, SQLITE_TRANSIENT);
+}
+
+static void speedtest_bind_insert(sqlite3_stmt* stmt, uint32_t i, uint32_t rows) {
+  sqlite3_bind_int(stmt, 1, i + 1);
+  sqlite3_bind_int(stmt, 2, speedtest_rand() % rows);
+  speedtest_bind_text(stmt, 3, speedtest_rand());
+}
+
+static void speedtest_bind_key(sqlite3_stmt* stmt, uint32_t i, uint32_t rows) {
+  sqlite3_bind_int(stmt, 1, 1 + speedtest_rand() % rows);
+}
+
+static void speedtest_bind_update(sqlite3_stmt* stmt, uint32_t i, uint32_t rows) {
+  sqlite3_bind_int(stmt, 1, 1 + speedtest_rand() % rows);
+  speedtest_bind_text(stmt, 2, i);
+}
+
+static void speedtest_bind_delete(sqlite3_stmt* stmt, uint32_t i, uint32_t rows) {
+  sqlite3_bind_int(stmt, 1, 1 + i * 4);
+}
+
+static void speedtest_bind_offset(sqlite3_stmt* stmt, uint32_t i, uint32_t rows) {
+  sqlite3_bind_int(stmt, 1, speedtest_rand() % rows);
+}
+
+static const speedtest_step_t s_steps[] = {
+    {"insert", "INSERT INTO t1(a, b, c) VALUES(?1, ?2, ?3);", 1, TRUE, speedtest_bind_insert},
+    {"insert_indexed", "INSERT INTO t2(a, b, c) VALUES(?1, ?2, ?3);", 1, TRUE,
+     speedtest_bind_insert},
+    {"lookup_pk", "SELECT c FROM t1 WHERE a = ?1;", 1, FALSE, speedtest_bind_key},
+    {"lookup_index", "SELECT a, c FROM t2 WHERE b = ?1;", 1, FALSE, speedtest_bind_key},
+    {"range_scan", "SELECT count(*), avg(b) FROM t1 WHERE a BETWEEN ?1 AND ?1 + 99;", 100, FALSE,
+     speedtest_bind_key},
+    {"join", "SELECT count(*) FROM t1, t2 WHERE t1.a BETWEEN ?1 AND ?1 + 49 AND t2.b = t1.b;", 100,
+     FALSE, speedtest_bind_key},
+    {"order_by", "SELECT c FROM t1 ORDER BY c LIMIT 10 OFFSET ?1;", 0, FALSE,
+     speedtest_bind_offset},
+    {"update", "UPDATE t1 SET c = ?2 WHERE a = ?1;", 2, TRUE, speedtest_bind_update},
+    {"delete", "DELETE FROM t1 WHERE a = ?1;", 4, TRUE, speedtest_bind_delete},
+    {"create_index", "CREATE INDEX t1_c ON t1(c);", 0, FALSE, NULL},
+    {"vacuum", "VACUUM;", 0, FALSE, NULL},
+};
+
+static uint32_t speedtest_count(const speedtest_step_t* step, uint32_t rows) {
+  uint32_t count = 0;
+
+  if (step->bind == NULL) {
+    return 1;
+  }
+
+  count = step->div > 0 ? rows / step->div : 10;
+
+  return count < 10 ? 10 : count;
+}
+
+static void speedtest_run_step(sqlite3* db, const speedtest_step_t* step, const char* variant,
+                               uint32_t rows) {
+  uint32_t i;
+  char bench[64];
+  uint64_t start = 0;
+  uint64_t total = 0;
+  sqlite3_stmt* stmt = NULL;
+  bench_latency_t lat;
+  uint32_t count = speedtest_count(step, rows);
+
+  if (sqlite3_prepare_v2(db, step->sql, -1, &stmt, NULL) != SQLITE_OK) {
+    log_info("%s: %s\n", step->name, sqlite3_errmsg(db));
+    return;
+  }
+
+  bench_latency_init(&lat, count);
+  if (step->txn) {
+    sqlite3_exec(db, "BEGIN;", NULL, NULL, NULL);
+  }
+
+  total = bench_now_us();
+  for (i = 0; i < count; i++) {
+    start = bench_now_us();
+    if (step->bind != NULL) {
+      step->bind(stmt, i, rows);
+    }
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+    }
+    sqlite3_reset(stmt);
+    bench_latency_add(&lat, bench_now_us() - start);
+  }
+
+  if (step->txn) {
+    sqlite3_exec(db, "COMMIT;", NULL, NULL, NULL);
+  }
+  total = bench_now_us() - total;
+  sqlite3_finalize(stmt);
+
+  tk_snprintf(bench, sizeof(bench), "speedtest_%s", step->name);
+  bench_report(bench, variant, count, total);
+  bench_latency_report(&lat, bench, variant);
+  bench_latency_deinit(&lat);
+}
+
+static void speedtest_run(const char* vfs_name, const char* prefix, uint32_t rows) {
+  uint32_t i;
+  char path[128];
+  char journal[140];
+  char variant[64];
+  sqlite3* db = NULL;
+  sqlite3_vfs* vfs = sqlite3_vfs_find(vfs_name);
+
+  if (vfs == NULL) {
+    return;
+  }
+
+  tk_snprintf(path, sizeof(path), "%s_%s.db", prefix, vfs_name);
+  tk_snprintf(journal, sizeof(journal), "%s-journal", path);
+  vfs->xDelete(vfs, path, 0);
+  vfs->xDelete(vfs, journal, 0);
+
+  if (sqlite3_open_v2(path, &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, vfs_name) !=
+      SQLITE_OK) {
+    log_info("open %s with vfs %s failed\n", path, vfs_name);
+    sqlite3_close(db);
+    return;
+  }
+
+  sqlite3_exec(db,
+               "CREATE TABLE t1(a INTEGER PRIMARY KEY, b INTEGER, c TEXT);"
+               "CREATE TABLE t2(a INTEGER PRIMARY KEY, b INTEGER, c TEXT);"
+               "CREATE INDEX t2_b ON t2(b);",
+               NULL, NULL, NULL);
+
+  s_seed = 1;
+  tk_snprintf(variant, sizeof(variant), "%s_%u", vfs_name, rows);
+  for (i = 0; i < ARRAY_SIZE(s_steps); i++) {
+    speedtest_run_step(db, s_steps + i, variant, rows);
+  }
+
+  sqlite3_close(db);
+  vfs->xDelete(vfs, path, 0);
+}
+
+int main(int argc, char* argv[]) {
+  uint32_t rows = 0;
+  const char* prefix = argc > 1 ? argv[1] : "speedtest";
+  uint32_t max_rows = argc > 2 ? (uint32_t)atoi(argv[2]) : BENCH_SPEEDTEST_MAX_ROWS;
+  const char* native = "unix";
+
+  platform_prepare();
+  sqlite3_initialize();
+
+  if (sqlite3_vfs_find(native) == NULL && bench_posix_vfs_register() == SQLITE_OK) {
+    native = "posix";
+  }
+
+  for (rows = BENCH_SPEEDTEST_MIN_ROWS; rows <= max_rows; rows *= 10) {
+    speedtest_run("awtk", prefix, rows);
+    speedtest_run(native, prefix, rows);
+  }
+
+  sqlite3_shutdown();
+
+  return 0;
+}
@@ -0,0 +1,167 @@
+#include "sqlite3.h"
+#include "sqlite3_awtk.h"
+#include "tkc/utils.h"
+#include "tkc/platform.h"
+#include "bench_common.h"
+
+/*
+ * boot cost of SQLite by phase, on generated schemas of increasing size
+ * (tables with an index and an audit trigger each): sqlite3_initialize(),
+ * open, sqlite_master parse, the first prepare on the fresh connection and,
+ * for reference, the same prepare once the schema is loaded. Every phase is
+ * run several times and reported as latency percentiles, e.g.
+ *   bench_startup [db] [max_tables] [loops]
+ *
+ * with SQLITE_AWTK_ENABLE_BOOT_PROF the port also splits
+ * sqlite3_initialize() into the mutex init and the VFS registration. The
+ * database file stays in the OS cache after the first loop, so on a device
+ * the max_us of the first boot is the one to watch.
+ */
+#define BENCH_STARTUP_MIN_TABLES 50
+#define BENCH_STARTUP_MAX_TABLES 400
+#define BENCH_STARTUP_LOOPS 20
+
+typedef enum _startup_phase_t {
+  STARTUP_INIT = 0,
+  STARTUP_OPEN,
+  STARTUP_SCHEMA,
+  STARTUP_FIRST_PREPARE,
+  STARTUP_WARM_PREPARE,
+  STARTUP_TOTAL,
+#ifdef SQLITE_AWTK_ENABLE_BOOT_PROF
+  STARTUP_MUTEX_INIT,
+  STARTUP_OS_INIT,
+#endif
+  STARTUP_PHASES
+} startup_phase_t;
+
+static const char* const s_phase_names[STARTUP_PHASES] = {
+    "startup_init",          "startup_open",         "startup_schema",
+    "startup_first_prepare", "startup_warm_prepare", "startup_total",
+#ifdef SQLITE_AWTK_ENABLE_BOOT_PROF
+    "startup_mutex_init",    "startup_os_init",
+#endif
+};
+
+static int startup_generate(const char* path, uint32_t tables) {
+  uint32_t i;
+  char sql[512];
+  sqlite3* db = NULL;
+
+  remove(path);
+  if (sqlite3_open_v2(path, &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL) != SQLITE_OK) {
+    log_info("bench_startup: open %s failed\n", path);
+    sqlite3_close(db);
+    return SQLITE_CANTOPEN;
+  }
+
+  sqlite3_exec(db, "BEGIN; CREATE TABLE audit(tbl TEXT, id INTEGER, at INTEGER);", NULL, NULL,
+               NULL);
+  for (i = 0; i < tables; i++) {
+    tk_snprintf(sql, sizeof(sql),
+                "CREATE TABLE t%u(id INTEGER PRIMARY KEY, a INTEGER NOT NULL DEFAULT 0,"
+                " b TEXT, c REAL, d BLOB, e TEXT COLLATE NOCASE UNIQUE);"
+                "CREATE INDEX t%u_ab ON t%u(a, b);"
+                "CREATE TRIGGER t%u_au AFTER UPDATE ON t%u BEGIN"
+                " INSERT INTO audit VALUES('t%u', new.id, strftime('%%s', 'now')); END;",
+                i, i, i, i, i, i);
+    sqlite3_exec(db, sql, NULL, NULL, NULL);
+  }
+  sqlite3_exec(db, "COMMIT;", NULL, NULL, NULL);
+
+  return sqlite3_close(db);
+}
+
+static uint64_t startup_prepare(sqlite3* db, uint32_t table) {
+  char sql[128];
+  sqlite3_stmt* stmt = NULL;
+  uint64_t start = bench_now_us();
+
+  tk_snprintf(sql, sizeof(sql), "SELECT a, b FROM t%u WHERE a = ?1 ORDER BY b;", table);
+  sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+  sqlite3_finalize(stmt);
+
+  return bench_now_us() - start;
+}
+
+static void startup_run(const char* path, uint32_t tables, uint32_t loops) {
+  uint32_t i, j;
+  char variant[32];
+  bench_latency_t lat[STARTUP_PHASES];
+
+  if (startup_generate(path, tables) != SQLITE_OK) {
+    return;
+  }
+
+  for (j = 0; j < STARTUP_PHASES; j++) {
+    bench_latency_init(&lat[j], loops);
+  }
+
+  for (i = 0; i < loops; i++) {
+    uint64_t us[STARTUP_PHASES];
+    uint64_t start = 0;
+    sqlite3* db = NULL;
+
+    sqlite3_shutdown();
+    start = bench_now_us();
+    sqlite3_initialize();
+    us[STARTUP_INIT] = bench_now_us() - start;
+
+#ifdef SQLITE_AWTK_ENABLE_BOOT_PROF
+    sqlite3_awtk_boot_open(path, SQLITE_OPEN_READWRITE, NULL, &db);
+    us[STARTUP_OPEN] = sqlite3_awtk_boot_get(SQLITE_AWTK_BOOT_OPEN);
+    us[STARTUP_SCHEMA] = sqlite3_awtk_boot_get(SQLITE_AWTK_BOOT_SCHEMA);
+    us[STARTUP_MUTEX_INIT] = sqlite3_awtk_boot_get(SQLITE_AWTK_BOOT_MUTEX_INIT);
+    us[STARTUP_OS_INIT] = sqlite3_awtk_boot_get(SQLITE_AWTK_BOOT_OS_INIT);
+#else
+    {
+      sqlite3_stmt* stmt = NULL;
+
+      start = bench_now_us();
+      sqlite3_open_v2(path, &db, SQLITE_OPEN_READWRITE, NULL);
+      us[STARTUP_OPEN] = bench_now_us() - start;
+
+      start = bench_now_us();
+      sqlite3_prepare_v2(db, "SELECT 1 FROM sqlite_master LIMIT 0;", -1, &stmt, NULL);
+      sqlite3_finalize(stmt);
+      us[STARTUP_SCHEMA] = bench_now_us() - start;
+    }
+#endif
+
+    us[STARTUP_FIRST_PREPARE] = startup_prepare(db, tables / 2);
+    us[STARTUP_WARM_PREPARE] = startup_prepare(db, tables / 2);
+    us[STARTUP_TOTAL] = us[STARTUP_INIT] + us[STARTUP_OPEN] + us[STARTUP_SCHEMA] +
+                        us[STARTUP_FIRST_PREPARE];
+    sqlite3_close(db);
+
+    for (j = 0; j < STARTUP_PHASES; j++) {
+      bench_latency_add(&lat[j], us[j]);
+    }
+  }
+
+  tk_snprintf(variant, sizeof(variant), "tables_%u", tables);
+  for (j = 0; j < STARTUP_PHASES; j++) {
+    bench_latency_report(&lat[j], s_phase_names[j], variant);
+    bench_latency_deinit(&lat[j]);
+  }
+
+  remove(path);
+}
+
+int main(int argc, char* argv[]) {
+  uint32_t tables = 0;
+  const char* path = argc > 1 ? argv[1] : "bench_startup.db";
+  uint32_t max_tables = argc > 2 ? (uint32_t)atoi(argv[2]) : BENCH_STARTUP_MAX_TABLES;
+  uint32_t loops = argc > 3 ? (uint32_t)atoi(argv[3]) : BENCH_STARTUP_LOOPS;
+
+  platform_prepare();
+  sqlite3_initialize();
+
+  for (tables = BENCH_STARTUP_MIN_TABLES; tables <= max_tables; tables *= 2) {
+    startup_run(path, tables, loops);
+  }
+
+  sqlite3_shutdown();
+
+  return 0;
+}
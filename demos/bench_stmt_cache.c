@@ -0,0 +1,157 @@
+#include "sqlite3.h"
+#include "sqlite3_awtk.h"
+#include "tkc/utils.h"
+#include "tkc/platform.h"
+#include "bench_common.h"
+
+/*
+ * hot-path inserts and primary key lookups, run three ways:
+ *   exec     SQL text with the values in it, sqlite3_exec() (the pattern of
+ *            sqlite3_test.c): parsed and planned on every call
+ *   prepare  sqlite3_prepare_v2(), bind, step, finalize on every call
+ *   cached   sqlite3_awtk_prepare_cached(), bind, step, release
+ * e.g. bench_stmt_cache [db] [rows]
+ *
+ * inserts are in one transaction, so the run time is mostly SQLite's CPU.
+ */
+#define BENCH_STMT_CACHE_ROWS 20000
+
+#define SQL_INSERT "INSERT INTO kv(id, name, value) VALUES(?1, ?2, ?3);"
+#define SQL_LOOKUP "SELECT name, value FROM kv WHERE id = ?1;"
+
+typedef enum _stmt_mode_t { STMT_EXEC = 0, STMT_PREPARE, STMT_CACHED, STMT_MODES } stmt_mode_t;
+
+static const char* const s_mode_names[STMT_MODES] = {"exec", "prepare", "cached"};
+
+static int stmt_acquire(sqlite3* db, stmt_mode_t mode, const char* sql, sqlite3_stmt** stmt) {
+  if (mode == STMT_CACHED) {
+    return sqlite3_awtk_prepare_cached(db, sql, stmt);
+  }
+
+  return sqlite3_prepare_v2(db, sql, -1, stmt, NULL);
+}
+
+static void stmt_done(stmt_mode_t mode, sqlite3_stmt* stmt) {
+  if (mode == STMT_CACHED) {
+    sqlite3_awtk_stmt_release(stmt);
+  } else {
+    sqlite3_finalize(stmt);
+  }
+}
+
+static int stmt_insert(sqlite3* db, stmt_mode_t mode, uint32_t id) {
+  int rc = SQLITE_OK;
+  char name[32];
+  sqlite3_stmt* stmt = NULL;
+
+  tk_snprintf(name, sizeof(name), "name_%u", id);
+  if (mode == STMT_EXEC) {
+    char sql[128];
+
+    tk_snprintf(sql, sizeof(sql), "INSERT INTO kv(id, name, value) VALUES(%u, '%s', %u);", id,
+                name, id * 7);
+    return sqlite3_exec(db, sql, NULL, NULL, NULL);
+  }
+
+  rc = stmt_acquire(db, mode, SQL_INSERT, &stmt);
+  if (rc == SQLITE_OK) {
+    sqlite3_bind_int(stmt, 1, (int)id);
+    sqlite3_bind_text(stmt, 2, name, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 3, (int)(id * 7));
+    rc = sqlite3_step(stmt) == SQLITE_DONE ? SQLITE_OK : sqlite3_errcode(db);
+    stmt_done(mode, stmt);
+  }
+
+  return rc;
+}
+
+static int stmt_on_row(void* ctx, int argc, char** argv, char** names) {
+  (*(uint32_t*)ctx)++;
+
+  return 0;
+}
+
+static uint32_t stmt_lookup(sqlite3* db, stmt_mode_t mode, uint32_t id) {
+  uint32_t rows = 0;
+  sqlite3_stmt* stmt = NULL;
+
+  if (mode == STMT_EXEC) {
+    char sql[96];
+
+    tk_snprintf(sql, sizeof(sql), "SELECT name, value FROM kv WHERE id = %u;", id);
+    sqlite3_exec(db, sql, stmt_on_row, &rows, NULL);
+    return rows;
+  }
+
+  if (stmt_acquire(db, mode, SQL_LOOKUP, &stmt) == SQLITE_OK) {
+    sqlite3_bind_int(stmt, 1, (int)id);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+      rows++;
+    }
+    stmt_done(mode, stmt);
+  }
+
+  return rows;
+}
+
+static void stmt_run(const char* path, stmt_mode_t mode, uint32_t rows) {
+  uint32_t i;
+  uint32_t found = 0;
+  uint64_t start = 0;
+  sqlite3* db = NULL;
+
+  remove(path);
+  if (sqlite3_open(path, &db) != SQLITE_OK) {
+    log_info("bench_stmt_cache: open %s failed\n", path);
+    sqlite3_close(db);
+    return;
+  }
+  sqlite3_exec(db, "CREATE TABLE kv(id INTEGER PRIMARY KEY, name TEXT, value INTEGER);", NULL,
+               NULL, NULL);
+
+  start = bench_now_us();
+  sqlite3_exec(db, "BEGIN;", NULL, NULL, NULL);
+  for (i = 0; i < rows; i++) {
+    stmt_insert(db, mode, i);
+  }
+  sqlite3_exec(db, "COMMIT;", NULL, NULL, NULL);
+  bench_report("stmt_insert", s_mode_names[mode], rows, bench_now_us() - start);
+
+  start = bench_now_us();
+  for (i = 0; i < rows; i++) {
+    found += stmt_lookup(db, mode, (i * 7919) % rows);
+  }
+  bench_report("stmt_lookup", s_mode_names[mode], rows, bench_now_us() - start);
+  if (found != rows) {
+    log_info("bench_stmt_cache: %s found %u of %u rows\n", s_mode_names[mode], found, rows);
+  }
+
+  if (mode == STMT_CACHED) {
+    sqlite3_awtk_stmt_cache_stats stats;
+
+    sqlite3_awtk_stmt_cache_stats_get(db, &stats, 0);
+    bench_report_metric("stmt_cache", s_mode_names[mode], "hit_pct",
+                        stats.nHit + stats.nMiss ? 100.0 * stats.nHit / (stats.nHit + stats.nMiss)
+                                                 : 0.0);
+  }
+
+  sqlite3_close(db);
+  remove(path);
+}
+
+int main(int argc, char* argv[]) {
+  int mode = 0;
+  const char* path = argc > 1 ? argv[1] : "bench_stmt_cache.db";
+  uint32_t rows = argc > 2 ? (uint32_t)atoi(argv[2]) : BENCH_STMT_CACHE_ROWS;
+
+  platform_prepare();
+  sqlite3_initialize();
+
+  for (mode = 0; mode < STMT_MODES; mode++) {
+    stmt_run(path, (stmt_mode_t)mode, rows);
+  }
+
+  sqlite3_shutdown();
+
+  return 0;
+}
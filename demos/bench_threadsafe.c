@@ -0,0 +1,87 @@
+#include "sqlite3.h"
+#include "sqlite3_awtk.h"
+#include "tkc/platform.h"
+#include "tkc/thread.h"
+#include "tkc/utils.h"
+#include "bench_common.h"
+
+/*
+ * per-statement cost of the connection mutex: the same bind/step/reset of
+ * a trivial query on connections opened SQLITE_OPEN_FULLMUTEX (serialized)
+ * and SQLITE_OPEN_NOMUTEX (multi-thread), on one thread and on 4 threads
+ * that each own a connection. NOMUTEX needs a build with SQLITE_THREADSAFE
+ * 1 or 2; with SQLITE_AWTK_MULTI_THREAD it is what every connection gets.
+ */
+#define BENCH_THREADSAFE_LOOPS 1000000
+#define BENCH_THREADSAFE_THREADS 4
+
+typedef struct _threadsafe_ctx_t {
+  const char* path;
+  int flags;
+  uint32_t loops;
+} threadsafe_ctx_t;
+
+static void* bench_threadsafe_entry(void* args) {
+  uint32_t i;
+  sqlite3* db = NULL;
+  sqlite3_stmt* stmt = NULL;
+  threadsafe_ctx_t* ctx = (threadsafe_ctx_t*)args;
+
+  sqlite3_open_v2(ctx->path, &db, ctx->flags | SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL);
+  sqlite3_prepare_v2(db, "SELECT ?1 + 1;", -1, &stmt, NULL);
+  for (i = 0; i < ctx->loops; i++) {
+    sqlite3_bind_int(stmt, 1, i);
+    sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+  }
+  sqlite3_finalize(stmt);
+  sqlite3_close(db);
+
+  return NULL;
+}
+
+static void bench_threadsafe_run(const char* variant, int flags, uint32_t loops, uint32_t n) {
+  uint32_t i;
+  char name[64];
+  uint64_t start = 0;
+  threadsafe_ctx_t ctx = {":memory:", flags, loops};
+  tk_thread_t* threads[BENCH_THREADSAFE_THREADS];
+
+  start = bench_now_us();
+  if (n == 1) {
+    bench_threadsafe_entry(&ctx);
+  } else {
+    for (i = 0; i < n; i++) {
+      threads[i] = tk_thread_create(bench_threadsafe_entry, &ctx);
+      tk_thread_start(threads[i]);
+    }
+    for (i = 0; i < n; i++) {
+      tk_thread_join(threads[i]);
+      tk_thread_destroy(threads[i]);
+    }
+  }
+
+  tk_snprintf(name, sizeof(name), "%s_t%u", variant, n);
+  bench_report("stmt_step", name, loops * n, bench_now_us() - start);
+}
+
+int main(int argc, char* argv[]) {
+  uint32_t loops = argc > 1 ? (uint32_t)atoi(argv[1]) : BENCH_THREADSAFE_LOOPS;
+
+  platform_prepare();
+  sqlite3_initialize();
+
+  if (sqlite3_threadsafe() == 0) {
+    log_info("bench_threadsafe: SQLite was built with SQLITE_THREADSAFE=0\n");
+    return 0;
+  }
+
+  bench_threadsafe_run("serialized", SQLITE_OPEN_FULLMUTEX, loops, 1);
+  bench_threadsafe_run("multi_thread", SQLITE_OPEN_NOMUTEX, loops, 1);
+  bench_threadsafe_run("serialized", SQLITE_OPEN_FULLMUTEX, loops, BENCH_THREADSAFE_THREADS);
+  bench_threadsafe_run("multi_thread", SQLITE_OPEN_NOMUTEX, loops, BENCH_THREADSAFE_THREADS);
+
+  sqlite3_shutdown();
+
+  return 0;
+}
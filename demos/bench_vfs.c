@@ -0,0 +1,239 @@
+#include "sqlite3.h"
+#include "tkc/mem.h"
+#include "tkc/utils.h"
+#include "tkc/platform.h"
+#include "bench_common.h"
+
+/*
+ * cost of the VFS layer per I/O operation: sequential and random page
+ * reads, page writes, write+sync, lock/unlock cycles, open/close and access,
+ * called directly through the sqlite3_vfs/sqlite3_io_methods of the awtk
+ * VFS, of the native VFS ("unix", else the "posix" VFS of
+ * bench_posix_vfs.c) and as raw POSIX calls. Compare ns_per_op of the same
+ * bench across variants, e.g.
+ *   bench_vfs [file] [loops]
+ */
+#define BENCH_VFS_PAGE_SIZE 4096
+#define BENCH_VFS_PAGES 1024
+#define BENCH_VFS_LOOPS 20000
+#define BENCH_VFS_SYNC_LOOPS 200
+
+static uint32_t s_seed = 1;
+
+static uint32_t bench_vfs_rand(void) {
+  s_seed = s_seed * 1103515245 + 12345;
+  return (s_seed >> 8) & 0xffffff;
+}
+
+static int bench_vfs_open(sqlite3_vfs* vfs, const char* path, sqlite3_file* file) {
+  int flags = SQLITE_OPEN_MAIN_DB | SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+
+  memset(file, 0, vfs->szOsFile);
+  return vfs->xOpen(vfs, path, file, flags, &flags);
+}
+
+static void bench_vfs_run(const char* vfs_name, const char* path, uint32_t loops) {
+  uint32_t i;
+  int out = 0;
+  uint64_t start = 0;
+  char variant[32];
+  char* page = NULL;
+  sqlite3_file* file = NULL;
+  sqlite3_vfs* vfs = sqlite3_vfs_find(vfs_name);
+
+  if (vfs == NULL) {
+    return;
+  }
+
+  page = (char*)TKMEM_ALLOC(BENCH_VFS_PAGE_SIZE);
+  file = (sqlite3_file*)TKMEM_ALLOC(vfs->szOsFile);
+  memset(page, 0x5a, BENCH_VFS_PAGE_SIZE);
+  tk_snprintf(variant, sizeof(variant), "vfs_%s", vfs_name);
+
+  vfs->xDelete(vfs, path, 0);
+  if (bench_vfs_open(vfs, path, file) != SQLITE_OK) {
+    log_info("bench_vfs: open %s with %s failed\n", path, vfs_name);
+    TKMEM_FREE(file);
+    TKMEM_FREE(page);
+    return;
+  }
+
+  for (i = 0; i < BENCH_VFS_PAGES; i++) {
+    sqlite3_int64 offset = (sqlite3_int64)i * BENCH_VFS_PAGE_SIZE;
+    file->pMethods->xWrite(file, page, BENCH_VFS_PAGE_SIZE, offset);
+  }
+  file->pMethods->xSync(file, SQLITE_SYNC_NORMAL);
+
+  start = bench_now_us();
+  for (i = 0; i < loops; i++) {
+    sqlite3_int64 offset = (sqlite3_int64)(i % BENCH_VFS_PAGES) * BENCH_VFS_PAGE_SIZE;
+    file->pMethods->xRead(file, page, BENCH_VFS_PAGE_SIZE, offset);
+  }
+  bench_report("vfs_read_seq", variant, loops, bench_now_us() - start);
+
+  s_seed = 1;
+  start = bench_now_us();
+  for (i = 0; i < loops; i++) {
+    sqlite3_int64 offset = (sqlite3_int64)(bench_vfs_rand() % BENCH_VFS_PAGES);
+    offset *= BENCH_VFS_PAGE_SIZE;
+    file->pMethods->xRead(file, page, BENCH_VFS_PAGE_SIZE, offset);
+  }
+  bench_report("vfs_read_rand", variant, loops, bench_now_us() - start);
+
+  s_seed = 1;
+  start = bench_now_us();
+  for (i = 0; i < loops; i++) {
+    sqlite3_int64 offset = (sqlite3_int64)(bench_vfs_rand() % BENCH_VFS_PAGES);
+    offset *= BENCH_VFS_PAGE_SIZE;
+    file->pMethods->xWrite(file, page, BENCH_VFS_PAGE_SIZE, offset);
+  }
+  bench_report("vfs_write", variant, loops, bench_now_us() - start);
+
+  start = bench_now_us();
+  for (i = 0; i < BENCH_VFS_SYNC_LOOPS; i++) {
+    file->pMethods->xWrite(file, page, BENCH_VFS_PAGE_SIZE, 0);
+    file->pMethods->xSync(file, SQLITE_SYNC_NORMAL);
+  }
+  bench_report("vfs_write_sync", variant, BENCH_VFS_SYNC_LOOPS, bench_now_us() - start);
+
+  start = bench_now_us();
+  for (i = 0; i < loops; i++) {
+    file->pMethods->xLock(file, SQLITE_LOCK_SHARED);
+    file->pMethods->xUnlock(file, SQLITE_LOCK_NONE);
+  }
+  bench_report("vfs_lock_unlock", variant, loops, bench_now_us() - start);
+
+  file->pMethods->xClose(file);
+
+  start = bench_now_us();
+  for (i = 0; i < loops / 10; i++) {
+    if (bench_vfs_open(vfs, path, file) == SQLITE_OK) {
+      file->pMethods->xClose(file);
+    }
+  }
+  bench_report("vfs_open_close", variant, loops / 10, bench_now_us() - start);
+
+  start = bench_now_us();
+  for (i = 0; i < loops; i++) {
+    vfs->xAccess(vfs, path, SQLITE_ACCESS_EXISTS, &out);
+  }
+  bench_report("vfs_access", variant, loops, bench_now_us() - start);
+
+  vfs->xDelete(vfs, path, 0);
+  TKMEM_FREE(file);
+  TKMEM_FREE(page);
+}
+
+#if defined(WIN32) || defined(_WIN32)
+static void bench_vfs_run_syscall(const char* path, uint32_t loops) {
+}
+#else
+#include <fcntl.h>
+#include <unistd.h>
+
+/* what the unix VFS does for a SHARED lock: a read lock on the shared byte range */
+static int bench_vfs_fcntl_lock(int fd, short type) {
+  struct flock lock;
+
+  memset(&lock, 0, sizeof(lock));
+  lock.l_type = type;
+  lock.l_whence = SEEK_SET;
+  lock.l_start = 0x40000000 + 2;
+  lock.l_len = 510;
+
+  return fcntl(fd, F_SETLK, &lock);
+}
+
+static void bench_vfs_run_syscall(const char* path, uint32_t loops) {
+  int fd = 0;
+  uint32_t i;
+  uint64_t start = 0;
+  char page[BENCH_VFS_PAGE_SIZE];
+
+  memset(page, 0x5a, sizeof(page));
+  unlink(path);
+  fd = open(path, O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    log_info("bench_vfs: open %s failed\n", path);
+    return;
+  }
+
+  for (i = 0; i < BENCH_VFS_PAGES; i++) {
+    pwrite(fd, page, sizeof(page), (off_t)i * sizeof(page));
+  }
+  fsync(fd);
+
+  start = bench_now_us();
+  for (i = 0; i < loops; i++) {
+    pread(fd, page, sizeof(page), (off_t)(i % BENCH_VFS_PAGES) * sizeof(page));
+  }
+  bench_report("vfs_read_seq", "syscall", loops, bench_now_us() - start);
+
+  s_seed = 1;
+  start = bench_now_us();
+  for (i = 0; i < loops; i++) {
+    pread(fd, page, sizeof(page), (off_t)(bench_vfs_rand() % BENCH_VFS_PAGES) * sizeof(page));
+  }
+  bench_report("vfs_read_rand", "syscall", loops, bench_now_us() - start);
+
+  s_seed = 1;
+  start = bench_now_us();
+  for (i = 0; i < loops; i++) {
+    pwrite(fd, page, sizeof(page), (off_t)(bench_vfs_rand() % BENCH_VFS_PAGES) * sizeof(page));
+  }
+  bench_report("vfs_write", "syscall", loops, bench_now_us() - start);
+
+  start = bench_now_us();
+  for (i = 0; i < BENCH_VFS_SYNC_LOOPS; i++) {
+    pwrite(fd, page, sizeof(page), 0);
+    fsync(fd);
+  }
+  bench_report("vfs_write_sync", "syscall", BENCH_VFS_SYNC_LOOPS, bench_now_us() - start);
+
+  start = bench_now_us();
+  for (i = 0; i < loops; i++) {
+    bench_vfs_fcntl_lock(fd, F_RDLCK);
+    bench_vfs_fcntl_lock(fd, F_UNLCK);
+  }
+  bench_report("vfs_lock_unlock", "syscall", loops, bench_now_us() - start);
+
+  close(fd);
+
+  start = bench_now_us();
+  for (i = 0; i < loops / 10; i++) {
+    fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+  bench_report("vfs_open_close", "syscall", loops / 10, bench_now_us() - start);
+
+  start = bench_now_us();
+  for (i = 0; i < loops; i++) {
+    access(path, F_OK);
+  }
+  bench_report("vfs_access", "syscall", loops, bench_now_us() - start);
+
+  unlink(path);
+}
+#endif /*WIN32*/
+
+int main(int argc, char* argv[]) {
+  const char* path = argc > 1 ? argv[1] : "bench_vfs.bin";
+  uint32_t loops = argc > 2 ? (uint32_t)atoi(argv[2]) : BENCH_VFS_LOOPS;
+
+  platform_prepare();
+  sqlite3_initialize();
+
+  bench_vfs_run("awtk", path, loops);
+  if (sqlite3_vfs_find("unix") != NULL) {
+    bench_vfs_run("unix", path, loops);
+  } else if (bench_posix_vfs_register() == SQLITE_OK) {
+    bench_vfs_run("posix", path, loops);
+  }
+  bench_vfs_run_syscall(path, loops);
+
+  sqlite3_shutdown();
+
+  return 0;
+}
@@ -0,0 +1,39 @@
+#include "sqlite3.h"
+#include "sqlite3_awtk.h"
+#include "tkc/utils.h"
+#include "tkc/platform.h"
+
+/*
+ * run SQL on a database and log each loop of its plan with the estimated
+ * rows, the rows actually visited, the loop count and the index used, e.g.
+ *   explain_analyze data/test.db "SELECT * FROM t1, t2 WHERE t1.a = t2.b;"
+ * needs a build with SQLITE_ENABLE_STMT_SCANSTATUS (SQLITE_PROFILE=profiling).
+ */
+int main(int argc, char* argv[]) {
+  int rc = SQLITE_OK;
+  sqlite3* db = NULL;
+
+  platform_prepare();
+
+  if (argc < 3) {
+    log_info("usage: %s db sql\n", argv[0]);
+    return 1;
+  }
+
+  sqlite3_initialize();
+  rc = sqlite3_open_v2(argv[1], &db, SQLITE_OPEN_READWRITE, NULL);
+  if (rc == SQLITE_OK) {
+#ifdef SQLITE_ENABLE_STMT_SCANSTATUS
+    rc = sqlite3_awtk_explain_analyze(db, argv[2]);
+#else
+    log_info("explain_analyze: build with SQLITE_PROFILE=profiling\n");
+    rc = SQLITE_ERROR;
+#endif
+  } else {
+    log_info("open %s: %s\n", argv[1], sqlite3_errmsg(db));
+  }
+  sqlite3_close(db);
+  sqlite3_shutdown();
+
+  return rc == SQLITE_OK ? 0 : 1;
+}
@@ -1,4 +1,5 @@
 ﻿#include "sqlite3.h"
+#include "sqlite3_awtk.h"
 #include "tkc/types_def.h"
 
 static int dump_table(void* data, int argc, char** argv, char** azColName) {
@@ -27,8 +28,46 @@ void sqlite3_exec_sql(sqlite3* db, const char* sql) {
 }
 
 static const char* sql_select = "SELECT * from COMPANY;";
-static const char* sql_insert = "INSERT INTO COMPANY (ID,NAME,AGE,ADDRESS,SALARY) VALUES (1234,'abc', 32, 'California', 20000.00 ); ";
-static const char* sql_delete = "DELETE from COMPANY where NAME='abc';";
+static const char* sql_insert = "INSERT INTO COMPANY (ID,NAME,AGE,ADDRESS,SALARY) VALUES (?,?,?,?,?);";
+static const char* sql_delete = "DELETE from COMPANY where NAME=?;";
+
+/*
+ * statements that run often: take the prepared statement from the cache and
+ * bind the values, instead of formatting them into SQL that sqlite3_exec()
+ * parses again on every call.
+ */
+static int sqlite3_insert_company(sqlite3* db, int id, const char* name, int age,
+                                  const char* address, double salary) {
+  sqlite3_stmt* stmt = NULL;
+  int rc = sqlite3_awtk_prepare_cached(db, sql_insert, &stmt);
+
+  if (rc == SQLITE_OK) {
+    sqlite3_bind_int(stmt, 1, id);
+    sqlite3_bind_text(stmt, 2, name, -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 3, age);
+    sqlite3_bind_text(stmt, 4, address, -1, SQLITE_STATIC);
+    sqlite3_bind_double(stmt, 5, salary);
+    rc = sqlite3_step(stmt);
+    sqlite3_awtk_stmt_release(stmt);
+  }
+  log_info("insert %s: %s\n", name, rc == SQLITE_DONE ? "done" : sqlite3_errmsg(db));
+
+  return rc == SQLITE_DONE ? SQLITE_OK : rc;
+}
+
+static int sqlite3_delete_company(sqlite3* db, const char* name) {
+  sqlite3_stmt* stmt = NULL;
+  int rc = sqlite3_awtk_prepare_cached(db, sql_delete, &stmt);
+
+  if (rc == SQLITE_OK) {
+    sqlite3_bind_text(stmt, 1, name, -1, SQLITE_STATIC);
+    rc = sqlite3_step(stmt);
+    sqlite3_awtk_stmt_release(stmt);
+  }
+  log_info("delete %s: %s\n", name, rc == SQLITE_DONE ? "done" : sqlite3_errmsg(db));
+
+  return rc == SQLITE_DONE ? SQLITE_OK : rc;
+}
 
 int sqlite3_demo(const char* db_filename) {
   int rc = 0;
@@ -42,9 +81,9 @@ int sqlite3_demo(const char* db_filename) {
   } else {
     log_warn("Opened database successfully:%s\n", db_filename);
 
-    sqlite3_exec_sql(db, sql_insert);
+    sqlite3_insert_company(db, 1234, "abc", 32, "California", 20000.00);
     sqlite3_exec_sql(db, sql_select);
-    sqlite3_exec_sql(db, sql_delete);
+    sqlite3_delete_company(db, "abc");
     sqlite3_exec_sql(db, sql_select);
   }
   sqlite3_close(db);
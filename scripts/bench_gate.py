@@ -0,0 +1,196 @@
+#!/usr/bin/env python3
+# Benchmark regression gate: build one SQLite profile, run the benchmarks
+# several times and compare the median of every metric with the baseline
+# checked in as scripts/bench_baselines/<profile>.json.
+#
+#   python3 scripts/bench_gate.py [--profile p] [--runs n] [--threshold pct] [scons args...]
+#   python3 scripts/bench_gate.py --update        (write the baseline from this run)
+#   scons bench_gate [SQLITE_PROFILE=p] [BENCH_GATE_RUNS=n]
+#
+# A metric regresses when its median is worse than the baseline median by
+# more than the threshold and its whole confidence interval is on the worse
+# side of the baseline, so a single noisy run does not fail the gate (it is
+# listed as "noisy", more --runs narrow the interval). The exit code is 1 on
+# a regression, when a baseline metric is missing or when the baseline file
+# does not exist. Baselines are machine specific, so the ones checked in are
+# empty placeholders: an empty baseline prints the measurements and a
+# warning and passes. Record one with --update on the box that runs the gate.
+import argparse
+import json
+import math
+import os
+import platform
+import sys
+
+import bench_matrix
+
+ROOT = bench_matrix.ROOT
+BASELINE_DIR = os.path.join(ROOT, 'scripts', 'bench_baselines')
+
+# everything else (latency, bytes, busy counts) is better when lower
+HIGHER_IS_BETTER = ['ops_per_sec', 'hit_pct']
+LATENCIES = ['p50_us', 'p90_us', 'p99_us']
+
+
+def metrics_of(r):
+    """(name, value) pairs of one JSON line printed by bench_common.c"""
+    key = r['bench'] + '/' + r['variant'] + '/'
+    if 'ops_per_sec' in r:
+        return [(key + 'ops_per_sec', r['ops_per_sec'])]
+    if 'metric' in r:
+        return [(key + r['metric'], r['value'])]
+    # max_us is one sample, too noisy to gate on
+    return [(key + m, r[m]) for m in LATENCIES if m in r]
+
+
+def median(values):
+    v = sorted(values)
+    n = len(v)
+    return v[n // 2] if n % 2 else (v[n // 2 - 1] + v[n // 2]) / 2.0
+
+
+def median_ci(values, confidence=0.95):
+    """distribution free confidence interval of the median (order statistics),
+    min..max when there are too few runs to reach the confidence"""
+    v = sorted(values)
+    n = len(v)
+    k = 0
+    # largest k with P(B < k) + P(B > n - 1 - k) <= 1 - confidence, B ~ Bin(n, 1/2)
+    while k + 1 < n - 1 - k:
+        tail = sum(math.comb(n, i) for i in range(k + 1)) / 2.0 ** n
+        if 2 * tail > 1 - confidence:
+            break
+        k += 1
+    return v[k], v[n - 1 - k]
+
+
+def measure(profile, benches, runs):
+    samples = {}
+    results = []
+    for i in range(runs):
+        print('== run %d/%d' % (i + 1, runs))
+        for bench in benches:
+            for r in bench_matrix.run(profile, bench):
+                r['run'] = i
+                results.append(r)
+                for name, value in metrics_of(r):
+                    samples.setdefault(name, []).append(float(value))
+
+    stats = {}
+    for name, values in samples.items():
+        lo, hi = median_ci(values)
+        stats[name] = {'median': median(values), 'lo': lo, 'hi': hi, 'n': len(values)}
+    return stats, results
+
+
+def compare(baseline, current, threshold):
+    """rows of (status, name, baseline, current, change_pct), worst first"""
+    rows = []
+    for name in sorted(set(baseline) | set(current)):
+        if name not in current:
+            rows.append(('MISSING', name, baseline[name], None, None))
+            continue
+        if name not in baseline:
+            rows.append(('new', name, None, current[name], None))
+            continue
+
+        base = baseline[name]['median']
+        cur = current[name]
+        higher = name.rsplit('/', 1)[1] in HIGHER_IS_BETTER
+        # positive change is always "worse"
+        worse = base - cur['median'] if higher else cur['median'] - base
+        change = 100.0 * worse / abs(base) if base else (math.inf if worse > 0 else 0.0)
+        ci_worse = cur['hi'] < base if higher else cur['lo'] > base
+
+        if change > threshold and ci_worse:
+            status = 'REGRESSED'
+        elif change > threshold:
+            status = 'noisy'
+        elif change < -threshold:
+            status = 'improved'
+        else:
+            status = 'ok'
+        rows.append((status, name, baseline[name], cur, change))
+
+    order = {'REGRESSED': 0, 'MISSING': 1, 'noisy': 2, 'improved': 3, 'new': 4, 'ok': 5}
+    rows.sort(key=lambda row: (order[row[0]], row[1]))
+    return rows
+
+
+def fmt(v):
+    return '%.4g' % v if v is not None else '-'
+
+
+def report(rows, threshold):
+    print('%-10s %-50s %12s %12s %25s %9s' % ('status', 'metric', 'baseline', 'median', 'ci',
+                                              'worse'))
+    for status, name, base, cur, change in rows:
+        ci = '[%s, %s]' % (fmt(cur['lo']), fmt(cur['hi'])) if cur else '-'
+        worse = '%+.1f%%' % change if change is not None and math.isfinite(change) else '-'
+        print('%-10s %-50s %12s %12s %25s %9s' % (status, name, fmt(base and base['median']),
+                                                  fmt(cur and cur['median']), ci, worse))
+
+    bad = [row for row in rows if row[0] in ['REGRESSED', 'MISSING']]
+    if bad:
+        print('\n%d metric(s) regressed by more than %g%% or are missing:' % (len(bad), threshold))
+        for status, name, base, cur, change in bad:
+            if cur:
+                print('  %s: %s -> %s (%s%% worse, ci %s..%s)' %
+                      (name, fmt(base['median']), fmt(cur['median']),
+                       '%.1f' % change if math.isfinite(change) else 'inf', fmt(cur['lo']),
+                       fmt(cur['hi'])))
+            else:
+                print('  %s: no result, benchmark not built or failed' % name)
+    return not bad
+
+
+def main():
+    parser = argparse.ArgumentParser(description='fail when a benchmark regresses against its baseline')
+    parser.add_argument('--profile', default='embedded-default', help='SQLITE_PROFILE to build')
+    parser.add_argument('--benches', default=','.join(bench_matrix.BENCHES))
+    parser.add_argument('--runs', type=int, default=5, help='runs of every benchmark')
+    parser.add_argument('--threshold', type=float, default=10.0, help='allowed regression in percent')
+    parser.add_argument('--baseline', help='default scripts/bench_baselines/<profile>.json')
+    parser.add_argument('--update', action='store_true', help='write the baseline instead of comparing')
+    parser.add_argument('--no-build', action='store_true', help='use the programs already in bin/')
+    parser.add_argument('--out', default='bench_gate.jsonl')
+    parser.add_argument('scons_args', nargs='*', help='passed to scons, e.g. LINUX_FB=true')
+    args = parser.parse_args()
+
+    path = args.baseline or os.path.join(BASELINE_DIR, args.profile + '.json')
+    if not args.no_build and not bench_matrix.build(args.profile, args.scons_args):
+        print('== build ' + args.profile + ' failed')
+        return 1
+
+    current, results = measure(args.profile, args.benches.split(','), max(args.runs, 1))
+    with open(args.out, 'w') as f:
+        for r in results:
+            f.write(json.dumps(r) + '\n')
+
+    if args.update:
+        with open(path, 'w') as f:
+            json.dump({'profile': args.profile, 'runs': args.runs, 'host': platform.node(),
+                       'machine': platform.machine(), 'metrics': current}, f, indent=2, sort_keys=True)
+            f.write('\n')
+        print('baseline of %d metrics written to %s' % (len(current), path))
+        return 0
+
+    if not os.path.exists(path):
+        print('no baseline ' + path + ', record one with --update')
+        return 1
+    with open(path) as f:
+        baseline = json.load(f)
+    if not baseline.get('metrics'):
+        # the checked in placeholders: show what was measured, gate nothing
+        report(compare({}, current, args.threshold), args.threshold)
+        print('\nwarning: baseline ' + path + ' is empty, nothing was gated; record one with '
+              '--update on this machine')
+        return 0
+
+    print('== compare with ' + path + ' (%s, %s)' % (baseline.get('host', '?'),
+                                                      baseline.get('machine', '?')))
+    return 0 if report(compare(baseline['metrics'], current, args.threshold), args.threshold) else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+# Build every SQLite profile (see src/sqlite_config_awtk.h) and run the same
+# benchmarks against each one.
+#
+#   python3 scripts/bench_matrix.py [--profiles a,b] [--benches x,y] [--out file]
+#
+# Every JSON line a benchmark prints is written to the output file with the
+# profile added, and a throughput table per profile is printed at the end.
+import argparse
+import json
+import multiprocessing
+import os
+import subprocess
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+PROFILES = ['mcu-small', 'embedded-default', 'linux-throughput']
+BENCHES = ['bench_speedtest', 'bench_vfs', 'bench_mem', 'bench_threadsafe', 'bench_pcache', 'bench_create_index',
+           'bench_concurrency', 'bench_startup', 'bench_stmt_cache']
+
+# keep the default matrix short enough to run on a board
+BENCH_ARGS = {
+    'bench_concurrency': ['bench_concurrency.db', 'delete_busy100', '4', '1', '2000', 'DELETE', '100', '0'],
+    'bench_create_index': ['bench_create_index.db', '1000000'],
+    'bench_pcache': ['bench_pcache.db'],
+    'bench_speedtest': ['speedtest', '10000'],
+    'bench_stmt_cache': ['bench_stmt_cache.db', '5000'],
+}
+
+
+def build(profile, scons_args):
+    # the pool is only installed by bench_mem, which compares it with the default allocator
+    cmd = ['scons', '-j%d' % multiprocessing.cpu_count(), 'SQLITE_PROFILE=' + profile,
+           'SQLITE_MEM_POOL=1'] + scons_args
+    print('== build ' + profile + ': ' + ' '.join(cmd))
+    return subprocess.call(cmd, cwd=ROOT) == 0
+
+
+def run(profile, bench):
+    exe = os.path.join(ROOT, 'bin', bench)
+    if not os.path.exists(exe):
+        print('== skip ' + bench + ': not built')
+        return []
+
+    print('== run ' + bench + ' (' + profile + ')')
+    out = subprocess.run([exe] + BENCH_ARGS.get(bench, []), cwd=ROOT, stdout=subprocess.PIPE,
+                         universal_newlines=True).stdout
+    results = []
+    for line in out.splitlines():
+        try:
+            r = json.loads(line)
+        except ValueError:
+            continue
+        r['profile'] = profile
+        results.append(r)
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description='benchmark every SQLite build profile')
+    parser.add_argument('--profiles', default=','.join(PROFILES))
+    parser.add_argument('--benches', default=','.join(BENCHES))
+    parser.add_argument('--out', default='bench_matrix.jsonl')
+    parser.add_argument('scons_args', nargs='*', help='passed to scons, e.g. LINUX_FB=true')
+    args = parser.parse_args()
+
+    profiles = args.profiles.split(',')
+    results = []
+    for profile in profiles:
+        if not build(profile, args.scons_args):
+            print('== build ' + profile + ' failed')
+            return 1
+        for bench in args.benches.split(','):
+            results += run(profile, bench)
+
+    with open(args.out, 'w') as f:
+        for r in results:
+            f.write(json.dumps(r) + '\n')
+
+    table = {}
+    for r in results:
+        if 'ops_per_sec' in r:
+            table.setdefault((r['bench'], r['variant']), {})[r['profile']] = r['ops_per_sec']
+
+    print('%-40s' % 'ops/s' + ''.join('%18s' % p for p in profiles))
+    for key in sorted(table):
+        row = table[key]
+        print('%-40s' % '/'.join(key) + ''.join('%18s' % ('%.0f' % row[p] if p in row else '-')
+                                               for p in profiles))
+    print('results written to ' + args.out)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+# Profile-guided (and optionally link-time) optimized build of sqlite3.c,
+# which includes the awtk VFS and mutex layers.
+#
+#   python3 scripts/pgo_build.py [--lto] [--out file] [scons args...]
+#
+# 1. plain build, run the benchmarks          (baseline)
+# 2. SQLITE_PGO=gen build, run the training workload
+# 3. SQLITE_PGO=use build, run the benchmarks (optimized)
+# and print the speedup of every benchmark. The tree is left with the
+# optimized build. gcc and clang are supported; clang profiles are merged
+# with llvm-profdata.
+import argparse
+import glob
+import json
+import os
+import shutil
+import subprocess
+import sys
+
+import bench_matrix
+
+ROOT = bench_matrix.ROOT
+PGO_DIR = os.path.join(ROOT, 'build', 'pgo')
+
+# the training run is the same demo set with bigger inputs than the measured run
+TRAIN_ARGS = {
+    'bench_create_index': ['bench_create_index.db', '2000000'],
+    'bench_pcache': ['bench_pcache.db'],
+    'bench_mem': ['50000'],
+    'bench_threadsafe': ['500000'],
+    'bench_speedtest': ['speedtest_train', '100000'],
+}
+
+
+def scons(args):
+    cmd = ['scons', '-j%d' % os.cpu_count(), 'SQLITE_PGO_DIR=' + PGO_DIR] + args
+    print('== ' + ' '.join(cmd))
+    return subprocess.call(cmd, cwd=ROOT) == 0
+
+
+def measure(label, benches, profile):
+    results = []
+    for bench in benches:
+        for r in bench_matrix.run(profile, bench):
+            r['build'] = label
+            results.append(r)
+    return results
+
+
+def train(benches):
+    for bench in benches:
+        exe = os.path.join(ROOT, 'bin', bench)
+        if os.path.exists(exe):
+            print('== train ' + bench)
+            subprocess.call([exe] + TRAIN_ARGS.get(bench, []), cwd=ROOT, stdout=subprocess.DEVNULL)
+
+    raws = glob.glob(os.path.join(PGO_DIR, '*.profraw'))
+    if raws:
+        profdata = shutil.which('llvm-profdata') or 'llvm-profdata'
+        out = os.path.join(PGO_DIR, 'default.profdata')
+        return subprocess.call([profdata, 'merge', '-o', out] + raws) == 0
+    return True
+
+
+def main():
+    parser = argparse.ArgumentParser(description='PGO/LTO build trained on the benchmarks')
+    parser.add_argument('--lto', action='store_true', help='also use link-time optimization')
+    parser.add_argument('--profile', default='embedded-default', help='SQLITE_PROFILE to build')
+    parser.add_argument('--benches', default=','.join(bench_matrix.BENCHES))
+    parser.add_argument('--out', default='bench_pgo.jsonl')
+    parser.add_argument('scons_args', nargs='*')
+    args = parser.parse_args()
+
+    benches = args.benches.split(',')
+    common = ['SQLITE_PROFILE=' + args.profile] + args.scons_args
+    lto = ['SQLITE_LTO=1'] if args.lto else []
+
+    if not scons(common):
+        return 1
+    baseline = measure('baseline', benches, args.profile)
+
+    shutil.rmtree(PGO_DIR, ignore_errors=True)
+    os.makedirs(PGO_DIR)
+    if not scons(common + lto + ['SQLITE_PGO=gen']) or not train(benches):
+        return 1
+
+    if not scons(common + lto + ['SQLITE_PGO=use']):
+        return 1
+    optimized = measure('pgo_lto' if args.lto else 'pgo', benches, args.profile)
+
+    with open(args.out, 'w') as f:
+        for r in baseline + optimized:
+            f.write(json.dumps(r) + '\n')
+
+    base = {(r['bench'], r['variant']): r['ops_per_sec'] for r in baseline if 'ops_per_sec' in r}
+    print('%-40s %14s %14s %8s' % ('benchmark', 'baseline', 'optimized', 'speedup'))
+    for r in optimized:
+        key = (r['bench'], r['variant'])
+        if 'ops_per_sec' in r and base.get(key):
+            print('%-40s %14.0f %14.0f %7.2fx' % ('/'.join(key), base[key], r['ops_per_sec'],
+                                                 r['ops_per_sec'] / base[key]))
+    print('results written to ' + args.out)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,256 @@
+#ifdef SQLITE_ENABLE_MEMSYS5
+/*
+** Static-arena memory mode: SQLite runs inside one caller-supplied block of
+** RAM and never calls the system allocator.
+**
+** The arena is split into three regions:
+**   heap        SQLITE_CONFIG_HEAP (memsys5, power-of-two buddy allocator)
+**   page cache  SQLITE_CONFIG_PAGECACHE slots of szPage + PCACHE_HDRSZ bytes
+**   lookaside   one fixed slice per connection, see sqlite3_awtk_arena_attach()
+**
+** Global lookaside is turned off so that connections which are not attached
+** do not carve their lookaside out of the heap. Connections that get a slice
+** must be closed with sqlite3_awtk_arena_close(). The slice owners are
+** guarded by SQLITE_MUTEX_STATIC_VFS2, which the report holds while it reads
+** the connections' status (that takes their mutexes), so it is never taken
+** with a connection mutex held. Memory statistics are
+** turned on whatever SQLITE_DEFAULT_MEMSTATUS says: sizing the arena is the
+** point of this mode.
+*/
+#define AWTK_ARENA_ALIGN(n) (((n) + 7) & ~7)
+
+/* smallest memsys5 heap sqlite3_awtk_arena_init() accepts */
+#ifndef SQLITE_AWTK_ARENA_MIN_HEAP
+#define SQLITE_AWTK_ARENA_MIN_HEAP (16 * 1024)
+#endif /*SQLITE_AWTK_ARENA_MIN_HEAP*/
+
+/* owner of a slice whose connection is being closed */
+#define AWTK_ARENA_CLOSING ((sqlite3*)&_awtk_arena)
+
+static struct {
+  char* lookaside;  /* Start of the lookaside region */
+  sqlite3** owners; /* Connection using each lookaside slice, NULL, or AWTK_ARENA_CLOSING */
+  int nConn;
+  int szSlice; /* Bytes of one lookaside slice */
+  int szLookaside;
+  int nLookaside; /* Slots per slice */
+  sqlite3_int64 nHeap;
+  int szPageSlot;
+  int nPageSlot;
+  /* high-water marks folded in from closed connections */
+  sqlite3_int64 mxLookasideUsed;
+  sqlite3_int64 nLookasideMissFull;
+} _awtk_arena;
+
+SQLITE_API int sqlite3_awtk_arena_init(void* pArena, int nArena,
+                                       const sqlite3_awtk_arena_config* pConfig) {
+  int rc = SQLITE_OK;
+  int szHdr = 0;
+  int nPageCache = 0;
+  sqlite3_int64 szOwners = 0;
+  char* p = (char*)AWTK_ARENA_ALIGN((uptr)pArena);
+  char* end = (char*)pArena + nArena;
+  sqlite3_awtk_arena_config config = {50, 35, SQLITE_DEFAULT_PAGE_SIZE, 4, 128};
+
+  if (pConfig != NULL) {
+    config = *pConfig;
+  }
+
+  if (pArena == NULL || config.nHeapPct <= 0 || config.nPageCachePct < 0 ||
+      config.nHeapPct + config.nPageCachePct > 100 || config.nConn < 0 ||
+      config.szLookaside < 0 || config.szPage < 512 || nArena <= 0) {
+    return SQLITE_MISUSE;
+  }
+
+  /*
+  ** The page cache and lookaside take their share of what the connection
+  ** table leaves and round down, so the heap gets at least nHeapPct of it.
+  */
+  szOwners = AWTK_ARENA_ALIGN((sqlite3_int64)sizeof(sqlite3*) * config.nConn);
+  if (end - p < szOwners ||
+      (end - p - szOwners) * config.nHeapPct / 100 < SQLITE_AWTK_ARENA_MIN_HEAP) {
+    return SQLITE_NOMEM;
+  }
+
+  memset(&_awtk_arena, 0, sizeof(_awtk_arena));
+  sqlite3_config(SQLITE_CONFIG_PCACHE_HDRSZ, &szHdr);
+
+  /* connection table first, then page cache, lookaside and the heap last */
+  _awtk_arena.owners = (sqlite3**)p;
+  _awtk_arena.nConn = config.nConn;
+  p += szOwners;
+  memset(_awtk_arena.owners, 0, sizeof(sqlite3*) * config.nConn);
+  nArena = (int)(end - p);
+
+  _awtk_arena.szPageSlot = AWTK_ARENA_ALIGN(config.szPage + szHdr);
+  nPageCache = (int)((sqlite3_int64)nArena * config.nPageCachePct / 100);
+  _awtk_arena.nPageSlot = nPageCache / _awtk_arena.szPageSlot;
+  if (_awtk_arena.nPageSlot > 0) {
+    rc = sqlite3_config(SQLITE_CONFIG_PAGECACHE, p, _awtk_arena.szPageSlot,
+                        _awtk_arena.nPageSlot);
+    p += _awtk_arena.szPageSlot * _awtk_arena.nPageSlot;
+  }
+
+  if (rc == SQLITE_OK && config.nConn > 0 && config.szLookaside > 0) {
+    int nLookaside = (int)((sqlite3_int64)nArena * (100 - config.nHeapPct - config.nPageCachePct) /
+                           100);
+
+    _awtk_arena.szLookaside = AWTK_ARENA_ALIGN(config.szLookaside);
+    _awtk_arena.nLookaside = nLookaside / config.nConn / _awtk_arena.szLookaside;
+    _awtk_arena.szSlice = _awtk_arena.nLookaside * _awtk_arena.szLookaside;
+    _awtk_arena.lookaside = p;
+    p += _awtk_arena.szSlice * config.nConn;
+  }
+
+  if (rc == SQLITE_OK) {
+    rc = sqlite3_config(SQLITE_CONFIG_LOOKASIDE, 0, 0);
+  }
+
+  /* the heap high-water marks of the report stay 0 without memory statistics */
+  if (rc == SQLITE_OK) {
+    rc = sqlite3_config(SQLITE_CONFIG_MEMSTATUS, 1);
+  }
+
+  if (rc == SQLITE_OK) {
+    _awtk_arena.nHeap = end - p;
+    rc = sqlite3_config(SQLITE_CONFIG_HEAP, p, (int)_awtk_arena.nHeap, 32);
+  }
+
+  return rc;
+}
+
+SQLITE_API int sqlite3_awtk_arena_attach(sqlite3* db) {
+  int i;
+  int rc = SQLITE_FULL;
+  sqlite3_mutex* mutex = sqlite3_mutex_alloc(SQLITE_MUTEX_STATIC_VFS2);
+
+  if (_awtk_arena.szSlice == 0) {
+    return SQLITE_NOMEM;
+  }
+
+  sqlite3_mutex_enter(mutex);
+  for (i = 0; i < _awtk_arena.nConn; i++) {
+    if (_awtk_arena.owners[i] == NULL) {
+      rc = sqlite3_db_config(db, SQLITE_DBCONFIG_LOOKASIDE,
+                             _awtk_arena.lookaside + i * _awtk_arena.szSlice,
+                             _awtk_arena.szLookaside, _awtk_arena.nLookaside);
+      if (rc == SQLITE_OK) {
+        _awtk_arena.owners[i] = db;
+      }
+      break;
+    }
+  }
+  sqlite3_mutex_leave(mutex);
+
+  return rc;
+}
+
+static void _awtk_arena_db_stats(sqlite3* db, sqlite3_int64* mxUsed, sqlite3_int64* nMissFull) {
+  int cur = 0;
+  int hw = 0;
+
+  sqlite3_db_status(db, SQLITE_DBSTATUS_LOOKASIDE_USED, &cur, &hw, 0);
+  if (hw > *mxUsed) {
+    *mxUsed = hw;
+  }
+
+  sqlite3_db_status(db, SQLITE_DBSTATUS_LOOKASIDE_MISS_FULL, &cur, &hw, 0);
+  *nMissFull += hw;
+}
+
+/*
+** Close a connection set up with sqlite3_awtk_arena_attach(). Its lookaside
+** high-water marks are kept for the report, and its slice is handed to the
+** next connection only once the close succeeded.
+*/
+SQLITE_API int sqlite3_awtk_arena_close(sqlite3* db) {
+  int i;
+  int rc = SQLITE_OK;
+  int slice = -1;
+  sqlite3_int64 mxUsed = 0;
+  sqlite3_int64 nMissFull = 0;
+  sqlite3_mutex* mutex = sqlite3_mutex_alloc(SQLITE_MUTEX_STATIC_VFS2);
+
+  /* the report skips the slice while its connection closes */
+  sqlite3_mutex_enter(mutex);
+  for (i = 0; i < _awtk_arena.nConn; i++) {
+    if (db != NULL && _awtk_arena.owners[i] == db) {
+      slice = i;
+      _awtk_arena_db_stats(db, &mxUsed, &nMissFull);
+      _awtk_arena.owners[i] = AWTK_ARENA_CLOSING;
+      break;
+    }
+  }
+  sqlite3_mutex_leave(mutex);
+
+  rc = sqlite3_close(db);
+
+  if (slice >= 0) {
+    sqlite3_mutex_enter(mutex);
+    if (rc == SQLITE_OK) {
+      if (mxUsed > _awtk_arena.mxLookasideUsed) {
+        _awtk_arena.mxLookasideUsed = mxUsed;
+      }
+      _awtk_arena.nLookasideMissFull += nMissFull;
+      _awtk_arena.owners[slice] = NULL;
+    } else {
+      _awtk_arena.owners[slice] = db;
+    }
+    sqlite3_mutex_leave(mutex);
+  }
+
+  return rc;
+}
+
+SQLITE_API void sqlite3_awtk_arena_report_get(sqlite3_awtk_arena_report* pReport) {
+  int i;
+  sqlite3_int64 cur = 0;
+  sqlite3_mutex* mutex = sqlite3_mutex_alloc(SQLITE_MUTEX_STATIC_VFS2);
+
+  memset(pReport, 0, sizeof(*pReport));
+  pReport->nHeap = _awtk_arena.nHeap;
+  pReport->nPageSlot = _awtk_arena.nPageSlot;
+  pReport->szPageSlot = _awtk_arena.szPageSlot;
+  pReport->nLookaside = _awtk_arena.nLookaside;
+  pReport->szLookaside = _awtk_arena.szLookaside;
+
+  sqlite3_status64(SQLITE_STATUS_MEMORY_USED, &cur, &pReport->mxHeapUsed, 0);
+  sqlite3_status64(SQLITE_STATUS_MALLOC_SIZE, &cur, &pReport->mxMalloc, 0);
+  sqlite3_status64(SQLITE_STATUS_PAGECACHE_USED, &cur, &pReport->mxPageSlotUsed, 0);
+  sqlite3_status64(SQLITE_STATUS_PAGECACHE_OVERFLOW, &cur, &pReport->mxPageOverflow, 0);
+
+  sqlite3_mutex_enter(mutex);
+  pReport->mxLookasideUsed = _awtk_arena.mxLookasideUsed;
+  pReport->nLookasideMissFull = _awtk_arena.nLookasideMissFull;
+  for (i = 0; i < _awtk_arena.nConn; i++) {
+    if (_awtk_arena.owners[i] != NULL && _awtk_arena.owners[i] != AWTK_ARENA_CLOSING) {
+      _awtk_arena_db_stats(_awtk_arena.owners[i], &pReport->mxLookasideUsed,
+                           &pReport->nLookasideMissFull);
+    }
+  }
+  sqlite3_mutex_leave(mutex);
+}
+
+SQLITE_API void sqlite3_awtk_arena_dump(void) {
+  sqlite3_awtk_arena_report r;
+
+  sqlite3_awtk_arena_report_get(&r);
+
+  log_info("arena heap: %lld/%lld bytes peak, largest request %lld\n", (long long)r.mxHeapUsed,
+           (long long)r.nHeap, (long long)r.mxMalloc);
+  log_info("arena page cache: %lld/%d slots of %d bytes peak, %lld bytes overflowed to heap\n",
+           (long long)r.mxPageSlotUsed, r.nPageSlot, r.szPageSlot, (long long)r.mxPageOverflow);
+  log_info("arena lookaside: %lld/%d slots of %d bytes peak, %lld misses because full\n",
+           (long long)r.mxLookasideUsed, r.nLookaside, r.szLookaside,
+           (long long)r.nLookasideMissFull);
+
+  /*
+  ** memsys5 rounds every request up to a power of two, so the heap needs about
+  ** twice its measured peak to stay clear of fragmentation failures.
+  */
+  log_info("suggested: heap >= %lld, page cache >= %lld slots\n", (long long)r.mxHeapUsed * 2,
+           (long long)(r.mxPageSlotUsed + (r.mxPageOverflow + r.szPageSlot - 1) /
+                                             (r.szPageSlot > 0 ? r.szPageSlot : 1)));
+}
+
+#endif /* SQLITE_ENABLE_MEMSYS5 */
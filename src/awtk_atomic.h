@@ -0,0 +1,69 @@
+#ifndef _AWTK_ATOMIC_H_
+#define _AWTK_ATOMIC_H_
+/*
+* Minimal atomic operations used by the AWTK port (32-bit and 64-bit integers).
+*
+* AWTK_ATOMIC_CAS(p, o, n)  swap *p from o to n, return non-zero on success
+* AWTK_ATOMIC_XCHG(p, v)    store v into *p and return the previous value
+* AWTK_ATOMIC_ADD(p, v)     add v to *p and return the previous value
+* AWTK_ATOMIC_LOAD(p)       acquire load
+* AWTK_ATOMIC_STORE(p, v)   release store
+* AWTK_CPU_RELAX()          spin-wait hint
+* AWTK_THREAD_LOCAL         storage class of a per-thread variable
+*
+* All read-modify-write operations are full barriers. When no implementation
+* is available AWTK_ATOMIC_NONE is defined and callers must fall back to locks.
+* GCC counts only when it has a lock-free 4-byte CAS: on ARMv6-M (Cortex-M0)
+* it emits __sync_*_4 library calls that do not link.
+*
+* AWTK_THREAD_LOCAL is only defined where tk_thread is a native thread with
+* TLS (Linux, macOS, Windows); on RTOS targets it is left undefined and
+* callers look the thread up by tk_thread_self(). Define
+* SQLITE_AWTK_NO_THREAD_LOCAL to turn it off.
+*/
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_4)
+#define AWTK_ATOMIC_CAS(p, o, n) __sync_bool_compare_and_swap((p), (o), (n))
+#define AWTK_ATOMIC_XCHG(p, v) __atomic_exchange_n((p), (v), __ATOMIC_SEQ_CST)
+#define AWTK_ATOMIC_ADD(p, v) __sync_fetch_and_add((p), (v))
+#define AWTK_ATOMIC_LOAD(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define AWTK_ATOMIC_STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#if defined(__i386__) || defined(__x86_64__)
+#define AWTK_CPU_RELAX() __builtin_ia32_pause()
+#elif defined(__aarch64__) || (defined(__ARM_ARCH) && __ARM_ARCH >= 7)
+#define AWTK_CPU_RELAX() __asm__ __volatile__("yield" ::: "memory")
+#else
+#define AWTK_CPU_RELAX() __asm__ __volatile__("" ::: "memory")
+#endif
+#elif defined(_MSC_VER)
+#include <intrin.h>
+#define AWTK_ATOMIC_CAS(p, o, n)                                                      \
+  (sizeof(*(p)) == 8 ? _InterlockedCompareExchange64((volatile __int64*)(p), (n), (o)) == (o) \
+                     : _InterlockedCompareExchange((volatile long*)(p), (long)(n), (long)(o)) == (long)(o))
+#define AWTK_ATOMIC_XCHG(p, v)                                            \
+  (sizeof(*(p)) == 8 ? _InterlockedExchange64((volatile __int64*)(p), (v)) \
+                     : _InterlockedExchange((volatile long*)(p), (long)(v)))
+#define AWTK_ATOMIC_ADD(p, v)                                            \
+  (sizeof(*(p)) == 8 ? _InterlockedExchangeAdd64((volatile __int64*)(p), (v)) \
+                     : _InterlockedExchangeAdd((volatile long*)(p), (long)(v)))
+#define AWTK_ATOMIC_LOAD(p) \
+  (sizeof(*(p)) == 8 ? *(volatile __int64*)(p) : (__int64) * (volatile long*)(p))
+#define AWTK_ATOMIC_STORE(p, v) ((void)AWTK_ATOMIC_XCHG((p), (v)))
+#if defined(_M_IX86) || defined(_M_X64)
+#define AWTK_CPU_RELAX() _mm_pause()
+#else
+#define AWTK_CPU_RELAX() __yield()
+#endif
+#else
+#define AWTK_ATOMIC_NONE 1
+#endif
+
+#if !defined(AWTK_THREAD_LOCAL) && !defined(SQLITE_AWTK_NO_THREAD_LOCAL)
+#if defined(_MSC_VER)
+#define AWTK_THREAD_LOCAL __declspec(thread)
+#elif (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__linux__) || defined(__APPLE__) || defined(_WIN32))
+#define AWTK_THREAD_LOCAL __thread
+#endif
+#endif /*AWTK_THREAD_LOCAL*/
+
+#endif /*_AWTK_ATOMIC_H_*/
@@ -0,0 +1,74 @@
+#ifndef AWTK_BOOT_PROF_H
+#define AWTK_BOOT_PROF_H
+
+#ifdef SQLITE_AWTK_ENABLE_BOOT_PROF
+#include "tkc/time_now.h"
+
+/*
+** Boot-time phases of the port (awtk_boot_prof.h).
+**
+** Included by both awtk_mutex.h and awtk_vfs.h, whichever comes first in
+** sqlite3.c defines it. The mutex layer and sqlite3_os_init() time their own
+** init; sqlite3_awtk_boot_open() times the open and the schema parse of one
+** connection. Each phase keeps the time of its last run only.
+*/
+static const char* const _awtk_boot_names[SQLITE_AWTK_BOOT_N] = {
+    "mutex_init",
+    "os_init",
+    "open",
+    "schema",
+};
+
+static sqlite3_uint64 _awtk_boot_us[SQLITE_AWTK_BOOT_N];
+
+#define AWTK_BOOT_BEGIN() sqlite3_uint64 _awtk_boot_start = time_now_us()
+#define AWTK_BOOT_END(iPhase) _awtk_boot_us[iPhase] = time_now_us() - _awtk_boot_start
+
+SQLITE_API int sqlite3_awtk_boot_open(const char* zFilename, int flags, const char* zVfs,
+                                      sqlite3** ppDb) {
+  int rc = SQLITE_OK;
+  sqlite3_stmt* stmt = NULL;
+  sqlite3_uint64 start = time_now_us();
+
+  if (flags == 0) {
+    flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+  }
+
+  rc = sqlite3_open_v2(zFilename, ppDb, flags, zVfs);
+  _awtk_boot_us[SQLITE_AWTK_BOOT_OPEN] = time_now_us() - start;
+  if (rc != SQLITE_OK) {
+    return rc;
+  }
+
+  /* naming a table makes the prepare read and parse sqlite_master */
+  start = time_now_us();
+  rc = sqlite3_prepare_v2(*ppDb, "SELECT 1 FROM sqlite_master LIMIT 0;", -1, &stmt, NULL);
+  sqlite3_finalize(stmt);
+  _awtk_boot_us[SQLITE_AWTK_BOOT_SCHEMA] = time_now_us() - start;
+
+  return rc;
+}
+
+SQLITE_API sqlite3_int64 sqlite3_awtk_boot_get(int iPhase) {
+  if (iPhase < 0 || iPhase >= SQLITE_AWTK_BOOT_N) {
+    return -1;
+  }
+
+  return (sqlite3_int64)_awtk_boot_us[iPhase];
+}
+
+SQLITE_API void sqlite3_awtk_boot_dump(void) {
+  int i;
+
+  for (i = 0; i < SQLITE_AWTK_BOOT_N; i++) {
+    log_info("sqlite boot %-12s %8llu us\n", _awtk_boot_names[i],
+             (unsigned long long)_awtk_boot_us[i]);
+  }
+}
+
+#else
+#define AWTK_BOOT_BEGIN()
+#define AWTK_BOOT_END(iPhase)
+#endif /*SQLITE_AWTK_ENABLE_BOOT_PROF*/
+
+#endif /*AWTK_BOOT_PROF_H*/
@@ -0,0 +1,524 @@
+#ifndef AWTK_CHROME_TRACE_H
+#define AWTK_CHROME_TRACE_H
+
+#if defined(SQLITE_AWTK_ENABLE_CHROME_TRACE) && !defined(AWTK_ATOMIC_NONE)
+#include "tkc/time_now.h"
+#include "awtk_atomic.h"
+#include "awtk_trace.h"
+
+/*
+** Timeline tracer (awtk_chrome_trace.h).
+**
+** Statements of attached connections, VFS reads, writes, syncs and lock
+** calls, busy-handler sleeps and contended mutex waits are recorded as
+** complete events with a us timestamp, a duration and the thread they ran
+** on. sqlite3_awtk_chrome_trace_dump() writes them in the Chrome trace event
+** format, for chrome://tracing or Perfetto, next to the spans the
+** application adds with sqlite3_awtk_chrome_trace_event() (UI frames).
+**
+** Included by both awtk_mutex.h and awtk_vfs.h. The rings are built on the
+** first inclusion, the VFS events at the end of this file with awtk_vfs.h.
+**
+** Every thread writes to its own ring, claimed on its first event, so
+** recording takes no lock (the mutex layer records its own waits). Only the
+** newest SQLITE_AWTK_CHROME_TRACE_EVENTS events of each thread are kept.
+** A thread gives its ring back with sqlite3_awtk_chrome_trace_thread_end()
+** (SQLite's sorter workers do it as they exit); threads that find every one
+** of the SQLITE_AWTK_CHROME_TRACE_THREADS rings taken are counted, with
+** their events, as dropped. With AWTK_THREAD_LOCAL a thread keeps a pointer
+** to its ring, else it looks for it among the rings on each event.
+**
+** Only the owner writes a ring's head. sqlite3_awtk_chrome_trace_start()
+** bumps a generation instead of clearing the rings; the owner moves the
+** ring's base up to its head when it sees the new generation, so a writer
+** that was in the middle of an event never races with the reset.
+** Stopped, each hook costs one load and a branch. It needs the atomics of
+** awtk_atomic.h.
+*/
+#ifndef SQLITE_AWTK_CHROME_TRACE_THREADS
+#define SQLITE_AWTK_CHROME_TRACE_THREADS 4
+#endif /*SQLITE_AWTK_CHROME_TRACE_THREADS*/
+
+/* per thread, a power of two */
+#ifndef SQLITE_AWTK_CHROME_TRACE_EVENTS
+#define SQLITE_AWTK_CHROME_TRACE_EVENTS 512
+#endif /*SQLITE_AWTK_CHROME_TRACE_EVENTS*/
+
+#define AWTK_CTRACE_TEXT_LEN 28
+
+typedef enum _awtk_ctrace_kind_t {
+  AWTK_CTRACE_STMT = 0,
+  AWTK_CTRACE_READ,
+  AWTK_CTRACE_WRITE,
+  AWTK_CTRACE_SYNC,
+  AWTK_CTRACE_TRUNCATE,
+  AWTK_CTRACE_LOCK,
+  AWTK_CTRACE_BUSY_SLEEP,
+  AWTK_CTRACE_MUTEX_WAIT,
+  AWTK_CTRACE_APP,
+  AWTK_CTRACE_NKIND
+} awtk_ctrace_kind_t;
+
+typedef struct _awtk_ctrace_event_t {
+  uint64_t ts;  /* time_now_us() at the start */
+  int64_t arg0; /* Offset, mutex id */
+  uint32_t dur; /* us */
+  int32_t arg1; /* Size, lock level */
+  uint16_t kind;
+  int16_t rc;
+  char text[AWTK_CTRACE_TEXT_LEN]; /* SQL or span name, JSON safe */
+} awtk_ctrace_event_t;
+
+typedef struct _awtk_ctrace_ring_t {
+  volatile int32_t claimed;
+  volatile int32_t ready; /* tid belongs to the owner, lookups may match it */
+  uint64_t tid;
+  volatile uint32_t gen;  /* Recording generation base belongs to */
+  volatile uint32_t base; /* head as the generation or the owner began */
+  volatile uint32_t head; /* Events written so far, written by the owner only */
+  awtk_ctrace_event_t events[SQLITE_AWTK_CHROME_TRACE_EVENTS];
+} awtk_ctrace_ring_t;
+
+/* threads without a ring, each counted once (tid | 1) */
+#define AWTK_CTRACE_DROPPED_TIDS (2 * SQLITE_AWTK_CHROME_TRACE_THREADS)
+
+static struct {
+  volatile int32_t enabled;
+  volatile uint32_t gen;
+  volatile int32_t dropped;
+  volatile int32_t dropped_threads;
+  volatile int32_t dropped_tids[AWTK_CTRACE_DROPPED_TIDS];
+  awtk_ctrace_ring_t rings[SQLITE_AWTK_CHROME_TRACE_THREADS];
+} _awtk_ctrace;
+
+#ifdef AWTK_THREAD_LOCAL
+static AWTK_THREAD_LOCAL awtk_ctrace_ring_t* _awtk_ctrace_mine;
+#endif /*AWTK_THREAD_LOCAL*/
+
+static const char* const _awtk_ctrace_names[AWTK_CTRACE_NKIND][2] = {
+    {"stmt", "sql"},     {"read", "vfs"},       {"write", "vfs"},
+    {"sync", "vfs"},     {"truncate", "vfs"},   {"lock", "vfs"},
+    {"busy_sleep", "vfs"}, {"mutex_wait", "mutex"}, {"app", "app"},
+};
+
+#ifdef AWTK_THREAD_LOCAL
+static awtk_ctrace_ring_t* _awtk_ctrace_find(uint64_t tid) {
+  return _awtk_ctrace_mine;
+}
+#else
+static awtk_ctrace_ring_t* _awtk_ctrace_find(uint64_t tid) {
+  int i;
+
+  for (i = 0; i < SQLITE_AWTK_CHROME_TRACE_THREADS; i++) {
+    awtk_ctrace_ring_t* r = &_awtk_ctrace.rings[i];
+
+    if (AWTK_ATOMIC_LOAD(&r->ready) && r->tid == tid) {
+      return r;
+    }
+  }
+
+  return NULL;
+}
+#endif /*AWTK_THREAD_LOCAL*/
+
+/* Count a thread that found no free ring, once; a full table stops counting. */
+static void _awtk_ctrace_drop_thread(uint64_t tid) {
+  int i;
+  int32_t key = (int32_t)((uint32_t)tid | 1);
+
+  for (i = 0; i < AWTK_CTRACE_DROPPED_TIDS; i++) {
+    volatile int32_t* slot = &_awtk_ctrace.dropped_tids[i];
+
+    if (AWTK_ATOMIC_LOAD(slot) == key) {
+      return;
+    }
+    if (AWTK_ATOMIC_CAS(slot, 0, key)) {
+      AWTK_ATOMIC_ADD(&_awtk_ctrace.dropped_threads, 1);
+      return;
+    }
+    if (AWTK_ATOMIC_LOAD(slot) == key) {
+      return;
+    }
+  }
+}
+
+static awtk_ctrace_ring_t* _awtk_ctrace_ring(void) {
+  int i;
+  uint64_t tid = tk_thread_self();
+  awtk_ctrace_ring_t* r = _awtk_ctrace_find(tid);
+
+  if (r != NULL) {
+    return r;
+  }
+
+  for (i = 0; i < SQLITE_AWTK_CHROME_TRACE_THREADS; i++) {
+    r = &_awtk_ctrace.rings[i];
+
+    if (AWTK_ATOMIC_CAS(&r->claimed, 0, 1)) {
+      /* events of the last owner are not this thread's */
+      r->tid = tid;
+      AWTK_ATOMIC_STORE(&r->base, r->head);
+      AWTK_ATOMIC_STORE(&r->gen, AWTK_ATOMIC_LOAD(&_awtk_ctrace.gen));
+      AWTK_ATOMIC_STORE(&r->ready, 1);
+#ifdef AWTK_THREAD_LOCAL
+      _awtk_ctrace_mine = r;
+#endif /*AWTK_THREAD_LOCAL*/
+      return r;
+    }
+  }
+
+  _awtk_ctrace_drop_thread(tid);
+
+  return NULL;
+}
+
+/* Copy a prefix of text, without the characters JSON would need escaped. */
+static void _awtk_ctrace_text(char* out, const char* text) {
+  int i;
+
+  for (i = 0; text != NULL && text[i] != '\0' && i < AWTK_CTRACE_TEXT_LEN - 1; i++) {
+    char c = text[i];
+
+    out[i] = (c == '"' || c == '\\' || (unsigned char)c < 0x20) ? ' ' : c;
+  }
+
+  /* do not cut a UTF-8 sequence */
+  if (text != NULL && text[i] != '\0') {
+    while (i > 0 && ((unsigned char)out[i - 1] & 0xC0) == 0x80) {
+      i--;
+    }
+    if (i > 0 && ((unsigned char)out[i - 1] & 0x80) != 0) {
+      i--;
+    }
+  }
+  out[i] = '\0';
+}
+
+static void _awtk_ctrace_add(int kind, uint64_t start_us, uint64_t end_us, int64_t arg0,
+                             int32_t arg1, int rc, const char* text) {
+  uint32_t head;
+  awtk_ctrace_event_t* ev = NULL;
+  awtk_ctrace_ring_t* r = _awtk_ctrace_ring();
+  uint32_t gen = AWTK_ATOMIC_LOAD(&_awtk_ctrace.gen);
+
+  if (r == NULL) {
+    AWTK_ATOMIC_ADD(&_awtk_ctrace.dropped, 1);
+    return;
+  }
+
+  head = r->head;
+  /* the first event since start: older ones are not dumped */
+  if (r->gen != gen) {
+    AWTK_ATOMIC_STORE(&r->base, head);
+    AWTK_ATOMIC_STORE(&r->gen, gen);
+  }
+  ev = &r->events[head & (SQLITE_AWTK_CHROME_TRACE_EVENTS - 1)];
+  ev->ts = start_us;
+  ev->dur = (uint32_t)(end_us - start_us);
+  ev->kind = (uint16_t)kind;
+  ev->rc = (int16_t)rc;
+  ev->arg0 = arg0;
+  ev->arg1 = arg1;
+  _awtk_ctrace_text(ev->text, text);
+  AWTK_ATOMIC_STORE(&r->head, head + 1);
+}
+
+/* start is 0 when the tracer was stopped as the call began */
+#define AWTK_CTRACE_START(start) uint64_t start = AWTK_CTRACE_ON() ? time_now_us() : 0
+#define AWTK_CTRACE_END(kind, start, arg0, arg1, rc)                                \
+  if (start != 0) {                                                                \
+    _awtk_ctrace_add(kind, start, time_now_us(), arg0, arg1, rc, NULL);            \
+  }
+
+#define AWTK_CTRACE_ON() AWTK_ATOMIC_LOAD(&_awtk_ctrace.enabled)
+
+static int _awtk_ctrace_on_trace(unsigned mask, void* ctx, void* p, void* x) {
+  sqlite3_stmt* stmt = (sqlite3_stmt*)p;
+  uint64_t now = 0;
+
+  if (!AWTK_CTRACE_ON()) {
+    return 0;
+  }
+
+  now = time_now_us();
+  _awtk_ctrace_add(AWTK_CTRACE_STMT, now - _awtk_trace_run_us(stmt, x), now, 0, 0, SQLITE_OK,
+                   sqlite3_sql(stmt));
+
+  return 0;
+}
+
+/*
+** Start recording. Events recorded before are left out of the next dump;
+** threads still writing one see the new generation on their next event.
+*/
+SQLITE_API void sqlite3_awtk_chrome_trace_start(void) {
+  int i;
+
+  AWTK_ATOMIC_STORE(&_awtk_ctrace.enabled, 0);
+  AWTK_ATOMIC_ADD(&_awtk_ctrace.gen, 1);
+  for (i = 0; i < AWTK_CTRACE_DROPPED_TIDS; i++) {
+    AWTK_ATOMIC_STORE(&_awtk_ctrace.dropped_tids[i], 0);
+  }
+  AWTK_ATOMIC_STORE(&_awtk_ctrace.dropped_threads, 0);
+  AWTK_ATOMIC_STORE(&_awtk_ctrace.dropped, 0);
+  AWTK_ATOMIC_STORE(&_awtk_ctrace.enabled, 1);
+}
+
+SQLITE_API void sqlite3_awtk_chrome_trace_stop(void) {
+  AWTK_ATOMIC_STORE(&_awtk_ctrace.enabled, 0);
+}
+
+SQLITE_API int sqlite3_awtk_chrome_trace_attach(sqlite3* db) {
+  return sqlite3_awtk_trace_add(db, SQLITE_TRACE_PROFILE, _awtk_ctrace_on_trace, NULL);
+}
+
+SQLITE_API int sqlite3_awtk_chrome_trace_detach(sqlite3* db) {
+  return sqlite3_awtk_trace_remove(db, _awtk_ctrace_on_trace, NULL);
+}
+
+/*
+** Give the calling thread's ring back, before the thread exits. Its events
+** stay in the dump until another thread claims the ring.
+*/
+static void _awtk_ctrace_thread_end(void) {
+  awtk_ctrace_ring_t* r = _awtk_ctrace_find(tk_thread_self());
+
+  if (r != NULL) {
+    /* ready first: a lookup that matches the tid must find the ring still owned */
+    AWTK_ATOMIC_STORE(&r->ready, 0);
+    AWTK_ATOMIC_STORE(&r->claimed, 0);
+#ifdef AWTK_THREAD_LOCAL
+    _awtk_ctrace_mine = NULL;
+#endif /*AWTK_THREAD_LOCAL*/
+  }
+}
+
+#define AWTK_CTRACE_THREAD_END() _awtk_ctrace_thread_end()
+
+SQLITE_API void sqlite3_awtk_chrome_trace_thread_end(void) {
+  _awtk_ctrace_thread_end();
+}
+
+SQLITE_API void sqlite3_awtk_chrome_trace_event(const char* zName, sqlite3_int64 iStartUs,
+                                                sqlite3_int64 nDurUs) {
+  if (AWTK_CTRACE_ON()) {
+    _awtk_ctrace_add(AWTK_CTRACE_APP, (uint64_t)iStartUs, (uint64_t)(iStartUs + nDurUs), 0, 0,
+                     SQLITE_OK, zName);
+  }
+}
+
+static int _awtk_ctrace_write_event(fs_file_t* file, int tid, const awtk_ctrace_event_t* ev,
+                                    bool_t first) {
+  int n = 0;
+  char buf[256];
+  const char* name = _awtk_ctrace_names[ev->kind][0];
+  const char* cat = _awtk_ctrace_names[ev->kind][1];
+
+  if (ev->kind == AWTK_CTRACE_APP) {
+    name = ev->text;
+  }
+
+  n = tk_snprintf(buf, sizeof(buf),
+                  "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%u,"
+                  "\"pid\":1,\"tid\":%d,\"args\":{",
+                  first ? "" : ",\n", name, cat, (unsigned long long)ev->ts, ev->dur, tid);
+
+  switch (ev->kind) {
+    case AWTK_CTRACE_STMT:
+      n += tk_snprintf(buf + n, sizeof(buf) - n, "\"sql\":\"%s\"", ev->text);
+      break;
+    case AWTK_CTRACE_READ:
+    case AWTK_CTRACE_WRITE:
+      n += tk_snprintf(buf + n, sizeof(buf) - n, "\"offset\":%lld,\"size\":%d,\"rc\":%d",
+                       (long long)ev->arg0, ev->arg1, ev->rc);
+      break;
+    case AWTK_CTRACE_SYNC:
+      n += tk_snprintf(buf + n, sizeof(buf) - n, "\"flags\":%d,\"rc\":%d", ev->arg1, ev->rc);
+      break;
+    case AWTK_CTRACE_TRUNCATE:
+      n += tk_snprintf(buf + n, sizeof(buf) - n, "\"size\":%lld,\"rc\":%d", (long long)ev->arg0,
+                       ev->rc);
+      break;
+    case AWTK_CTRACE_LOCK:
+      n += tk_snprintf(buf + n, sizeof(buf) - n, "\"level\":%d,\"rc\":%d", ev->arg1, ev->rc);
+      break;
+    case AWTK_CTRACE_BUSY_SLEEP:
+      n += tk_snprintf(buf + n, sizeof(buf) - n, "\"requested_us\":%d,\"sleep_us\":%lld", ev->arg1,
+                       (long long)ev->arg0);
+      break;
+    case AWTK_CTRACE_MUTEX_WAIT:
+      n += tk_snprintf(buf + n, sizeof(buf) - n, "\"id\":%d", ev->arg1);
+      break;
+    default:
+      break;
+  }
+  n += tk_snprintf(buf + n, sizeof(buf) - n, "}}");
+
+  return fs_file_write(file, buf, n) == n ? SQLITE_OK : SQLITE_IOERR_WRITE;
+}
+
+/*
+** Write the recorded events to zPath as a Chrome trace. Recording goes on;
+** events overwritten while the dump reads a ring are left out.
+*/
+SQLITE_API int sqlite3_awtk_chrome_trace_dump(const char* zPath) {
+  int i;
+  int rc = SQLITE_OK;
+  int n = 0;
+  uint32_t gen = 0;
+  bool_t first = TRUE;
+  char buf[96];
+  char meta[160];
+  fs_file_t* file = fs_open_file(os_fs(), zPath, "wb");
+
+  if (file == NULL) {
+    return SQLITE_CANTOPEN;
+  }
+
+  tk_snprintf(buf, sizeof(buf), "{\"traceEvents\":[\n");
+  fs_file_write(file, buf, strlen(buf));
+
+  gen = AWTK_ATOMIC_LOAD(&_awtk_ctrace.gen);
+  for (i = 0; i < SQLITE_AWTK_CHROME_TRACE_THREADS && rc == SQLITE_OK; i++) {
+    uint32_t j, begin, head;
+    awtk_ctrace_ring_t* r = &_awtk_ctrace.rings[i];
+
+    /* gen before base: the owner stores base first */
+    if (AWTK_ATOMIC_LOAD(&r->gen) != gen) {
+      continue;
+    }
+    begin = AWTK_ATOMIC_LOAD(&r->base);
+    head = AWTK_ATOMIC_LOAD(&r->head);
+    if (head == begin) {
+      continue;
+    }
+
+    n = tk_snprintf(meta, sizeof(meta),
+                    "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                    "\"args\":{\"name\":\"thread %llu\"}}",
+                    first ? "" : ",\n", i + 1, (unsigned long long)r->tid);
+    fs_file_write(file, meta, n);
+    first = FALSE;
+
+    if (head - begin > SQLITE_AWTK_CHROME_TRACE_EVENTS) {
+      begin = head - SQLITE_AWTK_CHROME_TRACE_EVENTS;
+    }
+    for (j = begin; j != head && rc == SQLITE_OK; j++) {
+      awtk_ctrace_event_t ev = r->events[j & (SQLITE_AWTK_CHROME_TRACE_EVENTS - 1)];
+      /* a full barrier: the copy is done before head is read again */
+      uint32_t now = AWTK_ATOMIC_ADD(&r->head, 0);
+
+      /* the writer has come round to this slot while it was copied */
+      if (now - j >= SQLITE_AWTK_CHROME_TRACE_EVENTS) {
+        continue;
+      }
+
+      rc = _awtk_ctrace_write_event(file, i + 1, &ev, first);
+      first = FALSE;
+    }
+  }
+
+  tk_snprintf(buf, sizeof(buf), "\n],\"otherData\":{\"dropped\":%d,\"dropped_threads\":%d}}\n",
+              (int)AWTK_ATOMIC_LOAD(&_awtk_ctrace.dropped),
+              (int)AWTK_ATOMIC_LOAD(&_awtk_ctrace.dropped_threads));
+  fs_file_write(file, buf, strlen(buf));
+  fs_file_close(file);
+
+  return rc;
+}
+
+#else
+#define AWTK_CTRACE_START(start)
+#define AWTK_CTRACE_END(kind, start, arg0, arg1, rc)
+#define AWTK_CTRACE_THREAD_END()
+#endif /* SQLITE_AWTK_ENABLE_CHROME_TRACE */
+
+#endif /*AWTK_CHROME_TRACE_H*/
+
+/*
+** VFS events: io methods that time the methods selected so far
+** (AWTK_IO_METHOD, see awtk_commit_timing.h) and then call them. Built on
+** the inclusion from awtk_vfs.h, after the io methods.
+*/
+#if defined(SQLITE_AWTK_ENABLE_CHROME_TRACE) && !defined(AWTK_ATOMIC_NONE) && \
+    defined(AWTK_IO_METHOD) && !defined(AWTK_CHROME_TRACE_IO)
+#define AWTK_CHROME_TRACE_IO 1
+
+static int _awtk_ctrace_io_close(sqlite3_file* file_id) {
+  return AWTK_IO_METHOD.xClose(file_id);
+}
+
+static int _awtk_ctrace_io_read(sqlite3_file* file_id, void* pbuf, int cnt, sqlite3_int64 offset) {
+  AWTK_CTRACE_START(start);
+  int rc = AWTK_IO_METHOD.xRead(file_id, pbuf, cnt, offset);
+
+  AWTK_CTRACE_END(AWTK_CTRACE_READ, start, offset, cnt, rc);
+
+  return rc;
+}
+
+static int _awtk_ctrace_io_write(sqlite3_file* file_id, const void* pbuf, int cnt,
+                                 sqlite3_int64 offset) {
+  AWTK_CTRACE_START(start);
+  int rc = AWTK_IO_METHOD.xWrite(file_id, pbuf, cnt, offset);
+
+  AWTK_CTRACE_END(AWTK_CTRACE_WRITE, start, offset, cnt, rc);
+
+  return rc;
+}
+
+static int _awtk_ctrace_io_truncate(sqlite3_file* file_id, sqlite3_int64 size) {
+  AWTK_CTRACE_START(start);
+  int rc = AWTK_IO_METHOD.xTruncate(file_id, size);
+
+  AWTK_CTRACE_END(AWTK_CTRACE_TRUNCATE, start, size, 0, rc);
+
+  return rc;
+}
+
+static int _awtk_ctrace_io_sync(sqlite3_file* file_id, int flags) {
+  AWTK_CTRACE_START(start);
+  int rc = AWTK_IO_METHOD.xSync(file_id, flags);
+
+  AWTK_CTRACE_END(AWTK_CTRACE_SYNC, start, 0, flags, rc);
+
+  return rc;
+}
+
+static int _awtk_ctrace_io_lock(sqlite3_file* file_id, int eFileLock) {
+  AWTK_CTRACE_START(start);
+  int rc = AWTK_IO_METHOD.xLock(file_id, eFileLock);
+
+  AWTK_CTRACE_END(AWTK_CTRACE_LOCK, start, 0, eFileLock, rc);
+
+  return rc;
+}
+
+static int _awtk_ctrace_io_unlock(sqlite3_file* file_id, int eFileLock) {
+  return AWTK_IO_METHOD.xUnlock(file_id, eFileLock);
+}
+
+/* methods no layer wraps are the plain ones */
+static const sqlite3_io_methods _awtk_ctrace_io_method = {3,
+                                                          _awtk_ctrace_io_close,
+                                                          _awtk_ctrace_io_read,
+                                                          _awtk_ctrace_io_write,
+                                                          _awtk_ctrace_io_truncate,
+                                                          _awtk_ctrace_io_sync,
+                                                          _awtk_io_file_size,
+                                                          _awtk_ctrace_io_lock,
+                                                          _awtk_ctrace_io_unlock,
+                                                          _awtk_io_check_reserved_lock,
+                                                          _awtk_io_file_ctrl,
+                                                          _awtk_io_sector_size,
+                                                          _awtk_io_device_characteristics,
+                                                          0,
+                                                          0,
+                                                          0,
+                                                          0,
+                                                          _awtk_io_fetch,
+                                                          _awtk_io_unfetch};
+
+#undef AWTK_IO_METHOD
+#define AWTK_IO_METHOD _awtk_ctrace_io_method
+#endif /* AWTK_CHROME_TRACE_IO */
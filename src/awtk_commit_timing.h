@@ -0,0 +1,388 @@
+#ifdef SQLITE_AWTK_ENABLE_COMMIT_TIMING
+/*
+** Commit timing: the VFS follows the rollback-journal commit of each main
+** database handle (one per connection) and splits its I/O time by phase:
+**
+**   journal_write   original pages written to the journal
+**   journal_header  journal header writes (offset 0), incl. the nRec update
+**   journal_sync    syncs of the journal
+**   db_write        pages written to the database file
+**   db_sync         syncs of the database file
+**   cleanup         journal delete, truncate or header zeroing (persist)
+**   total           wall-clock time from the first journal sync (or db write
+**                   when there is none) until the lock drops to SHARED
+**
+** The journal is tied to its database by name ("<db>-journal") when it is
+** opened. A transaction that wrote the database file is recorded when its
+** lock is released, a rolled-back one that had spilled pages too. The last
+** SQLITE_AWTK_COMMIT_TIMING_RING records are kept for
+** sqlite3_awtk_commit_timing_get() and the percentiles.
+**
+** The table and the ring have a static mutex of their own
+** (SQLITE_MUTEX_STATIC_VFS3). The VFS methods run with the connection mutex
+** held, so it is only ever taken last and nothing else is locked under it.
+*/
+#ifndef SQLITE_AWTK_COMMIT_TIMING_MAX_DB
+#define SQLITE_AWTK_COMMIT_TIMING_MAX_DB 8
+#endif /*SQLITE_AWTK_COMMIT_TIMING_MAX_DB*/
+
+#ifndef SQLITE_AWTK_COMMIT_TIMING_RING
+#define SQLITE_AWTK_COMMIT_TIMING_RING 64
+#endif /*SQLITE_AWTK_COMMIT_TIMING_RING*/
+
+#define AWTK_COMMIT_JOURNAL_SUFFIX "-journal"
+
+typedef struct _awtk_commit_db_t {
+  AWTK_SQLITE_FILE_T* main; /* NULL: slot is free */
+  char path[AWTK_MAX_PATHNAME + 1];
+  bool_t active;   /* RESERVED or higher taken */
+  bool_t db_sync;  /* Database synced: journal writes are cleanup now */
+  uint64_t start_us;
+  sqlite3_awtk_commit_timing cur;
+} awtk_commit_db_t;
+
+static struct {
+  awtk_commit_db_t dbs[SQLITE_AWTK_COMMIT_TIMING_MAX_DB];
+  sqlite3_awtk_commit_timing ring[SQLITE_AWTK_COMMIT_TIMING_RING];
+  sqlite3_int64 nCommit;
+} _awtk_commit;
+
+static const char* const _awtk_commit_names[SQLITE_AWTK_COMMIT_N] = {
+    "journal_write", "journal_header", "journal_sync", "db_write",
+    "db_sync",       "cleanup",        "total",
+};
+
+static bool_t _awtk_commit_is_journal(const awtk_commit_db_t* e, const char* path) {
+  size_t n = strlen(e->path);
+
+  return strncmp(path, e->path, n) == 0 && strcmp(path + n, AWTK_COMMIT_JOURNAL_SUFFIX) == 0;
+}
+
+/* Called from xOpen, after the handle is set up. */
+static void _awtk_commit_open(AWTK_SQLITE_FILE_T* file, const char* path, int flags) {
+  int i;
+  sqlite3_mutex* mutex = NULL;
+
+  if ((flags & (SQLITE_OPEN_MAIN_DB | SQLITE_OPEN_MAIN_JOURNAL)) == 0 ||
+      strlen(path) > AWTK_MAX_PATHNAME) {
+    return;
+  }
+
+  mutex = sqlite3_mutex_alloc(SQLITE_MUTEX_STATIC_VFS3);
+  sqlite3_mutex_enter(mutex);
+  for (i = 0; i < SQLITE_AWTK_COMMIT_TIMING_MAX_DB; i++) {
+    awtk_commit_db_t* e = &_awtk_commit.dbs[i];
+
+    if (flags & SQLITE_OPEN_MAIN_DB) {
+      if (e->main == NULL) {
+        memset(e, 0x00, sizeof(*e));
+        e->main = file;
+        tk_strncpy(e->path, path, AWTK_MAX_PATHNAME);
+        file->commit = e;
+        break;
+      }
+    } else if (e->main != NULL && e->main->eFileLock >= RESERVED_LOCK &&
+               _awtk_commit_is_journal(e, path)) {
+      /* the journal of the connection that is writing */
+      file->commit = e;
+      file->is_journal = TRUE;
+      break;
+    }
+  }
+  sqlite3_mutex_leave(mutex);
+}
+
+static void _awtk_commit_add(awtk_commit_db_t* e, int iPhase, uint64_t start_us) {
+  uint64_t now = time_now_us();
+
+  if (!e->active) {
+    return;
+  }
+
+  if (e->start_us == 0 && iPhase >= SQLITE_AWTK_COMMIT_JOURNAL_SYNC) {
+    e->start_us = start_us;
+  }
+  e->cur.aUs[iPhase] += (sqlite3_int64)(now - start_us);
+}
+
+/* The lock of the main database dropped to SHARED or NO_LOCK. */
+static void _awtk_commit_end(awtk_commit_db_t* e) {
+  sqlite3_mutex* mutex = NULL;
+
+  if (!e->active) {
+    return;
+  }
+
+  e->active = FALSE;
+  if (e->cur.nDbWrite == 0) {
+    return;
+  }
+
+  e->cur.aUs[SQLITE_AWTK_COMMIT_TOTAL] = (sqlite3_int64)(time_now_us() - e->start_us);
+  e->cur.iEndMs = (sqlite3_int64)time_now_ms();
+
+  mutex = sqlite3_mutex_alloc(SQLITE_MUTEX_STATIC_VFS3);
+  sqlite3_mutex_enter(mutex);
+  _awtk_commit.ring[_awtk_commit.nCommit % SQLITE_AWTK_COMMIT_TIMING_RING] = e->cur;
+  _awtk_commit.nCommit++;
+  sqlite3_mutex_leave(mutex);
+}
+
+static int _awtk_commit_io_write(sqlite3_file* file_id, const void* pbuf, int cnt,
+                                 sqlite3_int64 offset) {
+  int iPhase;
+  AWTK_SQLITE_FILE_T* file = (AWTK_SQLITE_FILE_T*)file_id;
+  awtk_commit_db_t* e = (awtk_commit_db_t*)file->commit;
+  uint64_t start = time_now_us();
+  int rc = _awtk_io_write(file_id, pbuf, cnt, offset);
+
+  if (e == NULL) {
+    return rc;
+  }
+
+  if (!file->is_journal) {
+    iPhase = SQLITE_AWTK_COMMIT_DB_WRITE;
+    e->cur.nDbWrite++;
+  } else if (e->db_sync) {
+    iPhase = SQLITE_AWTK_COMMIT_CLEANUP;
+  } else if (offset == 0) {
+    iPhase = SQLITE_AWTK_COMMIT_JOURNAL_HEADER;
+  } else {
+    iPhase = SQLITE_AWTK_COMMIT_JOURNAL_WRITE;
+    e->cur.nJournalWrite++;
+  }
+  _awtk_commit_add(e, iPhase, start);
+
+  return rc;
+}
+
+static int _awtk_commit_io_truncate(sqlite3_file* file_id, sqlite3_int64 size) {
+  AWTK_SQLITE_FILE_T* file = (AWTK_SQLITE_FILE_T*)file_id;
+  awtk_commit_db_t* e = (awtk_commit_db_t*)file->commit;
+  uint64_t start = time_now_us();
+  int rc = _awtk_io_truncate(file_id, size);
+
+  if (e != NULL) {
+    int iPhase = file->is_journal ? SQLITE_AWTK_COMMIT_CLEANUP : SQLITE_AWTK_COMMIT_DB_WRITE;
+
+    _awtk_commit_add(e, iPhase, start);
+  }
+
+  return rc;
+}
+
+static int _awtk_commit_io_sync(sqlite3_file* file_id, int flags) {
+  int iPhase;
+  AWTK_SQLITE_FILE_T* file = (AWTK_SQLITE_FILE_T*)file_id;
+  awtk_commit_db_t* e = (awtk_commit_db_t*)file->commit;
+  uint64_t start = time_now_us();
+  int rc = _awtk_io_sync(file_id, flags);
+
+  if (e == NULL) {
+    return rc;
+  }
+
+  if (!file->is_journal) {
+    iPhase = SQLITE_AWTK_COMMIT_DB_SYNC;
+    e->db_sync = e->active;
+  } else {
+    iPhase = e->db_sync ? SQLITE_AWTK_COMMIT_CLEANUP : SQLITE_AWTK_COMMIT_JOURNAL_SYNC;
+  }
+  _awtk_commit_add(e, iPhase, start);
+
+  return rc;
+}
+
+static int _awtk_commit_io_lock(sqlite3_file* file_id, int eFileLock) {
+  AWTK_SQLITE_FILE_T* file = (AWTK_SQLITE_FILE_T*)file_id;
+  awtk_commit_db_t* e = (awtk_commit_db_t*)file->commit;
+  int rc = _awtk_io_lock(file_id, eFileLock);
+
+  if (rc == SQLITE_OK && e != NULL && !file->is_journal && !e->active &&
+      eFileLock >= RESERVED_LOCK) {
+    memset(&e->cur, 0x00, sizeof(e->cur));
+    e->active = TRUE;
+    e->db_sync = FALSE;
+    e->start_us = 0;
+  }
+
+  return rc;
+}
+
+static int _awtk_commit_io_unlock(sqlite3_file* file_id, int eFileLock) {
+  AWTK_SQLITE_FILE_T* file = (AWTK_SQLITE_FILE_T*)file_id;
+  awtk_commit_db_t* e = (awtk_commit_db_t*)file->commit;
+
+  if (e != NULL && !file->is_journal && eFileLock <= SHARED_LOCK) {
+    _awtk_commit_end(e);
+  }
+
+  return _awtk_io_unlock(file_id, eFileLock);
+}
+
+static int _awtk_commit_io_close(sqlite3_file* file_id) {
+  AWTK_SQLITE_FILE_T* file = (AWTK_SQLITE_FILE_T*)file_id;
+  awtk_commit_db_t* e = (awtk_commit_db_t*)file->commit;
+
+  if (e != NULL && !file->is_journal) {
+    sqlite3_mutex* mutex = sqlite3_mutex_alloc(SQLITE_MUTEX_STATIC_VFS3);
+
+    _awtk_commit_end(e);
+    sqlite3_mutex_enter(mutex);
+    memset(e, 0x00, sizeof(*e));
+    sqlite3_mutex_leave(mutex);
+  }
+  file->commit = NULL;
+
+  return _awtk_io_close(file_id);
+}
+
+static const sqlite3_io_methods _awtk_commit_io_method = {3,
+                                                          _awtk_commit_io_close,
+                                                          _awtk_io_read,
+                                                          _awtk_commit_io_write,
+                                                          _awtk_commit_io_truncate,
+                                                          _awtk_commit_io_sync,
+                                                          _awtk_io_file_size,
+                                                          _awtk_commit_io_lock,
+                                                          _awtk_commit_io_unlock,
+                                                          _awtk_io_check_reserved_lock,
+                                                          _awtk_io_file_ctrl,
+                                                          _awtk_io_sector_size,
+                                                          _awtk_io_device_characteristics,
+                                                          0,
+                                                          0,
+                                                          0,
+                                                          0,
+                                                          _awtk_io_fetch,
+                                                          _awtk_io_unfetch};
+
+int _awtk_vfs_delete(sqlite3_vfs* pvfs, const char* file_path, int syncDir);
+
+/* DELETE journal mode: the journal is removed before the lock is released. */
+static int _awtk_commit_vfs_delete(sqlite3_vfs* pvfs, const char* file_path, int syncDir) {
+  int i;
+  awtk_commit_db_t* e = NULL;
+  uint64_t start = time_now_us();
+  int rc = _awtk_vfs_delete(pvfs, file_path, syncDir);
+  sqlite3_mutex* mutex = sqlite3_mutex_alloc(SQLITE_MUTEX_STATIC_VFS3);
+
+  sqlite3_mutex_enter(mutex);
+  for (i = 0; i < SQLITE_AWTK_COMMIT_TIMING_MAX_DB; i++) {
+    awtk_commit_db_t* iter = &_awtk_commit.dbs[i];
+
+    if (iter->main != NULL && iter->active && _awtk_commit_is_journal(iter, file_path)) {
+      e = iter;
+      break;
+    }
+  }
+  sqlite3_mutex_leave(mutex);
+
+  /* only the connection holding the write lock deletes its journal */
+  if (e != NULL) {
+    _awtk_commit_add(e, SQLITE_AWTK_COMMIT_CLEANUP, start);
+  }
+
+  return rc;
+}
+
+SQLITE_API int sqlite3_awtk_commit_timing_get(int iBack, sqlite3_awtk_commit_timing* pCommit) {
+  int rc = SQLITE_NOTFOUND;
+  sqlite3_mutex* mutex = sqlite3_mutex_alloc(SQLITE_MUTEX_STATIC_VFS3);
+
+  memset(pCommit, 0x00, sizeof(*pCommit));
+  sqlite3_mutex_enter(mutex);
+  if (iBack >= 0 && iBack < SQLITE_AWTK_COMMIT_TIMING_RING && iBack < _awtk_commit.nCommit) {
+    sqlite3_int64 i = (_awtk_commit.nCommit - 1 - iBack) % SQLITE_AWTK_COMMIT_TIMING_RING;
+
+    *pCommit = _awtk_commit.ring[i];
+    rc = SQLITE_OK;
+  }
+  sqlite3_mutex_leave(mutex);
+
+  return rc;
+}
+
+/*
+** The nPct percentile of each phase over the recorded commits, in aUs of
+** pCommit; nJournalWrite and nDbWrite get the same percentile of their
+** counts. Returns the number of commits it was computed from.
+*/
+SQLITE_API int sqlite3_awtk_commit_timing_percentile(int nPct,
+                                                     sqlite3_awtk_commit_timing* pCommit) {
+  int i, j, k, n;
+  sqlite3_int64 values[SQLITE_AWTK_COMMIT_TIMING_RING];
+  sqlite3_mutex* mutex = sqlite3_mutex_alloc(SQLITE_MUTEX_STATIC_VFS3);
+
+  memset(pCommit, 0x00, sizeof(*pCommit));
+  if (nPct < 0 || nPct > 100) {
+    return 0;
+  }
+
+  sqlite3_mutex_enter(mutex);
+  n = _awtk_commit.nCommit < SQLITE_AWTK_COMMIT_TIMING_RING ? (int)_awtk_commit.nCommit
+                                                            : SQLITE_AWTK_COMMIT_TIMING_RING;
+  for (k = 0; n > 0 && k < SQLITE_AWTK_COMMIT_N + 2; k++) {
+    for (i = 0; i < n; i++) {
+      const sqlite3_awtk_commit_timing* c = &_awtk_commit.ring[i];
+      sqlite3_int64 v = k < SQLITE_AWTK_COMMIT_N ? c->aUs[k]
+                        : k == SQLITE_AWTK_COMMIT_N ? c->nJournalWrite
+                                                    : c->nDbWrite;
+
+      /* insertion sort, the ring is small */
+      for (j = i; j > 0 && values[j - 1] > v; j--) {
+        values[j] = values[j - 1];
+      }
+      values[j] = v;
+    }
+
+    i = (n - 1) * nPct / 100;
+    if (k < SQLITE_AWTK_COMMIT_N) {
+      pCommit->aUs[k] = values[i];
+    } else if (k == SQLITE_AWTK_COMMIT_N) {
+      pCommit->nJournalWrite = (int)values[i];
+    } else {
+      pCommit->nDbWrite = (int)values[i];
+    }
+  }
+  sqlite3_mutex_leave(mutex);
+
+  return n;
+}
+
+SQLITE_API void sqlite3_awtk_commit_timing_reset(void) {
+  sqlite3_mutex* mutex = sqlite3_mutex_alloc(SQLITE_MUTEX_STATIC_VFS3);
+
+  sqlite3_mutex_enter(mutex);
+  memset(_awtk_commit.ring, 0x00, sizeof(_awtk_commit.ring));
+  _awtk_commit.nCommit = 0;
+  sqlite3_mutex_leave(mutex);
+}
+
+SQLITE_API void sqlite3_awtk_commit_timing_dump(void) {
+  int i, n;
+  sqlite3_awtk_commit_timing p50, p95, p100;
+
+  n = sqlite3_awtk_commit_timing_percentile(50, &p50);
+  sqlite3_awtk_commit_timing_percentile(95, &p95);
+  sqlite3_awtk_commit_timing_percentile(100, &p100);
+
+  log_info("commit timing of the last %d commits (us):\n", n);
+  log_info("%-16s %10s %10s %10s\n", "phase", "p50", "p95", "max");
+  for (i = 0; i < SQLITE_AWTK_COMMIT_N; i++) {
+    log_info("%-16s %10lld %10lld %10lld\n", _awtk_commit_names[i], (long long)p50.aUs[i],
+             (long long)p95.aUs[i], (long long)p100.aUs[i]);
+  }
+  log_info("%-16s %10d %10d %10d\n", "journal_writes", p50.nJournalWrite, p95.nJournalWrite,
+           p100.nJournalWrite);
+  log_info("%-16s %10d %10d %10d\n", "db_writes", p50.nDbWrite, p95.nDbWrite, p100.nDbWrite);
+}
+
+#define AWTK_IO_METHOD _awtk_commit_io_method
+#define AWTK_VFS_DELETE _awtk_commit_vfs_delete
+#define AWTK_COMMIT_OPEN(file, path, flags) _awtk_commit_open(file, path, flags)
+#else
+#define AWTK_IO_METHOD _awtk_io_method
+#define AWTK_VFS_DELETE _awtk_vfs_delete
+#define AWTK_COMMIT_OPEN(file, path, flags)
+#endif /* SQLITE_AWTK_ENABLE_COMMIT_TIMING */
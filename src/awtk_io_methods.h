@@ -178,6 +178,7 @@ static int _awtk_io_lock(sqlite3_file* file_id, int eFileLock) {
   AWTK_SQLITE_FILE_T* file = (AWTK_SQLITE_FILE_T*)file_id;
   tk_semaphore_t* psem = file->sem;
   int rc = SQLITE_OK;
+  AWTK_PROBE_CLOCK(start);
 
   /* if we already have a lock, it is exclusive.
     ** Just adjust level and punt on outta here. */
@@ -190,6 +191,9 @@ static int _awtk_io_lock(sqlite3_file* file_id, int eFileLock) {
   /* lock semaphore now but bail out when already locked. */
   if (tk_semaphore_wait(psem, 0) != RET_OK) {
     rc = SQLITE_BUSY;
+  }
+  AWTK_PROBE4(file_sem, file_id, eFileLock, time_now_us() - start, rc);
+  if (rc != SQLITE_OK) {
     goto sem_end_lock;
   }
 
@@ -238,7 +242,10 @@ static int _awtk_io_close(sqlite3_file* file_id) {
   if (file->fd >= 0) {
     _awtk_io_unlock(file_id, NO_LOCK);
 
-    tk_semaphore_destroy(file->sem);
+    if (file->lock != NULL) {
+      _awtk_vfs_lock_put(file->lock);
+      file->lock = NULL;
+    }
     fs_file_close(file->fd);
     file->fd = NULL;
   }
@@ -0,0 +1,76 @@
+#if defined(SQLITE_AWTK_ENABLE_SLOW_LOG) || defined(SQLITE_AWTK_ENABLE_STATUS_LOG)
+/*
+** Size-limited log file shared by the slow-query and status logs.
+**
+** Records are appended to the file; when the next one would take it past
+** nMaxBytes it is rotated to "<file>.1", replacing the previous one, so at
+** most two files' worth of history is kept. A header, when set, starts every
+** new file. Without a path records go to log_info().
+**
+** Not thread safe: the owning log calls it with its own mutex held.
+*/
+typedef struct _awtk_log_file_t {
+  char path[AWTK_MAX_PATHNAME + 1]; /* Empty: log_info() */
+  fs_file_t* file;
+  int32_t size;
+  int32_t nMaxBytes;
+  const char* header; /* Written at the top of every new file, or NULL */
+} awtk_log_file_t;
+
+/* zPath (NULL: log_info()) must fit in AWTK_MAX_PATHNAME, the caller checks. */
+static void _awtk_log_file_init(awtk_log_file_t* f, const char* zPath, int32_t nMaxBytes,
+                                const char* header) {
+  memset(f, 0x00, sizeof(*f));
+  if (zPath != NULL) {
+    tk_strncpy(f->path, zPath, AWTK_MAX_PATHNAME);
+  }
+  f->nMaxBytes = nMaxBytes;
+  f->header = header;
+}
+
+static void _awtk_log_file_write(awtk_log_file_t* f, const char* record) {
+  int32_t len = (int32_t)strlen(record);
+
+  if (f->path[0] == '\0') {
+    log_info("%s", record);
+    return;
+  }
+
+  if (f->file != NULL && f->size > 0 && f->size + len > f->nMaxBytes) {
+    char old[AWTK_MAX_PATHNAME + 3];
+
+    tk_snprintf(old, sizeof(old), "%s.1", f->path);
+    fs_file_close(f->file);
+    f->file = NULL;
+    fs_remove_file(os_fs(), old);
+    fs_file_rename(os_fs(), f->path, old);
+  }
+
+  if (f->file == NULL) {
+    f->size = fs_get_file_size(os_fs(), f->path);
+    if (f->size < 0) {
+      f->size = 0;
+    }
+    f->file = fs_open_file(os_fs(), f->path, "ab");
+    if (f->file != NULL && f->size == 0 && f->header != NULL) {
+      int32_t n = (int32_t)strlen(f->header);
+
+      if (fs_file_write(f->file, f->header, n) == n) {
+        f->size += n;
+      }
+    }
+  }
+
+  if (f->file != NULL && fs_file_write(f->file, record, len) == len) {
+    f->size += len;
+  }
+}
+
+static void _awtk_log_file_close(awtk_log_file_t* f) {
+  if (f->file != NULL) {
+    fs_file_close(f->file);
+    f->file = NULL;
+  }
+}
+
+#endif /* SQLITE_AWTK_ENABLE_SLOW_LOG || SQLITE_AWTK_ENABLE_STATUS_LOG */
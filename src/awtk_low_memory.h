@@ -0,0 +1,214 @@
+#ifdef SQLITE_AWTK_ENABLE_LOW_MEMORY
+/*
+** Give SQLite's caches back to the GUI when AWTK runs short of memory.
+**
+** On EVT_LOW_MEMORY from the window manager (or sqlite3_awtk_low_memory_trigger())
+** every registered connection drops its unpinned pages with
+** sqlite3_db_release_memory(), then sqlite3_release_memory() frees whatever
+** else SQLite can (only with SQLITE_ENABLE_MEMORY_MANAGEMENT). With the
+** size-class pool (SQLITE_AWTK_ENABLE_MEM_POOL) those bytes only go back to
+** its free lists, so sqlite3_awtk_mem_pool_release() then returns the slabs
+** left empty to the AWTK heap; the log line reports both. The soft heap
+** limit is then lowered so the caches recycle pages instead of growing back,
+** and restored by a timer once the cool-down has passed.
+**
+** The release takes each connection's mutex, so registered connections must
+** come from a serialized build or only be used on the thread that triggers.
+** The list of connections is guarded by SQLITE_MUTEX_STATIC_VFS2, held for
+** the whole release so sqlite3_awtk_low_memory_unregister() waits for it;
+** unregister a connection before closing it, never with its mutex held.
+** SQLITE_MUTEX_STATIC_VFS1 only guards the limit and the statistics and is
+** never held while a connection mutex is requested.
+**
+** The cool-down timer belongs to the GUI thread: the trigger queues an idle
+** callback (idle_queue() is thread safe) that restarts it. Without memory
+** statistics (SQLITE_DEFAULT_MEMSTATUS 0) SQLite neither counts usage nor
+** enforces the soft heap limit, so only the release happens.
+*/
+#ifndef SQLITE_AWTK_LOW_MEMORY_MAX_DB
+#define SQLITE_AWTK_LOW_MEMORY_MAX_DB 8
+#endif /*SQLITE_AWTK_LOW_MEMORY_MAX_DB*/
+
+static struct {
+  sqlite3* dbs[SQLITE_AWTK_LOW_MEMORY_MAX_DB]; /* Guarded by SQLITE_MUTEX_STATIC_VFS2 */
+  int nDb;
+  sqlite3_int64 nPressureLimit; /* Soft heap limit during cool-down, 0: usage after release */
+  sqlite3_int64 nSavedLimit;    /* Soft heap limit to restore */
+  int nCooldownMs;
+  uint32_t event_id;
+  uint32_t timer_id;
+  sqlite3_awtk_low_memory_stats stats;
+} _awtk_low_memory;
+
+static ret_t _awtk_low_memory_on_timer(const timer_info_t* info) {
+  sqlite3_mutex* mutex = sqlite3_mutex_alloc(SQLITE_MUTEX_STATIC_VFS1);
+
+  sqlite3_mutex_enter(mutex);
+  if (_awtk_low_memory.stats.bLimited) {
+    sqlite3_soft_heap_limit64(_awtk_low_memory.nSavedLimit);
+  }
+  _awtk_low_memory.stats.bLimited = 0;
+  sqlite3_mutex_leave(mutex);
+  _awtk_low_memory.timer_id = TK_INVALID_ID;
+
+  return RET_REMOVE;
+}
+
+/* on the GUI thread: (re)start the cool-down */
+static ret_t _awtk_low_memory_on_idle(const idle_info_t* info) {
+  if (_awtk_low_memory.timer_id != TK_INVALID_ID) {
+    timer_remove(_awtk_low_memory.timer_id);
+  }
+  _awtk_low_memory.timer_id =
+      timer_add(_awtk_low_memory_on_timer, NULL, _awtk_low_memory.nCooldownMs);
+
+  return RET_REMOVE;
+}
+
+SQLITE_API sqlite3_int64 sqlite3_awtk_low_memory_trigger(void) {
+  int i;
+  int limited = 0;
+  sqlite3_int64 before = 0;
+  sqlite3_int64 after = 0;
+  sqlite3_int64 recovered = 0;
+  sqlite3_int64 returned = 0;
+  sqlite3_mutex* mutex = sqlite3_mutex_alloc(SQLITE_MUTEX_STATIC_VFS1);
+  sqlite3_mutex* dbs_mutex = sqlite3_mutex_alloc(SQLITE_MUTEX_STATIC_VFS2);
+
+  sqlite3_mutex_enter(dbs_mutex);
+  before = sqlite3_memory_used();
+  for (i = 0; i < SQLITE_AWTK_LOW_MEMORY_MAX_DB; i++) {
+    if (_awtk_low_memory.dbs[i] != NULL) {
+      sqlite3_db_release_memory(_awtk_low_memory.dbs[i]);
+    }
+  }
+  sqlite3_mutex_leave(dbs_mutex);
+  recovered = sqlite3_release_memory(0x7fffffff);
+  after = sqlite3_memory_used();
+
+  /* without memory statistics only sqlite3_release_memory() can report */
+  if (before - after > recovered) {
+    recovered = before - after;
+  }
+#ifdef SQLITE_AWTK_ENABLE_MEM_POOL
+  returned = sqlite3_awtk_mem_pool_release();
+#else
+  returned = recovered;
+#endif /*SQLITE_AWTK_ENABLE_MEM_POOL*/
+
+  sqlite3_mutex_enter(mutex);
+  if (sqlite3GlobalConfig.bMemstat) {
+    if (!_awtk_low_memory.stats.bLimited) {
+      _awtk_low_memory.nSavedLimit = sqlite3_soft_heap_limit64(-1);
+    }
+    sqlite3_soft_heap_limit64(_awtk_low_memory.nPressureLimit > 0 ? _awtk_low_memory.nPressureLimit
+                                                                   : (after > 0 ? after : 1));
+    _awtk_low_memory.stats.bLimited = 1;
+    limited = 1;
+  }
+
+  _awtk_low_memory.stats.nEvent++;
+  _awtk_low_memory.stats.nRecovered += recovered;
+  _awtk_low_memory.stats.nLastRecovered = recovered;
+  _awtk_low_memory.stats.nLastUsed = after;
+  if (recovered > _awtk_low_memory.stats.mxRecovered) {
+    _awtk_low_memory.stats.mxRecovered = recovered;
+  }
+  sqlite3_mutex_leave(mutex);
+
+  if (limited) {
+    idle_queue(_awtk_low_memory_on_idle, NULL);
+  }
+
+  log_info("sqlite low memory: released %lld bytes, %lld still in use, %lld returned to the heap\n",
+           (long long)recovered, (long long)after, (long long)returned);
+
+  return recovered;
+}
+
+static ret_t _awtk_low_memory_on_event(void* ctx, event_t* e) {
+  sqlite3_awtk_low_memory_trigger();
+
+  return RET_OK;
+}
+
+SQLITE_API int sqlite3_awtk_low_memory_init(sqlite3_int64 nPressureLimit, int nCooldownMs) {
+  widget_t* wm = window_manager();
+
+  if (nPressureLimit < 0 || nCooldownMs < 0) {
+    return SQLITE_MISUSE;
+  }
+
+  _awtk_low_memory.nPressureLimit = nPressureLimit;
+  _awtk_low_memory.nCooldownMs = nCooldownMs;
+  _awtk_low_memory.timer_id = TK_INVALID_ID;
+
+  if (wm != NULL && _awtk_low_memory.event_id == TK_INVALID_ID) {
+    _awtk_low_memory.event_id = widget_on(wm, EVT_LOW_MEMORY, _awtk_low_memory_on_event, NULL);
+  }
+
+  return SQLITE_OK;
+}
+
+SQLITE_API void sqlite3_awtk_low_memory_deinit(void) {
+  widget_t* wm = window_manager();
+
+  if (wm != NULL && _awtk_low_memory.event_id != TK_INVALID_ID) {
+    widget_off(wm, _awtk_low_memory.event_id);
+  }
+  _awtk_low_memory.event_id = TK_INVALID_ID;
+
+  if (_awtk_low_memory.timer_id != TK_INVALID_ID) {
+    timer_remove(_awtk_low_memory.timer_id);
+  }
+  _awtk_low_memory_on_timer(NULL);
+}
+
+SQLITE_API int sqlite3_awtk_low_memory_register(sqlite3* db) {
+  int i;
+  int rc = SQLITE_FULL;
+  sqlite3_mutex* mutex = sqlite3_mutex_alloc(SQLITE_MUTEX_STATIC_VFS2);
+
+  sqlite3_mutex_enter(mutex);
+  for (i = 0; i < SQLITE_AWTK_LOW_MEMORY_MAX_DB; i++) {
+    if (_awtk_low_memory.dbs[i] == NULL || _awtk_low_memory.dbs[i] == db) {
+      _awtk_low_memory.nDb += _awtk_low_memory.dbs[i] == NULL;
+      _awtk_low_memory.dbs[i] = db;
+      rc = SQLITE_OK;
+      break;
+    }
+  }
+  sqlite3_mutex_leave(mutex);
+
+  return rc;
+}
+
+SQLITE_API int sqlite3_awtk_low_memory_unregister(sqlite3* db) {
+  int i;
+  int rc = SQLITE_NOTFOUND;
+  sqlite3_mutex* mutex = sqlite3_mutex_alloc(SQLITE_MUTEX_STATIC_VFS2);
+
+  sqlite3_mutex_enter(mutex);
+  for (i = 0; i < SQLITE_AWTK_LOW_MEMORY_MAX_DB; i++) {
+    if (db != NULL && _awtk_low_memory.dbs[i] == db) {
+      _awtk_low_memory.dbs[i] = NULL;
+      _awtk_low_memory.nDb--;
+      rc = SQLITE_OK;
+      break;
+    }
+  }
+  sqlite3_mutex_leave(mutex);
+
+  return rc;
+}
+
+SQLITE_API void sqlite3_awtk_low_memory_stats_get(sqlite3_awtk_low_memory_stats* pStats) {
+  sqlite3_mutex* mutex = sqlite3_mutex_alloc(SQLITE_MUTEX_STATIC_VFS1);
+
+  sqlite3_mutex_enter(mutex);
+  *pStats = _awtk_low_memory.stats;
+  sqlite3_mutex_leave(mutex);
+  pStats->nDb = _awtk_low_memory.nDb;
+}
+
+#endif /* SQLITE_AWTK_ENABLE_LOW_MEMORY */
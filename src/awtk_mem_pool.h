@@ -0,0 +1,444 @@
+#ifdef SQLITE_AWTK_ENABLE_MEM_POOL
+/*
+** sqlite3_mem_methods on top of the AWTK heap (TKMEM_ALLOC).
+**
+** Small requests are served from per-size-class free lists. Blocks are carved
+** from slabs taken from the AWTK heap and stay in the pool when freed, so the
+** churn of Mem cells, VDBE objects and page buffers does not fragment the
+** device heap. Each slab counts its live blocks; sqlite3_awtk_mem_pool_release()
+** (called by the low memory handler) hands the empty ones back. Each class has
+** its own lock; requests larger than the biggest class go straight to
+** TKMEM_ALLOC.
+**
+** Every block starts with an 8 byte header holding the class index, the
+** block's index in its slab and the requested size, which keeps the payload
+** 8-byte aligned. Free blocks are linked through their payload so the header
+** still finds the slab.
+*/
+#define AWTK_MEM_POOL_HDR 8
+#define AWTK_MEM_POOL_LARGE 0xFFFFFFFF
+#define AWTK_MEM_POOL_CLASS(h) ((h) & 0xFF)
+#define AWTK_MEM_POOL_INDEX(h) ((h) >> 8)
+#define AWTK_MEM_POOL_SLAB_HDR ROUND8(sizeof(awtk_mem_slab_t))
+#define AWTK_MEM_POOL_MIN_SLAB (16 * 1024)
+#define AWTK_MEM_POOL_MIN_BLOCKS_PER_SLAB 4
+
+/*
+** Block sizes, header included. The spacing follows what SQLite allocates:
+** Mem cells and expression nodes (48..160), VDBE and parser objects
+** (256..1024), and page buffers for 1K, 2K, 4K and 8K pages plus the pcache1
+** header and the pager's extra bytes, about 300 bytes (1344, 2368, 4416, 8512).
+*/
+static const uint32_t _awtk_mem_class_size[] = {
+    32,   48,   64,   80,   96,   128,  160,  192,  256,  320,  384,  512,
+    640,  768,  1024, 1344, 1536, 2048, 2368, 3072, 4416, 8512,
+};
+
+#define AWTK_MEM_POOL_NCLASS ArraySize(_awtk_mem_class_size)
+
+typedef struct _awtk_mem_block_t {
+  struct _awtk_mem_block_t* next;
+} awtk_mem_block_t;
+
+typedef struct _awtk_mem_slab_t {
+  struct _awtk_mem_slab_t* next;
+  uint32_t size;
+  uint32_t nLive; /* Blocks of this slab handed out */
+} awtk_mem_slab_t;
+
+typedef struct _awtk_mem_class_t {
+  tk_mutex_t* mutex;
+  awtk_mem_block_t* free_list;
+  awtk_mem_slab_t* slabs;
+  char* carve;     /* Next never-used block in the newest slab */
+  char* carve_end; /* End of the newest slab */
+  sqlite3_uint64 nSlabBytes;
+  sqlite3_uint64 nUsed;      /* Blocks handed out */
+  sqlite3_uint64 nRequested; /* Bytes SQLite asked for in those blocks */
+  sqlite3_uint64 nMalloc;
+} awtk_mem_class_t;
+
+static struct {
+  awtk_mem_class_t classes[AWTK_MEM_POOL_NCLASS];
+  tk_mutex_t* large_mutex; /* Only guards the large-block counters */
+  sqlite3_uint64 nLargeBytes;
+  sqlite3_uint64 nLargeRequested;
+  sqlite3_uint64 nLarge;
+} _awtk_mem_pool;
+
+static uint32_t _awtk_mem_class_of(uint32_t n) {
+  uint32_t lo = 0;
+  uint32_t hi = AWTK_MEM_POOL_NCLASS;
+
+  n += AWTK_MEM_POOL_HDR;
+  if (n > _awtk_mem_class_size[AWTK_MEM_POOL_NCLASS - 1]) {
+    return AWTK_MEM_POOL_LARGE;
+  }
+
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+
+    if (_awtk_mem_class_size[mid] < n) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  return lo;
+}
+
+static awtk_mem_slab_t* _awtk_mem_slab_of(uint32_t* hdr) {
+  uint32_t block = _awtk_mem_class_size[AWTK_MEM_POOL_CLASS(hdr[0])];
+
+  return (awtk_mem_slab_t*)((char*)hdr - AWTK_MEM_POOL_INDEX(hdr[0]) * block -
+                            AWTK_MEM_POOL_SLAB_HDR);
+}
+
+/* returns the block's header with the class and slab index filled in */
+static uint32_t* _awtk_mem_class_alloc(awtk_mem_class_t* c, uint32_t cls) {
+  uint32_t* hdr = NULL;
+  uint32_t block = _awtk_mem_class_size[cls];
+
+  if (c->free_list != NULL) {
+    hdr = (uint32_t*)((char*)c->free_list - AWTK_MEM_POOL_HDR);
+    c->free_list = c->free_list->next;
+    _awtk_mem_slab_of(hdr)->nLive++;
+    return hdr;
+  }
+
+  if (c->carve + block > c->carve_end) {
+    uint32_t size = block * AWTK_MEM_POOL_MIN_BLOCKS_PER_SLAB;
+    awtk_mem_slab_t* slab = NULL;
+
+    if (size < AWTK_MEM_POOL_MIN_SLAB) {
+      size = (AWTK_MEM_POOL_MIN_SLAB / block) * block;
+    }
+
+    slab = (awtk_mem_slab_t*)TKMEM_ALLOC(AWTK_MEM_POOL_SLAB_HDR + size);
+    if (slab == NULL) {
+      return NULL;
+    }
+
+    slab->next = c->slabs;
+    slab->size = size;
+    slab->nLive = 0;
+    c->slabs = slab;
+    c->carve = (char*)slab + AWTK_MEM_POOL_SLAB_HDR;
+    c->carve_end = c->carve + size;
+    c->nSlabBytes += size;
+  }
+
+  /* the newest slab is the one being carved */
+  hdr = (uint32_t*)c->carve;
+  hdr[0] = cls | (((uint32_t)(c->carve - ((char*)c->slabs + AWTK_MEM_POOL_SLAB_HDR)) / block) << 8);
+  c->slabs->nLive++;
+  c->carve += block;
+
+  return hdr;
+}
+
+static void* _awtk_mem_pool_malloc(int nByte) {
+  uint32_t* hdr = NULL;
+  uint32_t cls = _awtk_mem_class_of((uint32_t)nByte);
+
+  if (cls == AWTK_MEM_POOL_LARGE) {
+    uint32_t size = ROUND8(nByte) + AWTK_MEM_POOL_HDR;
+
+    hdr = (uint32_t*)TKMEM_ALLOC(size);
+    if (hdr != NULL) {
+      tk_mutex_lock(_awtk_mem_pool.large_mutex);
+      _awtk_mem_pool.nLarge++;
+      _awtk_mem_pool.nLargeBytes += size;
+      _awtk_mem_pool.nLargeRequested += nByte;
+      tk_mutex_unlock(_awtk_mem_pool.large_mutex);
+    }
+  } else {
+    awtk_mem_class_t* c = &_awtk_mem_pool.classes[cls];
+
+    tk_mutex_lock(c->mutex);
+    hdr = _awtk_mem_class_alloc(c, cls);
+    if (hdr != NULL) {
+      c->nUsed++;
+      c->nMalloc++;
+      c->nRequested += nByte;
+    }
+    tk_mutex_unlock(c->mutex);
+  }
+
+  if (hdr == NULL) {
+    return NULL;
+  }
+
+  if (cls == AWTK_MEM_POOL_LARGE) {
+    hdr[0] = AWTK_MEM_POOL_LARGE;
+  }
+  hdr[1] = (uint32_t)nByte;
+
+  return (char*)hdr + AWTK_MEM_POOL_HDR;
+}
+
+static void _awtk_mem_pool_free(void* pPrior) {
+  uint32_t* hdr = NULL;
+
+  if (pPrior == NULL) {
+    return;
+  }
+
+  hdr = (uint32_t*)((char*)pPrior - AWTK_MEM_POOL_HDR);
+  if (hdr[0] == AWTK_MEM_POOL_LARGE) {
+    tk_mutex_lock(_awtk_mem_pool.large_mutex);
+    _awtk_mem_pool.nLarge--;
+    _awtk_mem_pool.nLargeBytes -= ROUND8(hdr[1]) + AWTK_MEM_POOL_HDR;
+    _awtk_mem_pool.nLargeRequested -= hdr[1];
+    tk_mutex_unlock(_awtk_mem_pool.large_mutex);
+    TKMEM_FREE(hdr);
+  } else {
+    awtk_mem_class_t* c = &_awtk_mem_pool.classes[AWTK_MEM_POOL_CLASS(hdr[0])];
+    awtk_mem_block_t* block = (awtk_mem_block_t*)pPrior;
+
+    tk_mutex_lock(c->mutex);
+    c->nUsed--;
+    c->nRequested -= hdr[1];
+    _awtk_mem_slab_of(hdr)->nLive--;
+    block->next = c->free_list;
+    c->free_list = block;
+    tk_mutex_unlock(c->mutex);
+  }
+}
+
+static int _awtk_mem_pool_size(void* pPrior) {
+  uint32_t* hdr = NULL;
+
+  if (pPrior == NULL) {
+    return 0;
+  }
+
+  hdr = (uint32_t*)((char*)pPrior - AWTK_MEM_POOL_HDR);
+  if (hdr[0] == AWTK_MEM_POOL_LARGE) {
+    return (int)ROUND8(hdr[1]);
+  }
+
+  return (int)(_awtk_mem_class_size[AWTK_MEM_POOL_CLASS(hdr[0])] - AWTK_MEM_POOL_HDR);
+}
+
+static void* _awtk_mem_pool_realloc(void* pPrior, int nByte) {
+  void* p = NULL;
+  uint32_t* hdr = (uint32_t*)((char*)pPrior - AWTK_MEM_POOL_HDR);
+  uint32_t cls = _awtk_mem_class_of((uint32_t)nByte);
+
+  /* same class: nothing to move, only the accounting changes */
+  if (cls != AWTK_MEM_POOL_LARGE && hdr[0] != AWTK_MEM_POOL_LARGE &&
+      cls == AWTK_MEM_POOL_CLASS(hdr[0])) {
+    awtk_mem_class_t* c = &_awtk_mem_pool.classes[cls];
+
+    tk_mutex_lock(c->mutex);
+    c->nRequested = c->nRequested - hdr[1] + nByte;
+    tk_mutex_unlock(c->mutex);
+    hdr[1] = (uint32_t)nByte;
+
+    return pPrior;
+  }
+
+  p = _awtk_mem_pool_malloc(nByte);
+  if (p != NULL) {
+    int n = _awtk_mem_pool_size(pPrior);
+
+    memcpy(p, pPrior, n < nByte ? n : nByte);
+    _awtk_mem_pool_free(pPrior);
+  }
+
+  return p;
+}
+
+static int _awtk_mem_pool_roundup(int n) {
+  uint32_t cls = _awtk_mem_class_of((uint32_t)n);
+
+  if (cls == AWTK_MEM_POOL_LARGE) {
+    return ROUND8(n);
+  }
+
+  return (int)(_awtk_mem_class_size[cls] - AWTK_MEM_POOL_HDR);
+}
+
+static void _awtk_mem_pool_shutdown(void* NotUsed);
+
+static int _awtk_mem_pool_init(void* NotUsed) {
+  uint32_t i;
+
+  memset(&_awtk_mem_pool, 0, sizeof(_awtk_mem_pool));
+  _awtk_mem_pool.large_mutex = tk_mutex_create();
+  if (_awtk_mem_pool.large_mutex == NULL) {
+    return SQLITE_NOMEM;
+  }
+
+  for (i = 0; i < AWTK_MEM_POOL_NCLASS; i++) {
+    _awtk_mem_pool.classes[i].mutex = tk_mutex_create();
+
+    if (_awtk_mem_pool.classes[i].mutex == NULL) {
+      _awtk_mem_pool_shutdown(NotUsed);
+      return SQLITE_NOMEM;
+    }
+  }
+
+  return SQLITE_OK;
+}
+
+static void _awtk_mem_pool_shutdown(void* NotUsed) {
+  uint32_t i;
+
+  for (i = 0; i < AWTK_MEM_POOL_NCLASS; i++) {
+    awtk_mem_class_t* c = &_awtk_mem_pool.classes[i];
+
+    while (c->slabs != NULL) {
+      awtk_mem_slab_t* slab = c->slabs;
+
+      c->slabs = slab->next;
+      TKMEM_FREE(slab);
+    }
+
+    if (c->mutex != NULL) {
+      tk_mutex_destroy(c->mutex);
+      c->mutex = NULL;
+    }
+  }
+
+  if (_awtk_mem_pool.large_mutex != NULL) {
+    tk_mutex_destroy(_awtk_mem_pool.large_mutex);
+    _awtk_mem_pool.large_mutex = NULL;
+  }
+}
+
+SQLITE_API int sqlite3_awtk_mem_pool_install(void) {
+  static const sqlite3_mem_methods methods = {
+      _awtk_mem_pool_malloc,  _awtk_mem_pool_free, _awtk_mem_pool_realloc,
+      _awtk_mem_pool_size,    _awtk_mem_pool_roundup, _awtk_mem_pool_init,
+      _awtk_mem_pool_shutdown, 0};
+
+  return sqlite3_config(SQLITE_CONFIG_MALLOC, &methods);
+}
+
+/* drop the free blocks of empty slabs, then the slabs: returns the bytes freed */
+static sqlite3_uint64 _awtk_mem_class_release(awtk_mem_class_t* c) {
+  sqlite3_uint64 n = 0;
+  awtk_mem_slab_t* slab = NULL;
+  awtk_mem_slab_t** pSlab = &c->slabs;
+  awtk_mem_block_t** pBlock = &c->free_list;
+
+  slab = c->slabs;
+  while (slab != NULL && slab->nLive > 0) {
+    slab = slab->next;
+  }
+  if (slab == NULL) {
+    return 0;
+  }
+
+  while (*pBlock != NULL) {
+    uint32_t* hdr = (uint32_t*)((char*)*pBlock - AWTK_MEM_POOL_HDR);
+
+    if (_awtk_mem_slab_of(hdr)->nLive == 0) {
+      *pBlock = (*pBlock)->next;
+    } else {
+      pBlock = &(*pBlock)->next;
+    }
+  }
+
+  while (*pSlab != NULL) {
+    slab = *pSlab;
+    if (slab->nLive > 0) {
+      pSlab = &slab->next;
+      continue;
+    }
+
+    if (slab == c->slabs) {
+      c->carve = NULL;
+      c->carve_end = NULL;
+    }
+    *pSlab = slab->next;
+    c->nSlabBytes -= slab->size;
+    n += AWTK_MEM_POOL_SLAB_HDR + slab->size;
+    TKMEM_FREE(slab);
+  }
+
+  return n;
+}
+
+SQLITE_API sqlite3_int64 sqlite3_awtk_mem_pool_release(void) {
+  uint32_t i;
+  sqlite3_uint64 n = 0;
+
+  for (i = 0; i < AWTK_MEM_POOL_NCLASS; i++) {
+    awtk_mem_class_t* c = &_awtk_mem_pool.classes[i];
+
+    if (c->mutex == NULL) {
+      continue;
+    }
+
+    tk_mutex_lock(c->mutex);
+    n += _awtk_mem_class_release(c);
+    tk_mutex_unlock(c->mutex);
+  }
+
+  return (sqlite3_int64)n;
+}
+
+SQLITE_API void sqlite3_awtk_mem_pool_stats_get(sqlite3_awtk_mem_pool_stats* pStats) {
+  uint32_t i;
+
+  memset(pStats, 0, sizeof(*pStats));
+  for (i = 0; i < AWTK_MEM_POOL_NCLASS; i++) {
+    awtk_mem_class_t* c = &_awtk_mem_pool.classes[i];
+
+    if (c->mutex == NULL) {
+      continue;
+    }
+
+    tk_mutex_lock(c->mutex);
+    pStats->nReserved += c->nSlabBytes;
+    pStats->nInUse += c->nUsed * _awtk_mem_class_size[i];
+    pStats->nRequested += c->nRequested;
+    pStats->nMalloc += c->nMalloc;
+    tk_mutex_unlock(c->mutex);
+  }
+
+  if (_awtk_mem_pool.large_mutex != NULL) {
+    tk_mutex_lock(_awtk_mem_pool.large_mutex);
+    pStats->nReserved += _awtk_mem_pool.nLargeBytes;
+    pStats->nInUse += _awtk_mem_pool.nLargeBytes;
+    pStats->nRequested += _awtk_mem_pool.nLargeRequested;
+    pStats->nLarge = _awtk_mem_pool.nLarge;
+    tk_mutex_unlock(_awtk_mem_pool.large_mutex);
+  }
+}
+
+SQLITE_API void sqlite3_awtk_mem_pool_dump(void) {
+  uint32_t i;
+  sqlite3_awtk_mem_pool_stats stats;
+
+  log_info("%8s %10s %10s %12s %12s\n", "class", "used", "malloc", "requested", "slab_bytes");
+  for (i = 0; i < AWTK_MEM_POOL_NCLASS; i++) {
+    awtk_mem_class_t c;
+
+    if (_awtk_mem_pool.classes[i].mutex == NULL) {
+      continue;
+    }
+
+    tk_mutex_lock(_awtk_mem_pool.classes[i].mutex);
+    c = _awtk_mem_pool.classes[i];
+    tk_mutex_unlock(_awtk_mem_pool.classes[i].mutex);
+
+    if (c.nSlabBytes > 0) {
+      log_info("%8u %10llu %10llu %12llu %12llu\n", _awtk_mem_class_size[i],
+               (unsigned long long)c.nUsed, (unsigned long long)c.nMalloc,
+               (unsigned long long)c.nRequested, (unsigned long long)c.nSlabBytes);
+    }
+  }
+
+  sqlite3_awtk_mem_pool_stats_get(&stats);
+  log_info("reserved=%llu in_use=%llu requested=%llu large=%llu fragmentation=%.1f%%\n",
+           (unsigned long long)stats.nReserved, (unsigned long long)stats.nInUse,
+           (unsigned long long)stats.nRequested, (unsigned long long)stats.nLarge,
+           stats.nReserved ? 100.0 - (100.0 * stats.nRequested / stats.nReserved) : 0.0);
+}
+
+#endif /* SQLITE_AWTK_ENABLE_MEM_POOL */
@@ -0,0 +1,586 @@
+#ifdef SQLITE_AWTK_ENABLE_MEM_PROF
+/*
+** Allocation profiler: sqlite3_mem_methods that wrap the allocator that was
+** configured before it and account every block to a size class and a tag.
+**
+** xMalloc is always entered from sqlite3Malloc(), so the return address says
+** nothing about who wanted the memory. The tag is the purpose instead: the
+** normalized SQL (_awtk_trace_normalize()) of the statement a connection is
+** stepping (see sqlite3_awtk_mem_prof_attach()) or a name the application
+** set around a piece of work with sqlite3_awtk_mem_prof_tag_begin().
+**
+** Tags are per thread and nest: each thread keeps a stack of the statements
+** and application tags it is in, so a statement stepped while another one
+** is open charges its own tag and the outer one is current again once it
+** ends. Frames beyond SQLITE_AWTK_MEM_PROF_DEPTH are not tagged. With
+** AWTK_THREAD_LOCAL the stack is thread-local, else a thread takes one of
+** SQLITE_AWTK_MEM_PROF_THREADS slots while its stack is not empty.
+**
+** Every block gets an 8 byte header with its tag, so blocks freed on another
+** thread or after their statement finished are still charged correctly.
+**
+** xMalloc and xFree take no lock: the counters are updated with the atomics
+** of awtk_atomic.h. Targets without 64-bit atomics (AWTK_MEM_PROF_LOCKED)
+** update them under the profiler mutex, which otherwise only guards the tag
+** table and the thread slots, once per statement.
+*/
+#define AWTK_MEM_PROF_HDR 8
+#define AWTK_MEM_PROF_NCLASS 14 /* <=16, <=32, ... <=64K, larger */
+#define AWTK_MEM_PROF_UNTAGGED 0
+#define AWTK_MEM_PROF_OTHER 1 /* Tag table full */
+
+#ifndef SQLITE_AWTK_MEM_PROF_TAGS
+#define SQLITE_AWTK_MEM_PROF_TAGS 64
+#endif /*SQLITE_AWTK_MEM_PROF_TAGS*/
+
+#ifndef SQLITE_AWTK_MEM_PROF_TAG_LEN
+#define SQLITE_AWTK_MEM_PROF_TAG_LEN 128
+#endif /*SQLITE_AWTK_MEM_PROF_TAG_LEN*/
+
+#ifndef SQLITE_AWTK_MEM_PROF_THREADS
+#define SQLITE_AWTK_MEM_PROF_THREADS 8
+#endif /*SQLITE_AWTK_MEM_PROF_THREADS*/
+
+#ifndef SQLITE_AWTK_MEM_PROF_DEPTH
+#define SQLITE_AWTK_MEM_PROF_DEPTH 8
+#endif /*SQLITE_AWTK_MEM_PROF_DEPTH*/
+
+#if defined(AWTK_ATOMIC_NONE) || \
+    (defined(__GNUC__) && !defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_8))
+#define AWTK_MEM_PROF_LOCKED 1
+#endif
+
+typedef struct _awtk_mem_prof_tag_t {
+  uint32_t hash;
+  char name[SQLITE_AWTK_MEM_PROF_TAG_LEN];
+  sqlite3_int64 nLive;
+  sqlite3_int64 mxLive;
+  sqlite3_int64 nAlloc;
+  sqlite3_int64 nBytes;
+  sqlite3_int64 nRun;
+  sqlite3_int64 nRunBase;   /* nLive when the current run started */
+  sqlite3_int64 mxRun;      /* Peak growth of the current run */
+  sqlite3_int64 nLastRun;   /* Peak growth of the last finished run */
+  sqlite3_int64 mxRunPeak;  /* Largest peak growth of any run */
+} awtk_mem_prof_tag_t;
+
+typedef struct _awtk_mem_prof_frame_t {
+  int tag;
+  bool_t app; /* sqlite3_awtk_mem_prof_tag_begin(), else a statement */
+} awtk_mem_prof_frame_t;
+
+/* Written by its own thread only; taken and given back under the mutex. */
+typedef struct _awtk_mem_prof_thread_t {
+  volatile int32_t ready; /* tid is the owner, lookups may match it */
+  uint64_t tid;
+  int depth;
+  int skipped; /* Frames beyond SQLITE_AWTK_MEM_PROF_DEPTH */
+  awtk_mem_prof_frame_t frames[SQLITE_AWTK_MEM_PROF_DEPTH];
+} awtk_mem_prof_thread_t;
+
+typedef struct _awtk_mem_prof_class_t {
+  sqlite3_int64 nLive;
+  sqlite3_int64 mxLive;
+  sqlite3_int64 nAlloc;
+} awtk_mem_prof_class_t;
+
+static struct {
+  sqlite3_mem_methods inner;
+  tk_mutex_t* mutex;
+  volatile int32_t nTag;
+  awtk_mem_prof_tag_t tags[SQLITE_AWTK_MEM_PROF_TAGS];
+#ifndef AWTK_THREAD_LOCAL
+  awtk_mem_prof_thread_t threads[SQLITE_AWTK_MEM_PROF_THREADS];
+#endif /*AWTK_THREAD_LOCAL*/
+  awtk_mem_prof_class_t classes[AWTK_MEM_PROF_NCLASS];
+  uint64_t since_us;
+} _awtk_mem_prof;
+
+#ifdef AWTK_MEM_PROF_LOCKED
+#define _AWTK_MEM_PROF_LOCK() tk_mutex_lock(_awtk_mem_prof.mutex)
+#define _AWTK_MEM_PROF_UNLOCK() tk_mutex_unlock(_awtk_mem_prof.mutex)
+#define _AWTK_MEM_PROF_ADD(v, n) (((v) += (n)) - (n))
+#define _AWTK_MEM_PROF_MAX(v, n) \
+  if ((n) > (v)) (v) = (n)
+#define _AWTK_MEM_PROF_LOAD(p) (*(p))
+#define _AWTK_MEM_PROF_STORE(p, v) (*(p) = (v))
+#else
+#define _AWTK_MEM_PROF_LOCK()
+#define _AWTK_MEM_PROF_UNLOCK()
+#define _AWTK_MEM_PROF_ADD(v, n) AWTK_ATOMIC_ADD(&(v), (n))
+#define _AWTK_MEM_PROF_MAX(v, n) _awtk_mem_prof_max(&(v), (n))
+#define _AWTK_MEM_PROF_LOAD(p) AWTK_ATOMIC_LOAD(p)
+#define _AWTK_MEM_PROF_STORE(p, v) AWTK_ATOMIC_STORE((p), (v))
+
+static void _awtk_mem_prof_max(sqlite3_int64* v, sqlite3_int64 n) {
+  sqlite3_int64 old = *v;
+
+  while (n > old && !AWTK_ATOMIC_CAS(v, old, n)) {
+    old = *v;
+  }
+}
+#endif /* AWTK_MEM_PROF_LOCKED */
+
+static int _awtk_mem_prof_class_of(int n) {
+  int cls = 0;
+
+  while (cls < AWTK_MEM_PROF_NCLASS - 1 && n > (16 << cls)) {
+    cls++;
+  }
+
+  return cls;
+}
+
+#ifdef AWTK_THREAD_LOCAL
+static AWTK_THREAD_LOCAL awtk_mem_prof_thread_t _awtk_mem_prof_self;
+
+static awtk_mem_prof_thread_t* _awtk_mem_prof_thread(bool_t create) {
+  return &_awtk_mem_prof_self;
+}
+
+static void _awtk_mem_prof_thread_put(awtk_mem_prof_thread_t* t) {
+}
+#else
+/* The calling thread's slot; create (with the mutex held) takes a free one. */
+static awtk_mem_prof_thread_t* _awtk_mem_prof_thread(bool_t create) {
+  int i;
+  uint64_t tid = tk_thread_self();
+
+  for (i = 0; i < SQLITE_AWTK_MEM_PROF_THREADS; i++) {
+    awtk_mem_prof_thread_t* t = &_awtk_mem_prof.threads[i];
+
+    if (_AWTK_MEM_PROF_LOAD(&t->ready) && t->tid == tid) {
+      return t;
+    }
+  }
+
+  for (i = 0; create && i < SQLITE_AWTK_MEM_PROF_THREADS; i++) {
+    awtk_mem_prof_thread_t* t = &_awtk_mem_prof.threads[i];
+
+    if (!t->ready) {
+      t->tid = tid;
+      t->depth = 0;
+      t->skipped = 0;
+      _AWTK_MEM_PROF_STORE(&t->ready, 1);
+      return t;
+    }
+  }
+
+  return NULL;
+}
+
+/* Called with the mutex held: an empty stack gives the slot back. */
+static void _awtk_mem_prof_thread_put(awtk_mem_prof_thread_t* t) {
+  if (t->depth == 0 && t->skipped == 0) {
+    _AWTK_MEM_PROF_STORE(&t->ready, 0);
+  }
+}
+#endif /*AWTK_THREAD_LOCAL*/
+
+/* The tag allocations of the calling thread are charged to. */
+static int _awtk_mem_prof_cur_tag(void) {
+  awtk_mem_prof_thread_t* t = _awtk_mem_prof_thread(FALSE);
+
+  return t != NULL && t->depth > 0 ? t->frames[t->depth - 1].tag : AWTK_MEM_PROF_UNTAGGED;
+}
+
+/* Called with the profiler mutex held; name is normalized already. */
+static int _awtk_mem_prof_tag_of(const char* name) {
+  int i;
+  uint32_t hash = _awtk_trace_hash(name);
+
+  for (i = 2; i < _awtk_mem_prof.nTag; i++) {
+    awtk_mem_prof_tag_t* t = &_awtk_mem_prof.tags[i];
+
+    if (t->hash == hash && strcmp(t->name, name) == 0) {
+      return i;
+    }
+  }
+
+  if (_awtk_mem_prof.nTag >= SQLITE_AWTK_MEM_PROF_TAGS) {
+    return AWTK_MEM_PROF_OTHER;
+  }
+
+  i = _awtk_mem_prof.nTag;
+  _awtk_mem_prof.tags[i].hash = hash;
+  tk_strncpy(_awtk_mem_prof.tags[i].name, name, sizeof(_awtk_mem_prof.tags[i].name) - 1);
+  _AWTK_MEM_PROF_STORE(&_awtk_mem_prof.nTag, i + 1);
+
+  return i;
+}
+
+static void _awtk_mem_prof_account(int tag, int size, int sign) {
+  awtk_mem_prof_tag_t* t = &_awtk_mem_prof.tags[tag];
+  awtk_mem_prof_class_t* c = &_awtk_mem_prof.classes[_awtk_mem_prof_class_of(size)];
+  sqlite3_int64 n = (sqlite3_int64)sign * size;
+  sqlite3_int64 live = _AWTK_MEM_PROF_ADD(t->nLive, n) + n;
+  sqlite3_int64 class_live = _AWTK_MEM_PROF_ADD(c->nLive, n) + n;
+
+  if (sign > 0) {
+    (void)_AWTK_MEM_PROF_ADD(t->nAlloc, 1);
+    (void)_AWTK_MEM_PROF_ADD(t->nBytes, size);
+    (void)_AWTK_MEM_PROF_ADD(c->nAlloc, 1);
+
+    _AWTK_MEM_PROF_MAX(t->mxLive, live);
+    _AWTK_MEM_PROF_MAX(t->mxRun, live - t->nRunBase);
+    _AWTK_MEM_PROF_MAX(c->mxLive, class_live);
+  }
+}
+
+static void* _awtk_mem_prof_malloc(int nByte) {
+  char* p = (char*)_awtk_mem_prof.inner.xMalloc(nByte + AWTK_MEM_PROF_HDR);
+
+  if (p != NULL) {
+    int tag = AWTK_MEM_PROF_UNTAGGED;
+
+    _AWTK_MEM_PROF_LOCK();
+    tag = _awtk_mem_prof_cur_tag();
+    _awtk_mem_prof_account(tag, nByte, 1);
+    _AWTK_MEM_PROF_UNLOCK();
+
+    ((int32_t*)p)[0] = tag;
+    ((int32_t*)p)[1] = nByte;
+    p += AWTK_MEM_PROF_HDR;
+  }
+
+  return p;
+}
+
+static void _awtk_mem_prof_free(void* pPrior) {
+  int32_t* hdr = (int32_t*)((char*)pPrior - AWTK_MEM_PROF_HDR);
+
+  _AWTK_MEM_PROF_LOCK();
+  _awtk_mem_prof_account(hdr[0], hdr[1], -1);
+  _AWTK_MEM_PROF_UNLOCK();
+
+  _awtk_mem_prof.inner.xFree(hdr);
+}
+
+static int _awtk_mem_prof_size(void* pPrior) {
+  return ((int32_t*)((char*)pPrior - AWTK_MEM_PROF_HDR))[1];
+}
+
+static void* _awtk_mem_prof_realloc(void* pPrior, int nByte) {
+  int32_t* hdr = (int32_t*)((char*)pPrior - AWTK_MEM_PROF_HDR);
+  int tag = hdr[0];
+  int old = hdr[1];
+
+  hdr = (int32_t*)_awtk_mem_prof.inner.xRealloc(hdr, nByte + AWTK_MEM_PROF_HDR);
+  if (hdr == NULL) {
+    return NULL;
+  }
+
+  /* a grown block stays charged to the tag that allocated it */
+  _AWTK_MEM_PROF_LOCK();
+  _awtk_mem_prof_account(tag, old, -1);
+  _awtk_mem_prof_account(tag, nByte, 1);
+  _AWTK_MEM_PROF_UNLOCK();
+  hdr[1] = nByte;
+
+  return (char*)hdr + AWTK_MEM_PROF_HDR;
+}
+
+static int _awtk_mem_prof_roundup(int n) {
+  return _awtk_mem_prof.inner.xRoundup(n + AWTK_MEM_PROF_HDR) - AWTK_MEM_PROF_HDR;
+}
+
+static int _awtk_mem_prof_init(void* pAppData) {
+  _awtk_mem_prof.mutex = tk_mutex_create();
+  if (_awtk_mem_prof.mutex == NULL) {
+    return SQLITE_NOMEM;
+  }
+
+  memset(_awtk_mem_prof.tags, 0, sizeof(_awtk_mem_prof.tags));
+#ifndef AWTK_THREAD_LOCAL
+  memset(_awtk_mem_prof.threads, 0, sizeof(_awtk_mem_prof.threads));
+#endif /*AWTK_THREAD_LOCAL*/
+  memset(_awtk_mem_prof.classes, 0, sizeof(_awtk_mem_prof.classes));
+  tk_strncpy(_awtk_mem_prof.tags[AWTK_MEM_PROF_UNTAGGED].name, "(untagged)",
+             SQLITE_AWTK_MEM_PROF_TAG_LEN - 1);
+  tk_strncpy(_awtk_mem_prof.tags[AWTK_MEM_PROF_OTHER].name, "(other)",
+             SQLITE_AWTK_MEM_PROF_TAG_LEN - 1);
+  _awtk_mem_prof.nTag = 2;
+  _awtk_mem_prof.since_us = time_now_us();
+
+  return _awtk_mem_prof.inner.xInit(_awtk_mem_prof.inner.pAppData);
+}
+
+static void _awtk_mem_prof_shutdown(void* pAppData) {
+  _awtk_mem_prof.inner.xShutdown(_awtk_mem_prof.inner.pAppData);
+
+  if (_awtk_mem_prof.mutex != NULL) {
+    tk_mutex_destroy(_awtk_mem_prof.mutex);
+    _awtk_mem_prof.mutex = NULL;
+  }
+}
+
+/*
+** Wrap the allocator configured so far. Call it after any other
+** SQLITE_CONFIG_MALLOC (e.g. sqlite3_awtk_mem_pool_install()) and before
+** sqlite3_initialize().
+*/
+SQLITE_API int sqlite3_awtk_mem_prof_install(void) {
+  static const sqlite3_mem_methods methods = {
+      _awtk_mem_prof_malloc,  _awtk_mem_prof_free, _awtk_mem_prof_realloc,
+      _awtk_mem_prof_size,    _awtk_mem_prof_roundup, _awtk_mem_prof_init,
+      _awtk_mem_prof_shutdown, 0};
+  int rc = sqlite3_config(SQLITE_CONFIG_GETMALLOC, &_awtk_mem_prof.inner);
+
+  /* nothing configured yet: wrap the allocator sqlite3_initialize() would pick */
+  if (rc == SQLITE_OK && _awtk_mem_prof.inner.xMalloc == NULL) {
+    sqlite3MemSetDefault();
+    rc = sqlite3_config(SQLITE_CONFIG_GETMALLOC, &_awtk_mem_prof.inner);
+  }
+
+  if (rc == SQLITE_OK && _awtk_mem_prof.inner.xMalloc == _awtk_mem_prof_malloc) {
+    return SQLITE_MISUSE;
+  }
+
+  return rc == SQLITE_OK ? sqlite3_config(SQLITE_CONFIG_MALLOC, &methods) : rc;
+}
+
+/* Push the tag of name on the calling thread's stack; returns the tag before. */
+static int _awtk_mem_prof_push(const char* name, bool_t app) {
+  int prev = AWTK_MEM_PROF_UNTAGGED;
+  char norm[SQLITE_AWTK_MEM_PROF_TAG_LEN];
+  awtk_mem_prof_thread_t* t = NULL;
+
+  _awtk_trace_normalize(name != NULL ? name : "", norm, sizeof(norm));
+
+  tk_mutex_lock(_awtk_mem_prof.mutex);
+  t = _awtk_mem_prof_thread(TRUE);
+  if (t != NULL) {
+    prev = t->depth > 0 ? t->frames[t->depth - 1].tag : AWTK_MEM_PROF_UNTAGGED;
+    if (t->depth < SQLITE_AWTK_MEM_PROF_DEPTH) {
+      awtk_mem_prof_frame_t* f = &t->frames[t->depth];
+      awtk_mem_prof_tag_t* tag = NULL;
+
+      f->tag = _awtk_mem_prof_tag_of(norm);
+      f->app = app;
+      tag = &_awtk_mem_prof.tags[f->tag];
+      tag->nRunBase = tag->nLive;
+      tag->mxRun = 0;
+      t->depth++;
+    } else {
+      t->skipped++;
+    }
+  }
+  tk_mutex_unlock(_awtk_mem_prof.mutex);
+
+  return prev;
+}
+
+/*
+** Pop the innermost frame of the calling thread that is an application tag
+** (app) or the statement name; frames pushed after it stay, so runs that
+** end out of order still find their own frame.
+*/
+static void _awtk_mem_prof_pop(const char* name, bool_t app) {
+  int i;
+  int tag = AWTK_MEM_PROF_UNTAGGED;
+  char norm[SQLITE_AWTK_MEM_PROF_TAG_LEN];
+  awtk_mem_prof_thread_t* t = NULL;
+
+  if (!app) {
+    _awtk_trace_normalize(name, norm, sizeof(norm));
+  }
+
+  tk_mutex_lock(_awtk_mem_prof.mutex);
+  t = _awtk_mem_prof_thread(FALSE);
+  if (t != NULL) {
+    if (!app) {
+      tag = _awtk_mem_prof_tag_of(norm);
+    }
+
+    for (i = t->depth - 1; i >= 0; i--) {
+      if (t->frames[i].app == app && (app || t->frames[i].tag == tag)) {
+        break;
+      }
+    }
+
+    if (i >= 0) {
+      awtk_mem_prof_tag_t* run = &_awtk_mem_prof.tags[t->frames[i].tag];
+
+      run->nRun++;
+      run->nLastRun = run->mxRun;
+      if (run->mxRun > run->mxRunPeak) {
+        run->mxRunPeak = run->mxRun;
+      }
+
+      /* only the owner reads its frames, it is here */
+      memmove(t->frames + i, t->frames + i + 1, (t->depth - i - 1) * sizeof(t->frames[0]));
+      t->depth--;
+    } else if (t->skipped > 0) {
+      t->skipped--;
+    }
+    _awtk_mem_prof_thread_put(t);
+  }
+  tk_mutex_unlock(_awtk_mem_prof.mutex);
+}
+
+static int _awtk_mem_prof_on_trace(unsigned mask, void* ctx, void* p, void* x) {
+  const char* sql = sqlite3_sql((sqlite3_stmt*)p);
+
+  if (sql == NULL || _awtk_mem_prof.mutex == NULL) {
+    return 0;
+  }
+
+  if (mask == SQLITE_TRACE_STMT) {
+    /* statements inside triggers report "-- ..." and belong to the outer one */
+    if (((const char*)x)[0] != '-' || ((const char*)x)[1] != '-') {
+      _awtk_mem_prof_push(sql, FALSE);
+    }
+  } else if (mask == SQLITE_TRACE_PROFILE) {
+    _awtk_mem_prof_pop(sql, FALSE);
+  }
+
+  return 0;
+}
+
+SQLITE_API int sqlite3_awtk_mem_prof_attach(sqlite3* db) {
+  return sqlite3_awtk_trace_add(db, SQLITE_TRACE_STMT | SQLITE_TRACE_PROFILE,
+                                _awtk_mem_prof_on_trace, NULL);
+}
+
+SQLITE_API int sqlite3_awtk_mem_prof_tag_begin(const char* zTag) {
+  if (_awtk_mem_prof.mutex == NULL) {
+    return 0;
+  }
+
+  return _awtk_mem_prof_push(zTag, TRUE);
+}
+
+/* Tags nest: this ends the innermost open sqlite3_awtk_mem_prof_tag_begin(). */
+SQLITE_API void sqlite3_awtk_mem_prof_tag_end(int iPrev) {
+  if (_awtk_mem_prof.mutex == NULL) {
+    return;
+  }
+
+  (void)iPrev;
+  _awtk_mem_prof_pop(NULL, TRUE);
+}
+
+SQLITE_API int sqlite3_awtk_mem_prof_tag_get(int iTag, sqlite3_awtk_mem_prof_tag* pTag) {
+  int rc = SQLITE_RANGE;
+  uint64_t secs = 0;
+
+  if (_awtk_mem_prof.mutex == NULL) {
+    return SQLITE_MISUSE;
+  }
+
+  tk_mutex_lock(_awtk_mem_prof.mutex);
+  if (iTag >= 0 && iTag < _awtk_mem_prof.nTag) {
+    awtk_mem_prof_tag_t* t = &_awtk_mem_prof.tags[iTag];
+
+    secs = (time_now_us() - _awtk_mem_prof.since_us) / 1000000;
+    pTag->zName = t->name;
+    pTag->nLive = t->nLive;
+    pTag->mxLive = t->mxLive;
+    pTag->nAlloc = t->nAlloc;
+    pTag->nBytes = t->nBytes;
+    pTag->nAllocPerSec = secs > 0 ? t->nAlloc / (sqlite3_int64)secs : t->nAlloc;
+    pTag->nRun = t->nRun;
+    pTag->nLastRunPeak = t->nLastRun;
+    pTag->mxRunPeak = t->mxRunPeak;
+    rc = SQLITE_OK;
+  }
+  tk_mutex_unlock(_awtk_mem_prof.mutex);
+
+  return rc;
+}
+
+/*
+** Clear counters and peaks; live bytes stay since those blocks are still out.
+** Allocations made meanwhile may be counted before or after the reset.
+*/
+SQLITE_API void sqlite3_awtk_mem_prof_reset(void) {
+  int i;
+
+  if (_awtk_mem_prof.mutex == NULL) {
+    return;
+  }
+
+  tk_mutex_lock(_awtk_mem_prof.mutex);
+  for (i = 0; i < _awtk_mem_prof.nTag; i++) {
+    awtk_mem_prof_tag_t* t = &_awtk_mem_prof.tags[i];
+
+    t->mxLive = t->nLive;
+    t->nAlloc = 0;
+    t->nBytes = 0;
+    t->nRun = 0;
+    t->nLastRun = 0;
+    t->mxRunPeak = 0;
+  }
+  for (i = 0; i < AWTK_MEM_PROF_NCLASS; i++) {
+    _awtk_mem_prof.classes[i].mxLive = _awtk_mem_prof.classes[i].nLive;
+    _awtk_mem_prof.classes[i].nAlloc = 0;
+  }
+  _awtk_mem_prof.since_us = time_now_us();
+  tk_mutex_unlock(_awtk_mem_prof.mutex);
+}
+
+/* Called with the profiler mutex held. */
+static bool_t _awtk_mem_prof_heavier(int a, int b) {
+  awtk_mem_prof_tag_t* ta = &_awtk_mem_prof.tags[a];
+  awtk_mem_prof_tag_t* tb = &_awtk_mem_prof.tags[b];
+
+  if (ta->mxRunPeak != tb->mxRunPeak) {
+    return ta->mxRunPeak > tb->mxRunPeak;
+  }
+
+  return ta->mxLive > tb->mxLive;
+}
+
+/* Log the size classes and the nTop tags with the largest single-run peak. */
+SQLITE_API void sqlite3_awtk_mem_prof_dump(int nTop) {
+  int i;
+  int n = 0;
+  int order[SQLITE_AWTK_MEM_PROF_TAGS];
+  awtk_mem_prof_class_t classes[AWTK_MEM_PROF_NCLASS];
+  sqlite3_awtk_mem_prof_tag tag;
+
+  if (_awtk_mem_prof.mutex == NULL) {
+    return;
+  }
+
+  tk_mutex_lock(_awtk_mem_prof.mutex);
+  memcpy(classes, _awtk_mem_prof.classes, sizeof(classes));
+  n = _awtk_mem_prof.nTag;
+  for (i = 0; i < n; i++) {
+    int j = i;
+
+    /* insertion sort, heaviest first */
+
+    while (j > 0 && _awtk_mem_prof_heavier(i, order[j - 1])) {
+      order[j] = order[j - 1];
+      j--;
+    }
+    order[j] = i;
+  }
+  tk_mutex_unlock(_awtk_mem_prof.mutex);
+
+  log_info("%8s %12s %12s %10s\n", "class", "live", "peak", "allocs");
+  for (i = 0; i < AWTK_MEM_PROF_NCLASS; i++) {
+    if (classes[i].nAlloc > 0 || classes[i].nLive > 0) {
+      if (i == AWTK_MEM_PROF_NCLASS - 1) {
+        log_info("%7s+ %12lld %12lld %10lld\n", "64K", (long long)classes[i].nLive,
+                 (long long)classes[i].mxLive, (long long)classes[i].nAlloc);
+      } else {
+        log_info("%8d %12lld %12lld %10lld\n", 16 << i, (long long)classes[i].nLive,
+                 (long long)classes[i].mxLive, (long long)classes[i].nAlloc);
+      }
+    }
+  }
+
+  log_info("%12s %12s %12s %10s %8s %6s  %s\n", "run_peak", "live", "peak", "allocs", "alloc/s",
+           "runs", "tag");
+  for (i = 0; i < n && (nTop <= 0 || i < nTop); i++) {
+    if (sqlite3_awtk_mem_prof_tag_get(order[i], &tag) == SQLITE_OK && tag.nAlloc + tag.nLive > 0) {
+      log_info("%12lld %12lld %12lld %10lld %8lld %6lld  %s\n", (long long)tag.mxRunPeak,
+               (long long)tag.nLive, (long long)tag.mxLive, (long long)tag.nAlloc,
+               (long long)tag.nAllocPerSec, (long long)tag.nRun, tag.zName);
+    }
+  }
+}
+
+#endif /* SQLITE_AWTK_ENABLE_MEM_PROF */
@@ -1,16 +1,116 @@
 #if defined(SQLITE_MUTEX_AWTK)
 #include "awtk.h"
+#include "tkc/mutex.h"
 #include "tkc/mutex_nest.h"
 
+#include "tkc/semaphore.h"
+#include "tkc/thread.h"
+#include "awtk_atomic.h"
+#include "sqlite3_awtk.h"
+#include "awtk_boot_prof.h"
+#include "awtk_chrome_trace.h"
+#include "awtk_probes.h"
+
+#if defined(_MSC_VER) && !defined(SQLITE_MEMORY_BARRIER)
+#include <intrin.h>
+#endif
+
+/*
+** How many times an adaptive mutex polls the lock word before the caller is
+** parked on the semaphore. Use 0 on single-core targets, where spinning only
+** delays the thread that holds the lock.
+*/
+#ifndef SQLITE_AWTK_MUTEX_SPIN
+#define SQLITE_AWTK_MUTEX_SPIN 100
+#endif
+
+/*
+** A parked thread re-checks the lock word at least this often (ms).
+*/
+#ifndef SQLITE_AWTK_MUTEX_PARK_MS
+#define SQLITE_AWTK_MUTEX_PARK_MS 50
+#endif
+
 /*
 * rt-thread mutex
+*
+* SQLITE_MUTEX_RECURSIVE is backed by tk_mutex_nest_t. SQLITE_MUTEX_FAST and
+* the static mutexes are never entered recursively by SQLite (mutex_unix.c uses
+* plain pthread mutexes for them too), so they use tk_mutex_t and skip the
+* owner check and nesting counter of tk_mutex_nest_t.
+*
+* The static mutexes that are held for a few instructions but taken by every
+* thread (MEM, PRNG, LRU) use SQLITE_AWTK_MUTEX_HOT. It is the plain mutex
+* unless SQLITE_AWTK_MULTI_THREAD (the linux-throughput profile): on an RTOS
+* tk_mutex keeps the priority inheritance that a waiter parked on the
+* adaptive mutex's semaphore loses. The adaptive mutex is an atomic lock word
+* that spins SQLITE_AWTK_MUTEX_SPIN times before sleeping on a semaphore.
+* Define SQLITE_AWTK_MUTEX_HOT, or see sqlite3_awtk_mutex_set_kind().
 */
 struct sqlite3_mutex {
-  tk_mutex_nest_t* mutex;
-  int id; /* Mutex type */
+  int id;   /* Mutex type */
+  int kind; /* SQLITE_AWTK_MUTEX_xxx */
+  union {
+    tk_mutex_t* plain;
+    tk_mutex_nest_t* nest;
+    tk_semaphore_t* sem; /* Adaptive: parked waiters sleep here */
+  } u;
+  volatile int32_t state;   /* Adaptive: 0 free, 1 locked */
+  volatile int32_t waiters; /* Adaptive: threads parked or about to park */
+  volatile int32_t posted;  /* Adaptive: 1 while a post is not consumed yet */
+#ifdef SQLITE_AWTK_MUTEX_STATS
+  int depth;                 /* Recursion depth of the owner */
+  sqlite3_uint64 acquired_us; /* When the owner took the mutex */
+#endif
+};
+
+#ifndef SQLITE_AWTK_MUTEX_HOT
+#if defined(SQLITE_AWTK_MULTI_THREAD) && !defined(AWTK_ATOMIC_NONE)
+#define SQLITE_AWTK_MUTEX_HOT SQLITE_AWTK_MUTEX_ADAPTIVE
+#else
+#define SQLITE_AWTK_MUTEX_HOT SQLITE_AWTK_MUTEX_PLAIN
+#endif
+#elif defined(AWTK_ATOMIC_NONE)
+#undef SQLITE_AWTK_MUTEX_HOT
+#define SQLITE_AWTK_MUTEX_HOT SQLITE_AWTK_MUTEX_PLAIN
+#endif /*SQLITE_AWTK_MUTEX_HOT*/
+
+/* indexed by mutex id */
+static int _awtk_mutex_kind[SQLITE_MUTEX_STATIC_VFS3 + 1] = {
+    SQLITE_AWTK_MUTEX_PLAIN, /* SQLITE_MUTEX_FAST */
+    SQLITE_AWTK_MUTEX_NEST,  /* SQLITE_MUTEX_RECURSIVE */
+    SQLITE_AWTK_MUTEX_PLAIN, /* SQLITE_MUTEX_STATIC_MASTER */
+    SQLITE_AWTK_MUTEX_HOT,   /* SQLITE_MUTEX_STATIC_MEM */
+    SQLITE_AWTK_MUTEX_PLAIN, /* SQLITE_MUTEX_STATIC_OPEN */
+    SQLITE_AWTK_MUTEX_HOT,   /* SQLITE_MUTEX_STATIC_PRNG */
+    SQLITE_AWTK_MUTEX_HOT,   /* SQLITE_MUTEX_STATIC_LRU */
+    SQLITE_AWTK_MUTEX_PLAIN, /* SQLITE_MUTEX_STATIC_PMEM */
+    SQLITE_AWTK_MUTEX_PLAIN, /* SQLITE_MUTEX_STATIC_APP1 */
+    SQLITE_AWTK_MUTEX_PLAIN, /* SQLITE_MUTEX_STATIC_APP2 */
+    SQLITE_AWTK_MUTEX_PLAIN, /* SQLITE_MUTEX_STATIC_APP3 */
+    SQLITE_AWTK_MUTEX_PLAIN, /* SQLITE_MUTEX_STATIC_VFS1 */
+    SQLITE_AWTK_MUTEX_PLAIN, /* SQLITE_MUTEX_STATIC_VFS2 */
+    SQLITE_AWTK_MUTEX_PLAIN, /* SQLITE_MUTEX_STATIC_VFS3 */
 };
 
+/*
+** Full memory barrier: keep the compiler from moving loads and stores across
+** it and make the CPU complete them before continuing.
+*/
 SQLITE_PRIVATE void sqlite3MemoryBarrier(void) {
+#if defined(SQLITE_MEMORY_BARRIER)
+  SQLITE_MEMORY_BARRIER;
+#elif defined(__GNUC__) || defined(__clang__)
+  __asm__ __volatile__("" ::: "memory");
+  __sync_synchronize();
+#elif defined(_MSC_VER)
+  _ReadWriteBarrier();
+#if defined(_M_IX86) || defined(_M_X64)
+  _mm_mfence();
+#elif defined(_M_ARM) || defined(_M_ARM64)
+  __dmb(0xB); /* _ARM64_BARRIER_ISH */
+#endif
+#endif
 }
 
 /*
@@ -54,28 +154,148 @@ For the static mutex types, the same mutex is returned on every call that has th
 */
 static sqlite3_mutex _static_mutex[12];
 
-static int _awtk_mtx_init(void) {
+static int _awtk_mutex_create(sqlite3_mutex* p, int id) {
+  p->id = id;
+  p->kind = _awtk_mutex_kind[id];
+  p->state = 0;
+  p->waiters = 0;
+  p->posted = 0;
+#ifdef SQLITE_AWTK_MUTEX_STATS
+  p->depth = 0;
+#endif
+
+  switch (p->kind) {
+    case SQLITE_AWTK_MUTEX_NEST:
+      p->u.nest = tk_mutex_nest_create();
+      break;
+
+    case SQLITE_AWTK_MUTEX_ADAPTIVE:
+      p->u.sem = tk_semaphore_create(0, "sqlite3_mutex");
+      break;
+
+    default:
+      p->u.plain = tk_mutex_create();
+      break;
+  }
+
+  return p->u.plain != NULL ? SQLITE_OK : SQLITE_NOMEM;
+}
+
+static void _awtk_mutex_destroy(sqlite3_mutex* p) {
+  if (p->u.plain == NULL) {
+    return;
+  }
+
+  switch (p->kind) {
+    case SQLITE_AWTK_MUTEX_NEST:
+      tk_mutex_nest_destroy(p->u.nest);
+      break;
+
+    case SQLITE_AWTK_MUTEX_ADAPTIVE:
+      tk_semaphore_destroy(p->u.sem);
+      break;
+
+    default:
+      tk_mutex_destroy(p->u.plain);
+      break;
+  }
+
+  p->u.plain = NULL;
+}
+
+#ifndef AWTK_ATOMIC_NONE
+static void _awtk_adaptive_lock(sqlite3_mutex* p) {
   int i;
 
-  for (i = 0; i < sizeof(_static_mutex) / sizeof(_static_mutex[0]); i++) {
-    _static_mutex[i].mutex = tk_mutex_nest_create();
+  if (AWTK_ATOMIC_CAS(&p->state, 0, 1)) {
+    return;
+  }
 
-    if (_static_mutex[i].mutex == NULL) {
-      return SQLITE_ERROR;
+  for (i = 0; i < SQLITE_AWTK_MUTEX_SPIN; i++) {
+    AWTK_CPU_RELAX();
+    if (AWTK_ATOMIC_LOAD(&p->state) == 0 && AWTK_ATOMIC_CAS(&p->state, 0, 1)) {
+      return;
     }
   }
 
-  return SQLITE_OK;
+  /*
+  ** Park on the semaphore. The waiter count is raised before the lock word
+  ** is tried again and the owner clears the lock word before it reads the
+  ** count, both with full barriers, so either the waiter sees the lock free
+  ** or the owner sees the waiter. At most one post is outstanding: the
+  ** semaphore count stays at 0 or 1 however many times the lock is released,
+  ** and the timeout covers a waiter that sleeps through a post another
+  ** waiter consumed.
+  */
+  AWTK_ATOMIC_ADD(&p->waiters, 1);
+  while (!AWTK_ATOMIC_CAS(&p->state, 0, 1)) {
+    AWTK_PROBE_CLOCK(start);
+
+    if (tk_semaphore_wait(p->u.sem, SQLITE_AWTK_MUTEX_PARK_MS) == RET_OK) {
+      AWTK_ATOMIC_STORE(&p->posted, 0);
+    }
+    AWTK_PROBE3(sem_wait, p, p->id, time_now_us() - start);
+  }
+  AWTK_ATOMIC_ADD(&p->waiters, -1);
 }
 
+static void _awtk_adaptive_unlock(sqlite3_mutex* p) {
+  AWTK_ATOMIC_XCHG(&p->state, 0);
+  if (AWTK_ATOMIC_LOAD(&p->waiters) > 0 && AWTK_ATOMIC_CAS(&p->posted, 0, 1)) {
+    tk_semaphore_post(p->u.sem);
+  }
+}
+#endif /* AWTK_ATOMIC_NONE */
+
+/*
+** Targets without lock-free 64-bit atomics (Cortex-M0/M3/M4: gcc would call
+** __sync_val_compare_and_swap_8, which nothing provides) update the
+** counters under a lock of their own instead.
+*/
+#if defined(SQLITE_AWTK_MUTEX_STATS) &&  \
+    (defined(AWTK_ATOMIC_NONE) ||         \
+     (defined(__GNUC__) && !defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_8)))
+#define AWTK_MUTEX_STATS_LOCKED 1
+static tk_mutex_t* _awtk_mutex_stats_lock;
+#endif
+
 static int _awtk_mtx_end(void) {
   int i;
 
   for (i = 0; i < sizeof(_static_mutex) / sizeof(_static_mutex[0]); i++) {
-    tk_mutex_nest_destroy(_static_mutex[i].mutex);
-    _static_mutex[i].mutex = NULL;
+    _awtk_mutex_destroy(&_static_mutex[i]);
+  }
+
+#ifdef AWTK_MUTEX_STATS_LOCKED
+  if (_awtk_mutex_stats_lock != NULL) {
+    tk_mutex_destroy(_awtk_mutex_stats_lock);
+    _awtk_mutex_stats_lock = NULL;
+  }
+#endif
+
+  return SQLITE_OK;
+}
+
+static int _awtk_mtx_init(void) {
+  int i;
+  AWTK_BOOT_BEGIN();
+
+#ifdef AWTK_MUTEX_STATS_LOCKED
+  _awtk_mutex_stats_lock = tk_mutex_create();
+  if (_awtk_mutex_stats_lock == NULL) {
+    return SQLITE_NOMEM;
+  }
+#endif
+
+  for (i = 0; i < sizeof(_static_mutex) / sizeof(_static_mutex[0]); i++) {
+    if (_awtk_mutex_create(&_static_mutex[i], i + 2) != SQLITE_OK) {
+      /* release the ones already created, SQLite does not call xMutexEnd */
+      _awtk_mtx_end();
+      return SQLITE_ERROR;
+    }
   }
 
+  AWTK_BOOT_END(SQLITE_AWTK_BOOT_MUTEX_INIT);
   return SQLITE_OK;
 }
 
@@ -85,11 +305,11 @@ static sqlite3_mutex* _awtk_mtx_alloc(int id) {
   switch (id) {
     case SQLITE_MUTEX_FAST:
     case SQLITE_MUTEX_RECURSIVE:
-      p = sqlite3Malloc(sizeof(sqlite3_mutex));
+      p = sqlite3MallocZero(sizeof(sqlite3_mutex));
 
-      if (p != NULL) {
-        p->mutex = tk_mutex_nest_create();
-        p->id = id;
+      if (p != NULL && _awtk_mutex_create(p, id) != SQLITE_OK) {
+        sqlite3_free(p);
+        p = NULL;
       }
       break;
 
@@ -97,7 +317,6 @@ static sqlite3_mutex* _awtk_mtx_alloc(int id) {
       assert(id - 2 >= 0);
       assert(id - 2 < ArraySize(_static_mutex));
       p = &_static_mutex[id - 2];
-      p->id = id;
       break;
   }
 
@@ -107,40 +326,275 @@ static sqlite3_mutex* _awtk_mtx_alloc(int id) {
 static void _awtk_mtx_free(sqlite3_mutex* p) {
   assert(p != 0);
 
-  tk_mutex_nest_destroy(p->mutex);
-
   switch (p->id) {
     case SQLITE_MUTEX_FAST:
     case SQLITE_MUTEX_RECURSIVE:
+      _awtk_mutex_destroy(p);
       sqlite3_free(p);
       break;
 
     default:
+      /* static mutexes are released by _awtk_mtx_end */
+      break;
+  }
+}
+
+static void _awtk_mutex_lock(sqlite3_mutex* p) {
+  switch (p->kind) {
+    case SQLITE_AWTK_MUTEX_NEST:
+      tk_mutex_nest_lock(p->u.nest);
+      break;
+
+#ifndef AWTK_ATOMIC_NONE
+    case SQLITE_AWTK_MUTEX_ADAPTIVE:
+      _awtk_adaptive_lock(p);
+      break;
+#endif
+
+    default:
+      tk_mutex_lock(p->u.plain);
       break;
   }
 }
 
+static ret_t _awtk_mutex_try_lock(sqlite3_mutex* p) {
+  ret_t ret;
+
+  switch (p->kind) {
+    case SQLITE_AWTK_MUTEX_NEST:
+      ret = tk_mutex_nest_try_lock(p->u.nest);
+      break;
+
+#ifndef AWTK_ATOMIC_NONE
+    case SQLITE_AWTK_MUTEX_ADAPTIVE:
+      ret = AWTK_ATOMIC_CAS(&p->state, 0, 1) ? RET_OK : RET_BUSY;
+      break;
+#endif
+
+    default:
+      ret = tk_mutex_try_lock(p->u.plain);
+      break;
+  }
+
+  return ret;
+}
+
+static void _awtk_mutex_unlock(sqlite3_mutex* p) {
+  switch (p->kind) {
+    case SQLITE_AWTK_MUTEX_NEST:
+      tk_mutex_nest_unlock(p->u.nest);
+      break;
+
+#ifndef AWTK_ATOMIC_NONE
+    case SQLITE_AWTK_MUTEX_ADAPTIVE:
+      _awtk_adaptive_unlock(p);
+      break;
+#endif
+
+    default:
+      tk_mutex_unlock(p->u.plain);
+      break;
+  }
+}
+
+#ifdef SQLITE_AWTK_MUTEX_STATS
+/*
+** Statistics per mutex id; dynamic mutexes are aggregated under
+** SQLITE_MUTEX_FAST and SQLITE_MUTEX_RECURSIVE. Several threads may update the
+** same slot (different dynamic mutexes), so counters are updated atomically,
+** or under _awtk_mutex_stats_lock (AWTK_MUTEX_STATS_LOCKED).
+*/
+static sqlite3_awtk_mutex_stats _awtk_mutex_stats[SQLITE_MUTEX_STATIC_VFS3 + 1];
+
+#ifdef AWTK_MUTEX_STATS_LOCKED
+#define _AWTK_STATS_LOCK() tk_mutex_lock(_awtk_mutex_stats_lock)
+#define _AWTK_STATS_UNLOCK() tk_mutex_unlock(_awtk_mutex_stats_lock)
+#define _AWTK_STAT_ADD(v, n) (v) += (n)
+#define _AWTK_STAT_MAX(v, n) \
+  if ((n) > (v)) (v) = (n)
+#else
+#define _AWTK_STATS_LOCK()
+#define _AWTK_STATS_UNLOCK()
+#define _AWTK_STAT_ADD(v, n) AWTK_ATOMIC_ADD(&(v), (n))
+#define _AWTK_STAT_MAX(v, n) _awtk_stat_max(&(v), (n))
+
+static void _awtk_stat_max(sqlite3_uint64* v, sqlite3_uint64 n) {
+  sqlite3_uint64 old = *v;
+
+  while (n > old && !AWTK_ATOMIC_CAS(v, old, n)) {
+    old = *v;
+  }
+}
+#endif /* AWTK_MUTEX_STATS_LOCKED */
+
+static void _awtk_mutex_stats_acquired(sqlite3_mutex* p, sqlite3_uint64 wait_us, int contended) {
+  sqlite3_awtk_mutex_stats* stats = &_awtk_mutex_stats[p->id];
+
+  _AWTK_STATS_LOCK();
+  _AWTK_STAT_ADD(stats->nAcquire, 1);
+  if (contended) {
+    _AWTK_STAT_ADD(stats->nContended, 1);
+    _AWTK_STAT_ADD(stats->nWaitUs, wait_us);
+    _AWTK_STAT_MAX(stats->mxWaitUs, wait_us);
+  }
+  _AWTK_STATS_UNLOCK();
+
+  /* only the owner touches depth and acquired_us */
+  if (p->depth++ == 0) {
+    p->acquired_us = time_now_us();
+  }
+}
+
+static void _awtk_mutex_stats_released(sqlite3_mutex* p) {
+  sqlite3_awtk_mutex_stats* stats = &_awtk_mutex_stats[p->id];
+
+  if (--p->depth == 0) {
+    sqlite3_uint64 hold_us = time_now_us() - p->acquired_us;
+
+    _AWTK_STATS_LOCK();
+    _AWTK_STAT_ADD(stats->nHoldUs, hold_us);
+    _AWTK_STAT_MAX(stats->mxHoldUs, hold_us);
+    _AWTK_STATS_UNLOCK();
+  }
+}
+#endif /* SQLITE_AWTK_MUTEX_STATS */
+
 static void _awtk_mtx_enter(sqlite3_mutex* p) {
   assert(p != 0);
 
-  tk_mutex_nest_lock(p->mutex);
+#if defined(SQLITE_AWTK_MUTEX_STATS) || defined(SQLITE_AWTK_ENABLE_CHROME_TRACE) || \
+    defined(AWTK_PROBES_ON)
+  if (_awtk_mutex_try_lock(p) == RET_OK) {
+#ifdef SQLITE_AWTK_MUTEX_STATS
+    _awtk_mutex_stats_acquired(p, 0, 0);
+#endif
+  } else {
+    sqlite3_uint64 wait_us = time_now_us();
+    AWTK_CTRACE_START(trace_start);
+
+    _awtk_mutex_lock(p);
+    wait_us = time_now_us() - wait_us;
+#ifdef SQLITE_AWTK_MUTEX_STATS
+    _awtk_mutex_stats_acquired(p, wait_us, 1);
+#endif
+    AWTK_CTRACE_END(AWTK_CTRACE_MUTEX_WAIT, trace_start, 0, p->id, SQLITE_OK);
+    AWTK_PROBE3(mutex_contended, p, p->id, wait_us);
+  }
+#else
+  _awtk_mutex_lock(p);
+#endif
 }
 
 static int _awtk_mtx_try(sqlite3_mutex* p) {
   assert(p != 0);
 
-  if (tk_mutex_nest_try_lock(p->mutex) == RET_OK) {
+  if (_awtk_mutex_try_lock(p) != RET_OK) {
     return SQLITE_BUSY;
   }
 
+#ifdef SQLITE_AWTK_MUTEX_STATS
+  _awtk_mutex_stats_acquired(p, 0, 0);
+#endif
+
   return SQLITE_OK;
 }
 
 static void _awtk_mtx_leave(sqlite3_mutex* p) {
   assert(p != 0);
-  tk_mutex_nest_unlock(p->mutex);
+
+#ifdef SQLITE_AWTK_MUTEX_STATS
+  _awtk_mutex_stats_released(p);
+#endif
+  _awtk_mutex_unlock(p);
+}
+
+/*
+** Select the implementation used for mutex type "id". Dynamic mutexes pick
+** it up on their next sqlite3_mutex_alloc(); static mutexes must be changed
+** before sqlite3_initialize() (or after sqlite3_shutdown()).
+*/
+SQLITE_API int sqlite3_awtk_mutex_set_kind(int id, int kind) {
+  if (id < 0 || id >= ArraySize(_awtk_mutex_kind)) {
+    return SQLITE_RANGE;
+  }
+
+  if (kind != SQLITE_AWTK_MUTEX_PLAIN && kind != SQLITE_AWTK_MUTEX_NEST &&
+      kind != SQLITE_AWTK_MUTEX_ADAPTIVE) {
+    return SQLITE_MISUSE;
+  }
+
+#ifdef AWTK_ATOMIC_NONE
+  if (kind == SQLITE_AWTK_MUTEX_ADAPTIVE) {
+    return SQLITE_ERROR;
+  }
+#endif
+
+  /* SQLite relies on SQLITE_MUTEX_RECURSIVE being recursive */
+  if (id == SQLITE_MUTEX_RECURSIVE && kind != SQLITE_AWTK_MUTEX_NEST) {
+    return SQLITE_MISUSE;
+  }
+
+  if (id >= 2 && _static_mutex[id - 2].u.plain != NULL) {
+    return SQLITE_MISUSE;
+  }
+
+  _awtk_mutex_kind[id] = kind;
+
+  return SQLITE_OK;
 }
 
+SQLITE_API int sqlite3_awtk_mutex_get_kind(int id) {
+  if (id < 0 || id >= ArraySize(_awtk_mutex_kind)) {
+    return 0;
+  }
+
+  return _awtk_mutex_kind[id];
+}
+
+#ifdef SQLITE_AWTK_MUTEX_STATS
+SQLITE_API int sqlite3_awtk_mutex_stats_get(int id, sqlite3_awtk_mutex_stats* pStats) {
+  if (id < 0 || id >= ArraySize(_awtk_mutex_stats) || pStats == NULL) {
+    return SQLITE_RANGE;
+  }
+
+  _AWTK_STATS_LOCK();
+  *pStats = _awtk_mutex_stats[id];
+  _AWTK_STATS_UNLOCK();
+
+  return SQLITE_OK;
+}
+
+SQLITE_API void sqlite3_awtk_mutex_stats_reset(void) {
+  _AWTK_STATS_LOCK();
+  memset(_awtk_mutex_stats, 0, sizeof(_awtk_mutex_stats));
+  _AWTK_STATS_UNLOCK();
+}
+
+SQLITE_API void sqlite3_awtk_mutex_stats_dump(void) {
+  int i;
+  static const char* names[] = {"fast", "recursive", "static_master", "static_mem",
+                                "static_open", "static_prng", "static_lru", "static_pmem",
+                                "static_app1", "static_app2", "static_app3", "static_vfs1",
+                                "static_vfs2", "static_vfs3"};
+
+  log_info("%-14s %12s %10s %12s %10s %12s %10s\n", "mutex", "acquire", "contended",
+           "wait_us", "max_wait", "hold_us", "max_hold");
+
+  for (i = 0; i < ArraySize(_awtk_mutex_stats); i++) {
+    sqlite3_awtk_mutex_stats* stats = &_awtk_mutex_stats[i];
+
+    if (stats->nAcquire == 0) {
+      continue;
+    }
+
+    log_info("%-14s %12llu %10llu %12llu %10llu %12llu %10llu\n", names[i],
+             (unsigned long long)stats->nAcquire, (unsigned long long)stats->nContended,
+             (unsigned long long)stats->nWaitUs, (unsigned long long)stats->mxWaitUs,
+             (unsigned long long)stats->nHoldUs, (unsigned long long)stats->mxHoldUs);
+  }
+}
+#endif /* SQLITE_AWTK_MUTEX_STATS */
+
 #ifdef SQLITE_DEBUG
 
 /*
@@ -177,4 +631,6 @@ SQLITE_PRIVATE sqlite3_mutex_methods const* sqlite3DefaultMutex(void) {
   return &sMutex;
 }
 
+#include "awtk_threads.h"
+
 #endif /* SQLITE_MUTEX_AWTK */
@@ -0,0 +1,670 @@
+#ifdef SQLITE_AWTK_ENABLE_PCACHE
+/*
+** Page cache (SQLITE_CONFIG_PCACHE2) for the AWTK port.
+**
+** Pages live in chunks of contiguous slots; each slot holds the bookkeeping
+** header, the page buffer and the pager's extra bytes. Eviction is CLOCK: a
+** hand sweeps the slots chunk by chunk, clears the reference bit of recently
+** used pages and recycles the first unpinned page without one. A hit only
+** sets the reference bit, there is no list to splice.
+**
+** Optionally all purgeable caches share one budget of nSharedMax slots, so
+** their page memory stays bounded. A cache that needs memory while the budget
+** is exhausted takes pages from the cache that fetched least recently among
+** those holding more than nMinPerCache pages, which may be itself; the
+** victim's chunks are freed as they empty. Shared chunks are small so a
+** steal only costs the victim a few pages. Shared mode serializes the caches
+** on one mutex; without it every cache is private to its connection and its
+** fetches take no lock, like pcache1. The mutex then only guards the list of
+** caches, and the statistics read from another thread may lag a little.
+**
+** With createFlag 1 nothing is allocated while sqlite3HeapNearlyFull() (the
+** soft heap limit is near), the pager spills or recycles instead.
+**
+** Each connection still keeps its own copy of a page: SQLite ties page
+** content to one pager, so only the memory budget can be shared.
+*/
+#define AWTK_PCACHE_MIN_CHUNK 4
+#define AWTK_PCACHE_MAX_CHUNK 64
+#define AWTK_PCACHE_MIN_HASH 64
+
+typedef struct _awtk_pcache_t awtk_pcache_t;
+typedef struct _awtk_pgchunk_t awtk_pgchunk_t;
+
+typedef struct _awtk_pgslot_t {
+  sqlite3_pcache_page page; /* pBuf and pExtra point into this slot */
+  struct _awtk_pgslot_t* next; /* Hash chain, or free list when unused */
+  awtk_pgchunk_t* chunk;
+  unsigned key;
+  u8 used;   /* Holds a page */
+  u8 pinned; /* Fetched and not yet unpinned */
+  u8 ref;    /* CLOCK reference bit */
+} awtk_pgslot_t;
+
+struct _awtk_pgchunk_t {
+  awtk_pgchunk_t* next;
+  int nSlot;
+  int nUsed;
+  char* slots; /* nSlot slots of awtk_pcache_t.szSlot bytes */
+};
+
+struct _awtk_pcache_t {
+  awtk_pcache_t* next; /* All caches, for stealing and statistics */
+  int szPage;
+  int szExtra;
+  int szSlot;
+  int bPurgeable;
+  int nMax; /* PRAGMA cache_size, in pages */
+  int nPage;
+  int nPinned;
+  int nSlot;         /* Slots in its chunks */
+  uint32_t last_use; /* Fetch tick of the last fetch, for stealing (shared mode) */
+  awtk_pgslot_t** apHash;
+  unsigned nHash;
+  awtk_pgslot_t* free_list;
+  awtk_pgchunk_t* chunks;
+  awtk_pgchunk_t* hand_chunk; /* CLOCK hand */
+  int hand_slot;
+  sqlite3_awtk_pcache_stats stats; /* Its own counters, nPage unused */
+};
+
+static struct {
+  int nSharedMax; /* 0 when every cache only obeys its own cache_size */
+  int nMinPerCache;
+  int nSlot; /* Slots of the purgeable caches, shared mode only */
+  uint32_t tick;
+  tk_mutex_t* mutex; /* The list of caches, and in shared mode the caches too */
+  awtk_pcache_t* caches;
+  sqlite3_awtk_pcache_stats stats; /* Counters of the destroyed caches */
+  sqlite3_awtk_pcache_stats base;  /* Counters at the last reset */
+} _awtk_pcache;
+
+/* cache operations: serialized in shared mode, private caches take no lock */
+#define _AWTK_PCACHE_LOCK() \
+  if (_awtk_pcache.nSharedMax > 0) tk_mutex_lock(_awtk_pcache.mutex)
+#define _AWTK_PCACHE_UNLOCK() \
+  if (_awtk_pcache.nSharedMax > 0) tk_mutex_unlock(_awtk_pcache.mutex)
+
+#define _AWTK_PGSLOT_AT(c, chunk, i) ((awtk_pgslot_t*)((chunk)->slots + (i) * (c)->szSlot))
+
+static int _awtk_pcache_init(void* NotUsed) {
+  memset(&_awtk_pcache.stats, 0, sizeof(_awtk_pcache.stats));
+  memset(&_awtk_pcache.base, 0, sizeof(_awtk_pcache.base));
+  _awtk_pcache.nSlot = 0;
+  _awtk_pcache.tick = 0;
+  _awtk_pcache.caches = NULL;
+
+  _awtk_pcache.mutex = tk_mutex_create();
+  if (_awtk_pcache.mutex == NULL) {
+    return SQLITE_NOMEM;
+  }
+
+  return SQLITE_OK;
+}
+
+static void _awtk_pcache_shutdown(void* NotUsed) {
+  if (_awtk_pcache.mutex != NULL) {
+    tk_mutex_destroy(_awtk_pcache.mutex);
+    _awtk_pcache.mutex = NULL;
+  }
+}
+
+static sqlite3_pcache* _awtk_pcache_create(int szPage, int szExtra, int bPurgeable) {
+  awtk_pcache_t* c = (awtk_pcache_t*)sqlite3_malloc(sizeof(awtk_pcache_t));
+
+  if (c == NULL) {
+    return NULL;
+  }
+
+  memset(c, 0, sizeof(*c));
+  c->szPage = szPage;
+  c->szExtra = szExtra;
+  c->szSlot = ROUND8(sizeof(awtk_pgslot_t)) + ROUND8(szPage) + ROUND8(szExtra);
+  c->bPurgeable = bPurgeable;
+  c->nMax = 100;
+
+  tk_mutex_lock(_awtk_pcache.mutex);
+  c->next = _awtk_pcache.caches;
+  _awtk_pcache.caches = c;
+  tk_mutex_unlock(_awtk_pcache.mutex);
+
+  return (sqlite3_pcache*)c;
+}
+
+static awtk_pgslot_t** _awtk_pcache_bucket(awtk_pcache_t* c, unsigned key) {
+  return &c->apHash[key & (c->nHash - 1)];
+}
+
+static void _awtk_pcache_hash_remove(awtk_pcache_t* c, awtk_pgslot_t* slot) {
+  awtk_pgslot_t** pp = _awtk_pcache_bucket(c, slot->key);
+
+  while (*pp != slot) {
+    pp = &(*pp)->next;
+  }
+  *pp = slot->next;
+}
+
+static int _awtk_pcache_hash_grow(awtk_pcache_t* c) {
+  unsigned i;
+  unsigned nHash = c->nHash ? c->nHash * 2 : AWTK_PCACHE_MIN_HASH;
+  awtk_pgslot_t** apOld = c->apHash;
+  unsigned nOld = c->nHash;
+  awtk_pgslot_t** apNew = (awtk_pgslot_t**)sqlite3_malloc64(sizeof(awtk_pgslot_t*) * nHash);
+
+  if (apNew == NULL) {
+    return c->nHash > 0 ? SQLITE_OK : SQLITE_NOMEM;
+  }
+
+  memset(apNew, 0, sizeof(awtk_pgslot_t*) * nHash);
+  c->apHash = apNew;
+  c->nHash = nHash;
+
+  for (i = 0; i < nOld; i++) {
+    awtk_pgslot_t* slot = apOld[i];
+
+    while (slot != NULL) {
+      awtk_pgslot_t* next = slot->next;
+      awtk_pgslot_t** bucket = _awtk_pcache_bucket(c, slot->key);
+
+      slot->next = *bucket;
+      *bucket = slot;
+      slot = next;
+    }
+  }
+  sqlite3_free(apOld);
+
+  return SQLITE_OK;
+}
+
+/* Drop the page held by slot and put the slot on the free list. */
+static void _awtk_pcache_release(awtk_pcache_t* c, awtk_pgslot_t* slot) {
+  _awtk_pcache_hash_remove(c, slot);
+
+  if (slot->pinned) {
+    slot->pinned = 0;
+    c->nPinned--;
+  }
+
+  slot->used = 0;
+  slot->ref = 0;
+  slot->chunk->nUsed--;
+  slot->next = c->free_list;
+  c->free_list = slot;
+
+  c->nPage--;
+}
+
+/*
+** Run the CLOCK hand until an unpinned page without reference bit is found.
+** Returns the slot it freed, or NULL.
+*/
+static awtk_pgslot_t* _awtk_pcache_evict(awtk_pcache_t* c) {
+  int steps = 0;
+  int max_steps = 0;
+  awtk_pgchunk_t* chunk = NULL;
+
+  for (chunk = c->chunks; chunk != NULL; chunk = chunk->next) {
+    max_steps += chunk->nSlot * 2;
+  }
+
+  if (c->nPage <= c->nPinned || c->chunks == NULL) {
+    return NULL;
+  }
+
+  for (steps = 0; steps < max_steps; steps++) {
+    awtk_pgslot_t* slot = NULL;
+
+    if (c->hand_chunk == NULL || c->hand_slot >= c->hand_chunk->nSlot) {
+      c->hand_chunk = (c->hand_chunk != NULL && c->hand_chunk->next != NULL)
+                          ? c->hand_chunk->next
+                          : c->chunks;
+      c->hand_slot = 0;
+    }
+
+    slot = _AWTK_PGSLOT_AT(c, c->hand_chunk, c->hand_slot);
+    c->hand_slot++;
+
+    if (!slot->used || slot->pinned) {
+      continue;
+    }
+
+    if (slot->ref) {
+      slot->ref = 0;
+      continue;
+    }
+
+    _awtk_pcache_release(c, slot);
+    return slot;
+  }
+
+  return NULL;
+}
+
+/*
+** The purgeable cache above its minimum that fetched least recently, which
+** may be self. Idle connections give up pages first, a busy one grows.
+*/
+static awtk_pcache_t* _awtk_pcache_idlest(void) {
+  awtk_pcache_t* c = NULL;
+  awtk_pcache_t* best = NULL;
+
+  for (c = _awtk_pcache.caches; c != NULL; c = c->next) {
+    if (c->bPurgeable && c->nPage > c->nPinned && c->nPage > _awtk_pcache.nMinPerCache &&
+        (best == NULL || c->last_use < best->last_use)) {
+      best = c;
+    }
+  }
+
+  return best;
+}
+
+static int _awtk_pcache_shared(awtk_pcache_t* c) {
+  return c->bPurgeable && _awtk_pcache.nSharedMax > 0;
+}
+
+/* A quarter of cache_size per chunk, the smallest chunks under the shared budget. */
+static int _awtk_pcache_chunk_slots(awtk_pcache_t* c) {
+  int nSlot = _awtk_pcache_shared(c) ? AWTK_PCACHE_MIN_CHUNK : c->nMax / 4;
+
+  nSlot = nSlot < AWTK_PCACHE_MIN_CHUNK ? AWTK_PCACHE_MIN_CHUNK : nSlot;
+  return nSlot > AWTK_PCACHE_MAX_CHUNK ? AWTK_PCACHE_MAX_CHUNK : nSlot;
+}
+
+static int _awtk_pcache_over_budget(awtk_pcache_t* c) {
+  return _awtk_pcache_shared(c) &&
+         _awtk_pcache.nSlot + _awtk_pcache_chunk_slots(c) > _awtk_pcache.nSharedMax;
+}
+
+static void _awtk_pcache_free_chunk(awtk_pcache_t* c, awtk_pgchunk_t* chunk) {
+  c->nSlot -= chunk->nSlot;
+  c->stats.nChunk--;
+  if (_awtk_pcache_shared(c)) {
+    _awtk_pcache.nSlot -= chunk->nSlot;
+  }
+  sqlite3_free(chunk);
+}
+
+static int _awtk_pcache_add_chunk(awtk_pcache_t* c) {
+  int i;
+  int nSlot = _awtk_pcache_chunk_slots(c);
+  awtk_pgchunk_t* chunk = NULL;
+
+  chunk = (awtk_pgchunk_t*)sqlite3_malloc64(ROUND8(sizeof(awtk_pgchunk_t)) +
+                                            (sqlite3_uint64)c->szSlot * nSlot);
+  if (chunk == NULL) {
+    return SQLITE_NOMEM;
+  }
+
+  chunk->nSlot = nSlot;
+  chunk->nUsed = 0;
+  chunk->slots = (char*)chunk + ROUND8(sizeof(awtk_pgchunk_t));
+
+  /* link in reverse so the free list hands out slots in address order */
+  for (i = nSlot - 1; i >= 0; i--) {
+    awtk_pgslot_t* slot = _AWTK_PGSLOT_AT(c, chunk, i);
+
+    memset(slot, 0, sizeof(*slot));
+    slot->chunk = chunk;
+    slot->page.pBuf = (char*)slot + ROUND8(sizeof(awtk_pgslot_t));
+    slot->page.pExtra = (char*)slot->page.pBuf + ROUND8(c->szPage);
+    slot->next = c->free_list;
+    c->free_list = slot;
+  }
+
+  chunk->next = c->chunks;
+  c->chunks = chunk;
+  c->nSlot += nSlot;
+  c->stats.nChunk++;
+  if (_awtk_pcache_shared(c)) {
+    _awtk_pcache.nSlot += nSlot;
+  }
+
+  return SQLITE_OK;
+}
+
+/* Free the chunks without pages and rebuild the free list from the rest. */
+static void _awtk_pcache_free_empty_chunks(awtk_pcache_t* c) {
+  int i;
+  awtk_pgchunk_t** pp = &c->chunks;
+
+  c->free_list = NULL;
+  c->hand_chunk = NULL;
+  c->hand_slot = 0;
+
+  while (*pp != NULL) {
+    awtk_pgchunk_t* chunk = *pp;
+
+    if (chunk->nUsed == 0) {
+      *pp = chunk->next;
+      _awtk_pcache_free_chunk(c, chunk);
+      continue;
+    }
+
+    for (i = chunk->nSlot - 1; i >= 0; i--) {
+      awtk_pgslot_t* slot = _AWTK_PGSLOT_AT(c, chunk, i);
+
+      if (!slot->used) {
+        slot->next = c->free_list;
+        c->free_list = slot;
+      }
+    }
+    pp = &chunk->next;
+  }
+}
+
+/*
+** Make room under the shared budget for a chunk of c: take pages from the
+** idlest cache and free its chunks as they empty, or recycle a page of c.
+** Returns 0 when nothing could be taken.
+*/
+static int _awtk_pcache_steal(awtk_pcache_t* c) {
+  while (c->free_list == NULL && _awtk_pcache_over_budget(c)) {
+    awtk_pcache_t* victim = _awtk_pcache_idlest();
+    awtk_pgslot_t* slot = victim != NULL ? _awtk_pcache_evict(victim) : NULL;
+
+    if (slot == NULL || victim == c) {
+      if (slot == NULL) {
+        slot = _awtk_pcache_evict(c);
+      }
+      c->stats.nEvict += slot != NULL;
+      return slot != NULL;
+    }
+
+    c->stats.nSteal++;
+    if (slot->chunk->nUsed == 0) {
+      _awtk_pcache_free_empty_chunks(victim);
+    }
+  }
+
+  return 1;
+}
+
+static awtk_pgslot_t* _awtk_pcache_get_slot(awtk_pcache_t* c, int createFlag) {
+  awtk_pgslot_t* slot = NULL;
+
+  /* createFlag 1 means "only if cheap": let the pager spill instead */
+  if (c->bPurgeable && c->nPage >= c->nMax) {
+    if (_awtk_pcache_evict(c) != NULL) {
+      c->stats.nEvict++;
+    } else if (createFlag == 1) {
+      return NULL;
+    }
+  }
+
+  if (c->free_list == NULL && _awtk_pcache_over_budget(c)) {
+    if (!_awtk_pcache_steal(c) && createFlag == 1) {
+      return NULL;
+    }
+  }
+
+  /* near the soft heap limit, like pcache1 */
+  if (c->free_list == NULL && createFlag == 1 && sqlite3HeapNearlyFull()) {
+    if (!c->bPurgeable || _awtk_pcache_evict(c) == NULL) {
+      return NULL;
+    }
+    c->stats.nEvict++;
+  }
+
+  if (c->free_list == NULL && _awtk_pcache_add_chunk(c) != SQLITE_OK) {
+    return NULL;
+  }
+
+  slot = c->free_list;
+  c->free_list = slot->next;
+
+  return slot;
+}
+
+static void _awtk_pcache_cachesize(sqlite3_pcache* p, int nCachesize) {
+  awtk_pcache_t* c = (awtk_pcache_t*)p;
+
+  _AWTK_PCACHE_LOCK();
+  c->nMax = nCachesize;
+  while (c->bPurgeable && c->nPage > c->nMax && _awtk_pcache_evict(c) != NULL) {
+    c->stats.nEvict++;
+  }
+  _AWTK_PCACHE_UNLOCK();
+}
+
+static int _awtk_pcache_pagecount(sqlite3_pcache* p) {
+  int n = 0;
+
+  _AWTK_PCACHE_LOCK();
+  n = ((awtk_pcache_t*)p)->nPage;
+  _AWTK_PCACHE_UNLOCK();
+
+  return n;
+}
+
+static sqlite3_pcache_page* _awtk_pcache_fetch(sqlite3_pcache* p, unsigned key, int createFlag) {
+  awtk_pgslot_t* slot = NULL;
+  awtk_pcache_t* c = (awtk_pcache_t*)p;
+
+  _AWTK_PCACHE_LOCK();
+  if (_awtk_pcache.nSharedMax > 0) {
+    c->last_use = ++_awtk_pcache.tick;
+  }
+  if (c->nHash > 0) {
+    for (slot = *_awtk_pcache_bucket(c, key); slot != NULL; slot = slot->next) {
+      if (slot->key == key) {
+        break;
+      }
+    }
+  }
+
+  if (slot != NULL) {
+    c->stats.nHit++;
+  } else if (createFlag != 0) {
+    c->stats.nMiss++;
+
+    if (c->nPage >= (int)c->nHash && _awtk_pcache_hash_grow(c) != SQLITE_OK) {
+      _AWTK_PCACHE_UNLOCK();
+      return NULL;
+    }
+
+    slot = _awtk_pcache_get_slot(c, createFlag);
+    if (slot != NULL) {
+      awtk_pgslot_t** bucket = _awtk_pcache_bucket(c, key);
+
+      slot->key = key;
+      slot->used = 1;
+      slot->next = *bucket;
+      *bucket = slot;
+      slot->chunk->nUsed++;
+      /* the pager checks the first pointer of pExtra to detect new pages */
+      *(void**)slot->page.pExtra = NULL;
+
+      c->nPage++;
+    }
+  } else {
+    c->stats.nMiss++;
+  }
+
+  if (slot != NULL) {
+    slot->ref = 1;
+    if (!slot->pinned) {
+      slot->pinned = 1;
+      c->nPinned++;
+    }
+  }
+  _AWTK_PCACHE_UNLOCK();
+
+  return slot != NULL ? &slot->page : NULL;
+}
+
+static void _awtk_pcache_unpin(sqlite3_pcache* p, sqlite3_pcache_page* pg, int reuseUnlikely) {
+  awtk_pcache_t* c = (awtk_pcache_t*)p;
+  awtk_pgslot_t* slot = (awtk_pgslot_t*)pg;
+
+  _AWTK_PCACHE_LOCK();
+  if (reuseUnlikely || (c->bPurgeable && c->nPage > c->nMax)) {
+    _awtk_pcache_release(c, slot);
+  } else if (slot->pinned) {
+    slot->pinned = 0;
+    c->nPinned--;
+  }
+  _AWTK_PCACHE_UNLOCK();
+}
+
+static void _awtk_pcache_rekey(sqlite3_pcache* p, sqlite3_pcache_page* pg, unsigned oldKey,
+                               unsigned newKey) {
+  awtk_pcache_t* c = (awtk_pcache_t*)p;
+  awtk_pgslot_t* slot = (awtk_pgslot_t*)pg;
+  awtk_pgslot_t** bucket = NULL;
+
+  _AWTK_PCACHE_LOCK();
+  assert(slot->key == oldKey);
+  _awtk_pcache_hash_remove(c, slot);
+  slot->key = newKey;
+  bucket = _awtk_pcache_bucket(c, newKey);
+  slot->next = *bucket;
+  *bucket = slot;
+  _AWTK_PCACHE_UNLOCK();
+}
+
+static void _awtk_pcache_truncate(sqlite3_pcache* p, unsigned iLimit) {
+  unsigned i;
+  awtk_pcache_t* c = (awtk_pcache_t*)p;
+
+  _AWTK_PCACHE_LOCK();
+  for (i = 0; i < c->nHash; i++) {
+    awtk_pgslot_t* slot = c->apHash[i];
+
+    while (slot != NULL) {
+      awtk_pgslot_t* next = slot->next;
+
+      if (slot->key >= iLimit) {
+        _awtk_pcache_release(c, slot);
+      }
+      slot = next;
+    }
+  }
+  _AWTK_PCACHE_UNLOCK();
+}
+
+static void _awtk_pcache_shrink(sqlite3_pcache* p) {
+  awtk_pcache_t* c = (awtk_pcache_t*)p;
+
+  _AWTK_PCACHE_LOCK();
+  if (c->bPurgeable) {
+    awtk_pgchunk_t* chunk = NULL;
+
+    for (chunk = c->chunks; chunk != NULL; chunk = chunk->next) {
+      int i;
+
+      for (i = 0; i < chunk->nSlot; i++) {
+        awtk_pgslot_t* slot = _AWTK_PGSLOT_AT(c, chunk, i);
+
+        if (slot->used && !slot->pinned) {
+          _awtk_pcache_release(c, slot);
+        }
+      }
+    }
+  }
+  _awtk_pcache_free_empty_chunks(c);
+  _AWTK_PCACHE_UNLOCK();
+}
+
+static void _awtk_pcache_stats_add(sqlite3_awtk_pcache_stats* to,
+                                   const sqlite3_awtk_pcache_stats* from) {
+  to->nHit += from->nHit;
+  to->nMiss += from->nMiss;
+  to->nEvict += from->nEvict;
+  to->nSteal += from->nSteal;
+}
+
+static void _awtk_pcache_destroy(sqlite3_pcache* p) {
+  awtk_pcache_t* c = (awtk_pcache_t*)p;
+  awtk_pcache_t** pp = &_awtk_pcache.caches;
+
+  tk_mutex_lock(_awtk_pcache.mutex);
+  while (*pp != NULL && *pp != c) {
+    pp = &(*pp)->next;
+  }
+  if (*pp != NULL) {
+    *pp = c->next;
+  }
+  _awtk_pcache_stats_add(&_awtk_pcache.stats, &c->stats);
+
+  while (c->chunks != NULL) {
+    awtk_pgchunk_t* chunk = c->chunks;
+
+    c->chunks = chunk->next;
+    _awtk_pcache_free_chunk(c, chunk);
+  }
+  tk_mutex_unlock(_awtk_pcache.mutex);
+
+  sqlite3_free(c->apHash);
+  sqlite3_free(c);
+}
+
+SQLITE_API int sqlite3_awtk_pcache_install(int nSharedMax, int nMinPerCache) {
+  static const sqlite3_pcache_methods2 methods = {
+      1,
+      0,
+      _awtk_pcache_init,
+      _awtk_pcache_shutdown,
+      _awtk_pcache_create,
+      _awtk_pcache_cachesize,
+      _awtk_pcache_pagecount,
+      _awtk_pcache_fetch,
+      _awtk_pcache_unpin,
+      _awtk_pcache_rekey,
+      _awtk_pcache_truncate,
+      _awtk_pcache_destroy,
+      _awtk_pcache_shrink,
+  };
+
+  if (nSharedMax < 0 || nMinPerCache < 0) {
+    return SQLITE_MISUSE;
+  }
+
+  _awtk_pcache.nSharedMax = nSharedMax;
+  _awtk_pcache.nMinPerCache = nMinPerCache;
+
+  return sqlite3_config(SQLITE_CONFIG_PCACHE2, &methods);
+}
+
+SQLITE_API void sqlite3_awtk_pcache_stats_get(sqlite3_awtk_pcache_stats* pStats, int resetFlag) {
+  awtk_pcache_t* c = NULL;
+  sqlite3_awtk_pcache_stats total;
+
+  memset(pStats, 0, sizeof(*pStats));
+  if (_awtk_pcache.mutex == NULL) {
+    return;
+  }
+
+  tk_mutex_lock(_awtk_pcache.mutex);
+  total = _awtk_pcache.stats;
+  for (c = _awtk_pcache.caches; c != NULL; c = c->next) {
+    _awtk_pcache_stats_add(&total, &c->stats);
+    total.nChunk += c->stats.nChunk;
+    if (c->bPurgeable) {
+      total.nPage += c->nPage;
+    }
+  }
+
+  *pStats = total;
+  pStats->nHit -= _awtk_pcache.base.nHit;
+  pStats->nMiss -= _awtk_pcache.base.nMiss;
+  pStats->nEvict -= _awtk_pcache.base.nEvict;
+  pStats->nSteal -= _awtk_pcache.base.nSteal;
+  if (resetFlag) {
+    _awtk_pcache.base = total;
+  }
+  tk_mutex_unlock(_awtk_pcache.mutex);
+}
+
+SQLITE_API void sqlite3_awtk_pcache_dump(void) {
+  sqlite3_awtk_pcache_stats s;
+  sqlite3_int64 nLookup = 0;
+
+  sqlite3_awtk_pcache_stats_get(&s, 0);
+  nLookup = s.nHit + s.nMiss;
+
+  log_info("pcache: hit=%lld miss=%lld (%.1f%% hit) evict=%lld steal=%lld pages=%lld chunks=%lld\n",
+           (long long)s.nHit, (long long)s.nMiss, nLookup ? 100.0 * s.nHit / nLookup : 0.0,
+           (long long)s.nEvict, (long long)s.nSteal, (long long)s.nPage, (long long)s.nChunk);
+}
+
+#endif /* SQLITE_AWTK_ENABLE_PCACHE */
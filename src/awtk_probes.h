@@ -0,0 +1,138 @@
+#ifndef AWTK_PROBES_H
+#define AWTK_PROBES_H
+
+/*
+** Static tracepoints (USDT) of the port, provider "sqlite_awtk".
+**
+** With SQLITE_AWTK_ENABLE_PROBES on Linux every probe is a nop instruction
+** plus a note in the ELF file (<sys/sdt.h>, package systemtap-sdt-dev), so
+** perf, bpftrace or SystemTap can attach to a running process. Otherwise
+** the macros compile to nothing. The probes that report a latency read the
+** clock around the call whether a tracer is attached or not.
+**
+**   read(file, offset, size, latency_us, rc)
+**   write(file, offset, size, latency_us, rc)
+**   sync(file, flags, latency_us, rc)
+**   lock(file, from, to, latency_us, rc)  lock level transition, xLock
+**   unlock(file, from, to, latency_us)    xUnlock
+**   file_sem(file, to, latency_us, rc)    xLock trying the file's semaphore,
+**                                         SQLITE_BUSY: another connection has it
+**   busy_sleep(requested_us, sleep_us)    busy handler sleeping in xSleep
+**   temp_create(path, flags)              temporary file opened
+**   mutex_contended(mutex, id, wait_us)
+**   sem_wait(mutex, id, wait_us)          adaptive mutex parked on its semaphore
+**
+** e.g. bpftrace -e 'usdt:./app:sqlite_awtk:sync { @us = hist(arg2); }'
+**
+** Included by both awtk_mutex.h and awtk_vfs.h. The macros are defined on
+** the first inclusion, the VFS probes at the end of this file with
+** awtk_vfs.h.
+*/
+#if defined(SQLITE_AWTK_ENABLE_PROBES) && defined(__linux__)
+#include <sys/sdt.h>
+
+#define AWTK_PROBES_ON 1
+#define AWTK_PROBE_CLOCK(start) sqlite3_uint64 start = time_now_us()
+#define AWTK_PROBE1(name, a) DTRACE_PROBE1(sqlite_awtk, name, a)
+#define AWTK_PROBE2(name, a, b) DTRACE_PROBE2(sqlite_awtk, name, a, b)
+#define AWTK_PROBE3(name, a, b, c) DTRACE_PROBE3(sqlite_awtk, name, a, b, c)
+#define AWTK_PROBE4(name, a, b, c, d) DTRACE_PROBE4(sqlite_awtk, name, a, b, c, d)
+#define AWTK_PROBE5(name, a, b, c, d, e) DTRACE_PROBE5(sqlite_awtk, name, a, b, c, d, e)
+#else
+#define AWTK_PROBE_CLOCK(start)
+#define AWTK_PROBE1(name, a)
+#define AWTK_PROBE2(name, a, b)
+#define AWTK_PROBE3(name, a, b, c)
+#define AWTK_PROBE4(name, a, b, c, d)
+#define AWTK_PROBE5(name, a, b, c, d, e)
+#endif /* SQLITE_AWTK_ENABLE_PROBES */
+
+#endif /*AWTK_PROBES_H*/
+
+/*
+** VFS probes: io methods around the methods selected so far
+** (AWTK_IO_METHOD, see awtk_commit_timing.h).
+*/
+#if defined(AWTK_PROBES_ON) && defined(AWTK_IO_METHOD) && !defined(AWTK_PROBES_IO)
+#define AWTK_PROBES_IO 1
+
+static int _awtk_probe_io_close(sqlite3_file* file_id) {
+  return AWTK_IO_METHOD.xClose(file_id);
+}
+
+static int _awtk_probe_io_read(sqlite3_file* file_id, void* pbuf, int cnt, sqlite3_int64 offset) {
+  AWTK_PROBE_CLOCK(start);
+  int rc = AWTK_IO_METHOD.xRead(file_id, pbuf, cnt, offset);
+
+  AWTK_PROBE5(read, file_id, offset, cnt, time_now_us() - start, rc);
+
+  return rc;
+}
+
+static int _awtk_probe_io_write(sqlite3_file* file_id, const void* pbuf, int cnt,
+                                sqlite3_int64 offset) {
+  AWTK_PROBE_CLOCK(start);
+  int rc = AWTK_IO_METHOD.xWrite(file_id, pbuf, cnt, offset);
+
+  AWTK_PROBE5(write, file_id, offset, cnt, time_now_us() - start, rc);
+
+  return rc;
+}
+
+static int _awtk_probe_io_truncate(sqlite3_file* file_id, sqlite3_int64 size) {
+  return AWTK_IO_METHOD.xTruncate(file_id, size);
+}
+
+static int _awtk_probe_io_sync(sqlite3_file* file_id, int flags) {
+  AWTK_PROBE_CLOCK(start);
+  int rc = AWTK_IO_METHOD.xSync(file_id, flags);
+
+  AWTK_PROBE4(sync, file_id, flags, time_now_us() - start, rc);
+
+  return rc;
+}
+
+static int _awtk_probe_io_lock(sqlite3_file* file_id, int eFileLock) {
+  int from = ((AWTK_SQLITE_FILE_T*)file_id)->eFileLock;
+  AWTK_PROBE_CLOCK(start);
+  int rc = AWTK_IO_METHOD.xLock(file_id, eFileLock);
+
+  AWTK_PROBE5(lock, file_id, from, eFileLock, time_now_us() - start, rc);
+
+  return rc;
+}
+
+static int _awtk_probe_io_unlock(sqlite3_file* file_id, int eFileLock) {
+  int from = ((AWTK_SQLITE_FILE_T*)file_id)->eFileLock;
+  AWTK_PROBE_CLOCK(start);
+  int rc = AWTK_IO_METHOD.xUnlock(file_id, eFileLock);
+
+  AWTK_PROBE4(unlock, file_id, from, eFileLock, time_now_us() - start);
+
+  return rc;
+}
+
+/* methods no layer wraps are the plain ones */
+static const sqlite3_io_methods _awtk_probe_io_method = {3,
+                                                         _awtk_probe_io_close,
+                                                         _awtk_probe_io_read,
+                                                         _awtk_probe_io_write,
+                                                         _awtk_probe_io_truncate,
+                                                         _awtk_probe_io_sync,
+                                                         _awtk_io_file_size,
+                                                         _awtk_probe_io_lock,
+                                                         _awtk_probe_io_unlock,
+                                                         _awtk_io_check_reserved_lock,
+                                                         _awtk_io_file_ctrl,
+                                                         _awtk_io_sector_size,
+                                                         _awtk_io_device_characteristics,
+                                                         0,
+                                                         0,
+                                                         0,
+                                                         0,
+                                                         _awtk_io_fetch,
+                                                         _awtk_io_unfetch};
+
+#undef AWTK_IO_METHOD
+#define AWTK_IO_METHOD _awtk_probe_io_method
+#endif /* AWTK_PROBES_IO */
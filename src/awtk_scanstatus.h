@@ -0,0 +1,81 @@
+#ifdef SQLITE_ENABLE_STMT_SCANSTATUS
+/*
+** EXPLAIN ANALYZE for the AWTK port: after a statement has run, log every
+** loop of its plan with the rows the planner expected, the rows actually
+** visited and how many times the loop was started, from
+** sqlite3_stmt_scanstatus(). A loop whose rows are far above its estimate,
+** or that is started once per row of an outer loop, is the one to fix.
+**
+** Only built with SQLITE_ENABLE_STMT_SCANSTATUS (the profiling profile),
+** which adds a counter update to every loop of every statement.
+*/
+
+SQLITE_API void sqlite3_awtk_scanstatus_dump(sqlite3_stmt* pStmt) {
+  int i;
+
+  log_info("%4s %10s %10s %12s  %s\n", "sel", "loops", "rows", "est_rows", "plan");
+  for (i = 0;; i++) {
+    int selectid = 0;
+    double est = 0;
+    sqlite3_int64 nloop = 0;
+    sqlite3_int64 nvisit = 0;
+    const char* name = NULL;
+    const char* explain = NULL;
+
+    if (sqlite3_stmt_scanstatus(pStmt, i, SQLITE_SCANSTAT_NLOOP, &nloop) != 0) {
+      break;
+    }
+    sqlite3_stmt_scanstatus(pStmt, i, SQLITE_SCANSTAT_NVISIT, &nvisit);
+    sqlite3_stmt_scanstatus(pStmt, i, SQLITE_SCANSTAT_EST, &est);
+    sqlite3_stmt_scanstatus(pStmt, i, SQLITE_SCANSTAT_NAME, &name);
+    sqlite3_stmt_scanstatus(pStmt, i, SQLITE_SCANSTAT_EXPLAIN, &explain);
+    sqlite3_stmt_scanstatus(pStmt, i, SQLITE_SCANSTAT_SELECTID, &selectid);
+
+    /* EST is per start of the loop, the other counters are totals */
+    log_info("%4d %10lld %10lld %12.0f  %s (%s)\n", selectid, (long long)nloop, (long long)nvisit,
+             est * (nloop > 0 ? nloop : 1), explain ? explain : "?", name ? name : "?");
+  }
+}
+
+/*
+** Run every statement of zSql to completion on db, discarding its rows, and
+** log the run time, the rows returned and the loops of each statement.
+*/
+SQLITE_API int sqlite3_awtk_explain_analyze(sqlite3* db, const char* zSql) {
+  int rc = SQLITE_OK;
+  const char* tail = zSql;
+
+  while (rc == SQLITE_OK && tail != NULL && tail[0] != '\0') {
+    uint64_t start = 0;
+    sqlite3_int64 rows = 0;
+    sqlite3_stmt* stmt = NULL;
+
+    rc = sqlite3_prepare_v2(db, tail, -1, &stmt, &tail);
+    if (rc != SQLITE_OK) {
+      log_info("explain analyze: %s\n", sqlite3_errmsg(db));
+      break;
+    } else if (stmt == NULL) {
+      /* comment or white space */
+      continue;
+    }
+
+    start = time_now_us();
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+      rows++;
+    }
+    start = time_now_us() - start;
+
+    log_info("%s\n-- %lld rows in %llu us, %d vm steps\n", sqlite3_sql(stmt), (long long)rows,
+             (unsigned long long)start, sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_VM_STEP, 0));
+    sqlite3_awtk_scanstatus_dump(stmt);
+
+    if (rc != SQLITE_DONE) {
+      log_info("explain analyze: %s\n", sqlite3_errmsg(db));
+    }
+    rc = sqlite3_finalize(stmt);
+  }
+
+  return rc;
+}
+
+#endif /* SQLITE_ENABLE_STMT_SCANSTATUS */
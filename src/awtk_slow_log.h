@@ -0,0 +1,206 @@
+#ifdef SQLITE_AWTK_ENABLE_SLOW_LOG
+/*
+** Slow-query log: a statement of an attached connection that runs longer
+** than the threshold is written out with its expanded SQL, its run time,
+** the sqlite3_stmt_status() counters of that run and its query plan.
+**
+** The plan comes from EXPLAIN QUERY PLAN on a short-lived read-only
+** connection to the same file: running a statement on the traced connection
+** from inside its trace callback is not safe. In-memory databases and
+** statements on temp tables are logged without a plan.
+**
+** Records go to a log file that is rotated to "<file>.1" when it grows past
+** its size limit (awtk_log_file.h), or to log_info() without a file. Records over the rate
+** limit are counted and dropped, so a burst of slow statements costs no
+** more than a few plans and writes per minute.
+*/
+#ifndef SQLITE_AWTK_SLOW_LOG_MAX_BYTES
+#define SQLITE_AWTK_SLOW_LOG_MAX_BYTES (64 * 1024)
+#endif /*SQLITE_AWTK_SLOW_LOG_MAX_BYTES*/
+
+#ifndef SQLITE_AWTK_SLOW_LOG_SQL_LEN
+#define SQLITE_AWTK_SLOW_LOG_SQL_LEN 2048
+#endif /*SQLITE_AWTK_SLOW_LOG_SQL_LEN*/
+
+#ifndef SQLITE_AWTK_SLOW_LOG_PLAN_LEN
+#define SQLITE_AWTK_SLOW_LOG_PLAN_LEN 1024
+#endif /*SQLITE_AWTK_SLOW_LOG_PLAN_LEN*/
+
+static struct {
+  tk_mutex_t* mutex;
+  awtk_log_file_t out;
+  sqlite3_int64 nThresholdUs;
+  int nPerMinute;
+  int nToken;
+  uint64_t refill_us;
+  sqlite3_awtk_slow_log_stats stats;
+} _awtk_slow_log;
+
+/* EXPLAIN QUERY PLAN of stmt on its own connection, one line per row. */
+static void _awtk_slow_log_plan(sqlite3_stmt* stmt, char* out, int size) {
+  int n = 0;
+  char* sql = NULL;
+  sqlite3* db = NULL;
+  sqlite3_stmt* eqp = NULL;
+  const char* filename = sqlite3_db_filename(sqlite3_db_handle(stmt), "main");
+
+  tk_snprintf(out, size, "  (no plan)\n");
+  if (filename == NULL || filename[0] == '\0' || sqlite3_sql(stmt) == NULL) {
+    return;
+  }
+
+  if (sqlite3_open_v2(filename, &db, SQLITE_OPEN_READONLY, NULL) == SQLITE_OK) {
+    sql = sqlite3_mprintf("EXPLAIN QUERY PLAN %s", sqlite3_sql(stmt));
+    if (sql != NULL && sqlite3_prepare_v2(db, sql, -1, &eqp, NULL) == SQLITE_OK) {
+      while (n < size - 1 && sqlite3_step(eqp) == SQLITE_ROW) {
+        n += tk_snprintf(out + n, size - n, "  %d|%d|%d| %s\n", sqlite3_column_int(eqp, 0),
+                         sqlite3_column_int(eqp, 1), sqlite3_column_int(eqp, 2),
+                         (const char*)sqlite3_column_text(eqp, 3));
+      }
+    }
+    sqlite3_finalize(eqp);
+    sqlite3_free(sql);
+  }
+  sqlite3_close(db);
+}
+
+/* Called with the log mutex held. */
+static bool_t _awtk_slow_log_take_token(void) {
+  uint64_t now = time_now_us();
+
+  if (_awtk_slow_log.nPerMinute <= 0) {
+    return TRUE;
+  }
+
+  if (now - _awtk_slow_log.refill_us >= 60 * 1000 * 1000) {
+    _awtk_slow_log.refill_us = now;
+    _awtk_slow_log.nToken = _awtk_slow_log.nPerMinute;
+  }
+
+  if (_awtk_slow_log.nToken <= 0) {
+    return FALSE;
+  }
+  _awtk_slow_log.nToken--;
+
+  return TRUE;
+}
+
+static int _awtk_slow_log_on_trace(unsigned mask, void* ctx, void* p, void* x) {
+  int fullscan, sorts, autoindex, steps;
+  bool_t log = FALSE;
+  char* sql = NULL;
+  char* record = NULL;
+  char plan[SQLITE_AWTK_SLOW_LOG_PLAN_LEN];
+  sqlite3_stmt* stmt = (sqlite3_stmt*)p;
+  sqlite3_int64 us = _awtk_trace_run_us(stmt, x);
+
+  if (_awtk_slow_log.mutex == NULL || us < _awtk_slow_log.nThresholdUs) {
+    return 0;
+  }
+
+  tk_mutex_lock(_awtk_slow_log.mutex);
+  _awtk_slow_log.stats.nSlow++;
+  log = _awtk_slow_log_take_token();
+  if (!log) {
+    _awtk_slow_log.stats.nDropped++;
+  }
+  tk_mutex_unlock(_awtk_slow_log.mutex);
+
+  if (!log) {
+    return 0;
+  }
+
+  fullscan = _awtk_trace_run_status(stmt, SQLITE_STMTSTATUS_FULLSCAN_STEP);
+  sorts = _awtk_trace_run_status(stmt, SQLITE_STMTSTATUS_SORT);
+  autoindex = _awtk_trace_run_status(stmt, SQLITE_STMTSTATUS_AUTOINDEX);
+  steps = _awtk_trace_run_status(stmt, SQLITE_STMTSTATUS_VM_STEP);
+  _awtk_slow_log_plan(stmt, plan, sizeof(plan));
+
+  sql = sqlite3_expanded_sql(stmt);
+  record = sqlite3_mprintf(
+      "--- slow query at %llu ms: %lld us\n"
+      "sql: %.*s\n"
+      "fullscan_steps=%d sorts=%d autoindex=%d vm_steps=%d\n"
+      "plan:\n%s",
+      (unsigned long long)time_now_ms(), (long long)us, SQLITE_AWTK_SLOW_LOG_SQL_LEN,
+      sql != NULL ? sql : sqlite3_sql(stmt), fullscan, sorts, autoindex, steps, plan);
+
+  if (record != NULL) {
+    tk_mutex_lock(_awtk_slow_log.mutex);
+    _awtk_log_file_write(&_awtk_slow_log.out, record);
+    _awtk_slow_log.stats.nLogged++;
+    tk_mutex_unlock(_awtk_slow_log.mutex);
+  }
+
+  sqlite3_free(record);
+  sqlite3_free(sql);
+
+  return 0;
+}
+
+/*
+** Start logging statements that run nThresholdMs or longer to zPath (NULL:
+** log_info()), at most nPerMinute records a minute (0: no limit). The file
+** is rotated past nMaxBytes (0: SQLITE_AWTK_SLOW_LOG_MAX_BYTES).
+*/
+SQLITE_API int sqlite3_awtk_slow_log_init(const char* zPath, int nThresholdMs, int nMaxBytes,
+                                          int nPerMinute) {
+  if (_awtk_slow_log.mutex != NULL) {
+    return SQLITE_MISUSE;
+  }
+
+  if (zPath != NULL && strlen(zPath) > AWTK_MAX_PATHNAME) {
+    return SQLITE_MISUSE;
+  }
+
+  memset(&_awtk_slow_log, 0x00, sizeof(_awtk_slow_log));
+  _awtk_slow_log.mutex = tk_mutex_create();
+  if (_awtk_slow_log.mutex == NULL) {
+    return SQLITE_NOMEM;
+  }
+
+  _awtk_slow_log.nThresholdUs = (sqlite3_int64)nThresholdMs * 1000;
+  _awtk_log_file_init(&_awtk_slow_log.out, zPath,
+                      nMaxBytes > 0 ? nMaxBytes : SQLITE_AWTK_SLOW_LOG_MAX_BYTES, NULL);
+  _awtk_slow_log.nPerMinute = nPerMinute;
+  _awtk_slow_log.nToken = nPerMinute;
+  _awtk_slow_log.refill_us = time_now_us();
+
+  return SQLITE_OK;
+}
+
+/* Detach every connection before calling it. */
+SQLITE_API void sqlite3_awtk_slow_log_deinit(void) {
+  tk_mutex_t* mutex = _awtk_slow_log.mutex;
+
+  if (mutex == NULL) {
+    return;
+  }
+
+  tk_mutex_lock(mutex);
+  _awtk_log_file_close(&_awtk_slow_log.out);
+  memset(&_awtk_slow_log, 0x00, sizeof(_awtk_slow_log));
+  tk_mutex_unlock(mutex);
+  tk_mutex_destroy(mutex);
+}
+
+SQLITE_API int sqlite3_awtk_slow_log_attach(sqlite3* db) {
+  return sqlite3_awtk_trace_add(db, SQLITE_TRACE_PROFILE, _awtk_slow_log_on_trace, NULL);
+}
+
+SQLITE_API int sqlite3_awtk_slow_log_detach(sqlite3* db) {
+  return sqlite3_awtk_trace_remove(db, _awtk_slow_log_on_trace, NULL);
+}
+
+SQLITE_API void sqlite3_awtk_slow_log_stats_get(sqlite3_awtk_slow_log_stats* pStats) {
+  memset(pStats, 0x00, sizeof(*pStats));
+  if (_awtk_slow_log.mutex == NULL) {
+    return;
+  }
+
+  tk_mutex_lock(_awtk_slow_log.mutex);
+  *pStats = _awtk_slow_log.stats;
+  tk_mutex_unlock(_awtk_slow_log.mutex);
+}
+
+#endif /* SQLITE_AWTK_ENABLE_SLOW_LOG */
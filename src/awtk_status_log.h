@@ -0,0 +1,305 @@
+#ifdef SQLITE_AWTK_ENABLE_STATUS_LOG
+/*
+** Status log: samples sqlite3_status64() and sqlite3_db_status() of the
+** attached connections at a fixed interval and appends one CSV line per
+** connection, so a slow period on a device can be matched with the memory
+** and page cache behaviour of the same minutes afterwards.
+**
+** Cumulative counters (cache hits, misses, writes, lookaside) are read
+** without resetting them and logged as rates over the interval, so other
+** readers of the same counters are not disturbed. The file is rotated to
+** "<file>.1" when it grows past its size limit (awtk_log_file.h), which keeps
+** the last two files' worth of history.
+**
+** Samples are taken from an AWTK timer on the GUI thread. sqlite3_db_status()
+** takes the connection's mutex, which the multi-thread profile
+** (SQLITE_THREADSAFE=2) does not have: there call
+** sqlite3_awtk_status_log_sample() from the thread that owns the
+** connections instead of using the timer. The global counters need
+** SQLITE_DEFAULT_MEMSTATUS, they stay 0 in the mcu-small profile.
+*/
+#ifndef SQLITE_AWTK_STATUS_LOG_MAX_DB
+#define SQLITE_AWTK_STATUS_LOG_MAX_DB 8
+#endif /*SQLITE_AWTK_STATUS_LOG_MAX_DB*/
+
+#ifndef SQLITE_AWTK_STATUS_LOG_MAX_BYTES
+#define SQLITE_AWTK_STATUS_LOG_MAX_BYTES (256 * 1024)
+#endif /*SQLITE_AWTK_STATUS_LOG_MAX_BYTES*/
+
+#define AWTK_STATUS_LOG_HEADER                                                             \
+  "time_ms,interval_ms,mem_used,mem_hw,pcache_used,pcache_overflow,malloc_count,"          \
+  "cache_used,cache_hit_s,cache_miss_s,cache_write_s,cache_spill_s,cache_hit_pct,"         \
+  "lookaside_used,lookaside_hit_s,lookaside_miss_s,schema_used,stmt_used,db\n"
+
+typedef struct _awtk_status_log_db_t {
+  sqlite3* db;
+  sqlite3_awtk_status_sample last;
+  /* time and cumulative counters at the last sample */
+  uint64_t last_ms;
+  int nCacheHit;
+  int nCacheMiss;
+  int nCacheWrite;
+  int nCacheSpill;
+  int nLookasideHit;
+  int nLookasideMiss;
+} awtk_status_log_db_t;
+
+static struct {
+  tk_mutex_t* mutex;
+  uint32_t timer_id;
+  awtk_log_file_t out;
+  awtk_status_log_db_t dbs[SQLITE_AWTK_STATUS_LOG_MAX_DB];
+} _awtk_status_log;
+
+static int _awtk_status_log_db_get(sqlite3* db, int op, int* hw) {
+  int cur = 0;
+  int hiwtr = 0;
+
+  sqlite3_db_status(db, op, &cur, &hiwtr, 0);
+  if (hw != NULL) {
+    *hw = hiwtr;
+  }
+
+  return cur;
+}
+
+/* Per second over interval_ms, rounded down. */
+static sqlite3_int64 _awtk_status_log_rate(int delta, sqlite3_int64 interval_ms) {
+  return interval_ms > 0 ? (sqlite3_int64)delta * 1000 / interval_ms : 0;
+}
+
+/* Called with the log mutex held. */
+static void _awtk_status_log_sample_db(awtk_status_log_db_t* e,
+                                       const sqlite3_awtk_status_sample* g) {
+  char line[512];
+  int hit, miss, write, spill, la_hit, la_miss;
+  int la_size = 0;
+  int la_full = 0;
+  sqlite3_awtk_status_sample* s = &e->last;
+  const char* filename = sqlite3_db_filename(e->db, "main");
+  sqlite3_int64 now_ms = g->iTimeMs;
+  sqlite3_int64 interval_ms = now_ms - (sqlite3_int64)e->last_ms;
+
+  *s = *g;
+  s->nIntervalMs = interval_ms;
+  e->last_ms = (uint64_t)now_ms;
+  s->nCacheUsed = _awtk_status_log_db_get(e->db, SQLITE_DBSTATUS_CACHE_USED, NULL);
+  s->nLookasideUsed = _awtk_status_log_db_get(e->db, SQLITE_DBSTATUS_LOOKASIDE_USED, NULL);
+  s->nSchemaUsed = _awtk_status_log_db_get(e->db, SQLITE_DBSTATUS_SCHEMA_USED, NULL);
+  s->nStmtUsed = _awtk_status_log_db_get(e->db, SQLITE_DBSTATUS_STMT_USED, NULL);
+
+  hit = _awtk_status_log_db_get(e->db, SQLITE_DBSTATUS_CACHE_HIT, NULL);
+  miss = _awtk_status_log_db_get(e->db, SQLITE_DBSTATUS_CACHE_MISS, NULL);
+  write = _awtk_status_log_db_get(e->db, SQLITE_DBSTATUS_CACHE_WRITE, NULL);
+#ifdef SQLITE_DBSTATUS_CACHE_SPILL
+  spill = _awtk_status_log_db_get(e->db, SQLITE_DBSTATUS_CACHE_SPILL, NULL);
+#else
+  spill = 0;
+#endif /*SQLITE_DBSTATUS_CACHE_SPILL*/
+  /* the lookaside counters only have a high-water value */
+  _awtk_status_log_db_get(e->db, SQLITE_DBSTATUS_LOOKASIDE_HIT, &la_hit);
+  _awtk_status_log_db_get(e->db, SQLITE_DBSTATUS_LOOKASIDE_MISS_SIZE, &la_size);
+  _awtk_status_log_db_get(e->db, SQLITE_DBSTATUS_LOOKASIDE_MISS_FULL, &la_full);
+  la_miss = la_size + la_full;
+
+  s->nCacheHit = hit - e->nCacheHit;
+  s->nCacheMiss = miss - e->nCacheMiss;
+  s->nCacheWrite = write - e->nCacheWrite;
+  s->nCacheSpill = spill - e->nCacheSpill;
+  s->nLookasideHit = la_hit - e->nLookasideHit;
+  s->nLookasideMiss = la_miss - e->nLookasideMiss;
+  e->nCacheHit = hit;
+  e->nCacheMiss = miss;
+  e->nCacheWrite = write;
+  e->nCacheSpill = spill;
+  e->nLookasideHit = la_hit;
+  e->nLookasideMiss = la_miss;
+
+  tk_snprintf(line, sizeof(line),
+              "%lld,%lld,%lld,%lld,%lld,%lld,%lld,"
+              "%d,%lld,%lld,%lld,%lld,%d,%d,%lld,%lld,%d,%d,%s\n",
+              (long long)now_ms, (long long)interval_ms, (long long)s->nMemUsed,
+              (long long)s->mxMemUsed, (long long)s->nPageCacheUsed,
+              (long long)s->nPageCacheOverflow, (long long)s->nMallocCount, s->nCacheUsed,
+              (long long)_awtk_status_log_rate(s->nCacheHit, interval_ms),
+              (long long)_awtk_status_log_rate(s->nCacheMiss, interval_ms),
+              (long long)_awtk_status_log_rate(s->nCacheWrite, interval_ms),
+              (long long)_awtk_status_log_rate(s->nCacheSpill, interval_ms),
+              s->nCacheHit + s->nCacheMiss > 0
+                  ? s->nCacheHit * 100 / (s->nCacheHit + s->nCacheMiss)
+                  : 100,
+              s->nLookasideUsed, (long long)_awtk_status_log_rate(s->nLookasideHit, interval_ms),
+              (long long)_awtk_status_log_rate(s->nLookasideMiss, interval_ms), s->nSchemaUsed,
+              s->nStmtUsed, filename != NULL && filename[0] != '\0' ? filename : ":memory:");
+  _awtk_log_file_write(&_awtk_status_log.out, line);
+}
+
+static ret_t _awtk_status_log_on_timer(const timer_info_t* info) {
+  sqlite3_awtk_status_log_sample();
+
+  return RET_REPEAT;
+}
+
+/*
+** Start sampling the attached connections every nIntervalMs (0: only when
+** sqlite3_awtk_status_log_sample() is called) into zPath (NULL: log_info()),
+** rotated past nMaxBytes (0: SQLITE_AWTK_STATUS_LOG_MAX_BYTES).
+*/
+SQLITE_API int sqlite3_awtk_status_log_init(const char* zPath, int nIntervalMs, int nMaxBytes) {
+  if (_awtk_status_log.mutex != NULL) {
+    return SQLITE_MISUSE;
+  }
+
+  if (zPath != NULL && strlen(zPath) > AWTK_MAX_PATHNAME) {
+    return SQLITE_MISUSE;
+  }
+
+  memset(&_awtk_status_log, 0x00, sizeof(_awtk_status_log));
+  _awtk_status_log.mutex = tk_mutex_create();
+  if (_awtk_status_log.mutex == NULL) {
+    return SQLITE_NOMEM;
+  }
+
+  _awtk_log_file_init(&_awtk_status_log.out, zPath,
+                      nMaxBytes > 0 ? nMaxBytes : SQLITE_AWTK_STATUS_LOG_MAX_BYTES,
+                      AWTK_STATUS_LOG_HEADER);
+
+  if (nIntervalMs > 0) {
+    _awtk_status_log.timer_id = timer_add(_awtk_status_log_on_timer, NULL, nIntervalMs);
+  }
+
+  return SQLITE_OK;
+}
+
+SQLITE_API void sqlite3_awtk_status_log_deinit(void) {
+  tk_mutex_t* mutex = _awtk_status_log.mutex;
+
+  if (mutex == NULL) {
+    return;
+  }
+
+  if (_awtk_status_log.timer_id != TK_INVALID_ID) {
+    timer_remove(_awtk_status_log.timer_id);
+  }
+
+  tk_mutex_lock(mutex);
+  _awtk_log_file_close(&_awtk_status_log.out);
+  memset(&_awtk_status_log, 0x00, sizeof(_awtk_status_log));
+  tk_mutex_unlock(mutex);
+  tk_mutex_destroy(mutex);
+}
+
+/* Rates of the first sample are counted from the attach. */
+SQLITE_API int sqlite3_awtk_status_log_attach(sqlite3* db) {
+  int i;
+  int rc = SQLITE_FULL;
+  awtk_status_log_db_t* empty = NULL;
+
+  if (db == NULL || _awtk_status_log.mutex == NULL) {
+    return SQLITE_MISUSE;
+  }
+
+  tk_mutex_lock(_awtk_status_log.mutex);
+  for (i = 0; i < SQLITE_AWTK_STATUS_LOG_MAX_DB; i++) {
+    if (_awtk_status_log.dbs[i].db == db) {
+      empty = NULL;
+      rc = SQLITE_OK;
+      break;
+    } else if (_awtk_status_log.dbs[i].db == NULL && empty == NULL) {
+      empty = &_awtk_status_log.dbs[i];
+    }
+  }
+
+  if (empty != NULL) {
+    int la_size = 0;
+    int la_full = 0;
+
+    empty->db = db;
+    empty->last_ms = time_now_ms();
+    empty->nCacheHit = _awtk_status_log_db_get(db, SQLITE_DBSTATUS_CACHE_HIT, NULL);
+    empty->nCacheMiss = _awtk_status_log_db_get(db, SQLITE_DBSTATUS_CACHE_MISS, NULL);
+    empty->nCacheWrite = _awtk_status_log_db_get(db, SQLITE_DBSTATUS_CACHE_WRITE, NULL);
+#ifdef SQLITE_DBSTATUS_CACHE_SPILL
+    empty->nCacheSpill = _awtk_status_log_db_get(db, SQLITE_DBSTATUS_CACHE_SPILL, NULL);
+#endif /*SQLITE_DBSTATUS_CACHE_SPILL*/
+    _awtk_status_log_db_get(db, SQLITE_DBSTATUS_LOOKASIDE_HIT, &empty->nLookasideHit);
+    _awtk_status_log_db_get(db, SQLITE_DBSTATUS_LOOKASIDE_MISS_SIZE, &la_size);
+    _awtk_status_log_db_get(db, SQLITE_DBSTATUS_LOOKASIDE_MISS_FULL, &la_full);
+    empty->nLookasideMiss = la_size + la_full;
+    rc = SQLITE_OK;
+  }
+  tk_mutex_unlock(_awtk_status_log.mutex);
+
+  return rc;
+}
+
+/* Detach a connection before closing it. */
+SQLITE_API int sqlite3_awtk_status_log_detach(sqlite3* db) {
+  int i;
+  int rc = SQLITE_NOTFOUND;
+
+  if (_awtk_status_log.mutex == NULL) {
+    return SQLITE_MISUSE;
+  }
+
+  tk_mutex_lock(_awtk_status_log.mutex);
+  for (i = 0; i < SQLITE_AWTK_STATUS_LOG_MAX_DB; i++) {
+    if (db != NULL && _awtk_status_log.dbs[i].db == db) {
+      memset(&_awtk_status_log.dbs[i], 0x00, sizeof(_awtk_status_log.dbs[i]));
+      rc = SQLITE_OK;
+    }
+  }
+  tk_mutex_unlock(_awtk_status_log.mutex);
+
+  return rc;
+}
+
+SQLITE_API void sqlite3_awtk_status_log_sample(void) {
+  int i;
+  sqlite3_int64 hw = 0;
+  sqlite3_awtk_status_sample g;
+
+  if (_awtk_status_log.mutex == NULL) {
+    return;
+  }
+
+  memset(&g, 0x00, sizeof(g));
+  sqlite3_status64(SQLITE_STATUS_MEMORY_USED, &g.nMemUsed, &g.mxMemUsed, 0);
+  sqlite3_status64(SQLITE_STATUS_PAGECACHE_USED, &g.nPageCacheUsed, &hw, 0);
+  sqlite3_status64(SQLITE_STATUS_PAGECACHE_OVERFLOW, &g.nPageCacheOverflow, &hw, 0);
+  sqlite3_status64(SQLITE_STATUS_MALLOC_COUNT, &g.nMallocCount, &hw, 0);
+
+  g.iTimeMs = (sqlite3_int64)time_now_ms();
+
+  tk_mutex_lock(_awtk_status_log.mutex);
+  for (i = 0; i < SQLITE_AWTK_STATUS_LOG_MAX_DB; i++) {
+    if (_awtk_status_log.dbs[i].db != NULL) {
+      _awtk_status_log_sample_db(&_awtk_status_log.dbs[i], &g);
+    }
+  }
+  tk_mutex_unlock(_awtk_status_log.mutex);
+}
+
+SQLITE_API int sqlite3_awtk_status_log_get(sqlite3* db, sqlite3_awtk_status_sample* pSample) {
+  int i;
+  int rc = SQLITE_NOTFOUND;
+
+  memset(pSample, 0x00, sizeof(*pSample));
+  if (_awtk_status_log.mutex == NULL) {
+    return SQLITE_MISUSE;
+  }
+
+  tk_mutex_lock(_awtk_status_log.mutex);
+  for (i = 0; i < SQLITE_AWTK_STATUS_LOG_MAX_DB; i++) {
+    if (db != NULL && _awtk_status_log.dbs[i].db == db) {
+      *pSample = _awtk_status_log.dbs[i].last;
+      rc = SQLITE_OK;
+      break;
+    }
+  }
+  tk_mutex_unlock(_awtk_status_log.mutex);
+
+  return rc;
+}
+
+#endif /* SQLITE_AWTK_ENABLE_STATUS_LOG */
@@ -0,0 +1,403 @@
+#ifndef AWTK_STMT_CACHE_H
+#define AWTK_STMT_CACHE_H
+
+/*
+** Prepared statement cache: sqlite3_awtk_prepare_cached() returns the
+** statement for a SQL text from a small LRU cache of its connection, so SQL
+** that runs again and again (the inserts and lookups of an application) is
+** parsed and planned once.
+**
+** A statement is taken out of the cache while it is in use and goes back
+** with sqlite3_awtk_stmt_release(), which resets it and clears its
+** bindings. Asking for the same SQL again before the release (a nested
+** loop, another thread) prepares a second statement, finalized on release.
+** Only SQL text holding exactly one statement is cached.
+**
+** The cache is dropped when the schema cookie of one of the connection's
+** databases changes: at once for DDL run on the connection, after the
+** schema is read again for changes made by other connections (until then
+** sqlite3_step() prepares an outdated statement again by itself). A
+** statement expired for other reasons (sqlite3_create_function()...) is
+** prepared again when it is next taken from the cache.
+**
+** Idle statements are finalized when the connection is closed, from a close
+** hook of the trace multiplexer (awtk_trace.h), so sqlite3_close() succeeds
+** as long as every statement has been released. SQLite calls the hook before
+** it knows whether the close will succeed, so the cache is dropped even when
+** sqlite3_close() then returns SQLITE_BUSY: the connection stays usable, the
+** statements still in use are finalized on release and the cache fills again
+** from the next sqlite3_awtk_prepare_cached().
+**
+** The table of caches has a mutex of its own, created by sqlite3_os_init().
+** It is taken with a connection mutex held and nothing else is locked under
+** it.
+*/
+#ifndef SQLITE_AWTK_STMT_CACHE_MAX
+#define SQLITE_AWTK_STMT_CACHE_MAX 16
+#endif /*SQLITE_AWTK_STMT_CACHE_MAX*/
+
+#ifndef SQLITE_AWTK_STMT_CACHE_MAX_DB
+#define SQLITE_AWTK_STMT_CACHE_MAX_DB 8
+#endif /*SQLITE_AWTK_STMT_CACHE_MAX_DB*/
+
+typedef struct _awtk_stmt_cache_entry_t {
+  sqlite3_stmt* stmt;
+  uint32_t hash;
+  uint32_t last_use;
+  bool_t busy;
+} awtk_stmt_cache_entry_t;
+
+typedef struct _awtk_stmt_cache_t {
+  sqlite3* db;
+  int nMax;
+  int nEntry;
+  uint32_t tick;
+  uint32_t schema;
+  sqlite3_int64 nHit;
+  sqlite3_int64 nMiss;
+  sqlite3_int64 nUncached;
+  sqlite3_int64 nEvict;
+  sqlite3_int64 nInvalidate;
+  awtk_stmt_cache_entry_t entries[SQLITE_AWTK_STMT_CACHE_MAX];
+} awtk_stmt_cache_t;
+
+static awtk_stmt_cache_t _awtk_stmt_caches[SQLITE_AWTK_STMT_CACHE_MAX_DB];
+static tk_mutex_t* _awtk_stmt_cache_mutex;
+
+static int _awtk_stmt_cache_init(void) {
+  if (_awtk_stmt_cache_mutex == NULL) {
+    _awtk_stmt_cache_mutex = tk_mutex_create();
+  }
+
+  return _awtk_stmt_cache_mutex != NULL ? SQLITE_OK : SQLITE_NOMEM;
+}
+
+static void _awtk_stmt_cache_deinit(void) {
+  if (_awtk_stmt_cache_mutex != NULL) {
+    tk_mutex_destroy(_awtk_stmt_cache_mutex);
+    _awtk_stmt_cache_mutex = NULL;
+  }
+}
+
+static uint32_t _awtk_stmt_cache_hash(const char* s) {
+  uint32_t h = 2166136261u;
+
+  while (*s != '\0') {
+    h = (h ^ (uint8_t)*s++) * 16777619u;
+  }
+
+  return h;
+}
+
+/* Set by sqlite3ExpirePreparedStatements(), sqlite3_expired() needs SQLITE_OMIT_DEPRECATED off. */
+static bool_t _awtk_stmt_cache_expired(sqlite3_stmt* stmt) {
+  return ((Vdbe*)stmt)->expired != 0;
+}
+
+/* The functions below are called with the connection's mutex held. */
+
+static uint32_t _awtk_stmt_cache_schema(sqlite3* db) {
+  int i;
+  uint32_t h = (uint32_t)db->nDb;
+
+  for (i = 0; i < db->nDb; i++) {
+    if (db->aDb[i].pSchema != NULL) {
+      h = h * 31 + (uint32_t)db->aDb[i].pSchema->schema_cookie;
+    }
+  }
+
+  return h;
+}
+
+static void _awtk_stmt_cache_remove(awtk_stmt_cache_t* c, awtk_stmt_cache_entry_t* e) {
+  *e = c->entries[--c->nEntry];
+  memset(&c->entries[c->nEntry], 0x00, sizeof(*e));
+}
+
+/*
+** Drop every statement after a schema change, the ones in use are finalized
+** on release. Returns TRUE when the cache was dropped.
+*/
+static bool_t _awtk_stmt_cache_check_schema(awtk_stmt_cache_t* c) {
+  int i;
+  uint32_t schema = _awtk_stmt_cache_schema(c->db);
+
+  if (c->schema != schema) {
+    for (i = 0; i < c->nEntry; i++) {
+      if (!c->entries[i].busy) {
+        sqlite3_finalize(c->entries[i].stmt);
+      }
+    }
+    memset(c->entries, 0x00, sizeof(c->entries));
+    c->nInvalidate += c->nEntry;
+    c->nEntry = 0;
+    c->schema = schema;
+
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+/* Finalize the idle statements, the ones in use are finalized on release. */
+static void _awtk_stmt_cache_clear(awtk_stmt_cache_t* c) {
+  int i;
+
+  for (i = 0; i < c->nEntry; i++) {
+    if (!c->entries[i].busy) {
+      sqlite3_finalize(c->entries[i].stmt);
+    }
+  }
+
+  tk_mutex_lock(_awtk_stmt_cache_mutex);
+  memset(c, 0x00, sizeof(*c));
+  tk_mutex_unlock(_awtk_stmt_cache_mutex);
+}
+
+/* Finalize the least recently used idle statements until nKeep are left. */
+static void _awtk_stmt_cache_shrink(awtk_stmt_cache_t* c, int nKeep) {
+  while (c->nEntry > nKeep) {
+    int i;
+    awtk_stmt_cache_entry_t* lru = NULL;
+
+    for (i = 0; i < c->nEntry; i++) {
+      awtk_stmt_cache_entry_t* e = &c->entries[i];
+
+      if (!e->busy && (lru == NULL || e->last_use < lru->last_use)) {
+        lru = e;
+      }
+    }
+
+    if (lru == NULL) {
+      break;
+    }
+
+    sqlite3_finalize(lru->stmt);
+    _awtk_stmt_cache_remove(c, lru);
+    c->nEvict++;
+  }
+}
+
+static int _awtk_stmt_cache_on_close(unsigned mask, void* ctx, void* p, void* x) {
+  awtk_stmt_cache_t* c = (awtk_stmt_cache_t*)ctx;
+
+  if (c->db == (sqlite3*)p) {
+    _awtk_stmt_cache_clear(c);
+  }
+
+  return 0;
+}
+
+static awtk_stmt_cache_t* _awtk_stmt_cache_find(sqlite3* db, bool_t create) {
+  int i;
+  awtk_stmt_cache_t* c = NULL;
+  awtk_stmt_cache_t* empty = NULL;
+
+  tk_mutex_lock(_awtk_stmt_cache_mutex);
+  for (i = 0; i < SQLITE_AWTK_STMT_CACHE_MAX_DB && c == NULL; i++) {
+    if (_awtk_stmt_caches[i].db == db) {
+      c = &_awtk_stmt_caches[i];
+    } else if (_awtk_stmt_caches[i].db == NULL && empty == NULL) {
+      empty = &_awtk_stmt_caches[i];
+    }
+  }
+
+  if (c == NULL && create && empty != NULL) {
+    c = empty;
+    c->db = db;
+    c->nMax = SQLITE_AWTK_STMT_CACHE_MAX;
+  } else {
+    create = FALSE;
+  }
+  tk_mutex_unlock(_awtk_stmt_cache_mutex);
+
+  if (create &&
+      sqlite3_awtk_trace_add(db, SQLITE_TRACE_CLOSE, _awtk_stmt_cache_on_close, c) != SQLITE_OK) {
+    tk_mutex_lock(_awtk_stmt_cache_mutex);
+    memset(c, 0x00, sizeof(*c));
+    tk_mutex_unlock(_awtk_stmt_cache_mutex);
+    c = NULL;
+  }
+
+  return c;
+}
+
+SQLITE_API int sqlite3_awtk_prepare_cached(sqlite3* db, const char* zSql, sqlite3_stmt** ppStmt) {
+  int i;
+  int rc = SQLITE_OK;
+  uint32_t hash = 0;
+  const char* tail = NULL;
+  awtk_stmt_cache_t* c = NULL;
+  awtk_stmt_cache_entry_t* e = NULL;
+
+  if (ppStmt == NULL) {
+    return SQLITE_MISUSE;
+  }
+  *ppStmt = NULL;
+  if (db == NULL || zSql == NULL) {
+    return SQLITE_MISUSE;
+  }
+
+  hash = _awtk_stmt_cache_hash(zSql);
+  sqlite3_mutex_enter(sqlite3_db_mutex(db));
+  c = _awtk_stmt_cache_find(db, TRUE);
+  if (c != NULL) {
+    _awtk_stmt_cache_check_schema(c);
+  }
+
+  for (i = 0; c != NULL && i < c->nEntry; i++) {
+    if (c->entries[i].hash == hash && strcmp(sqlite3_sql(c->entries[i].stmt), zSql) == 0) {
+      e = &c->entries[i];
+      break;
+    }
+  }
+
+  if (e != NULL && !e->busy && _awtk_stmt_cache_expired(e->stmt)) {
+    sqlite3_finalize(e->stmt);
+    _awtk_stmt_cache_remove(c, e);
+    c->nInvalidate++;
+    e = NULL;
+  }
+
+  if (e != NULL && !e->busy) {
+    e->busy = TRUE;
+    e->last_use = ++c->tick;
+    c->nHit++;
+    *ppStmt = e->stmt;
+    sqlite3_mutex_leave(sqlite3_db_mutex(db));
+
+    return SQLITE_OK;
+  }
+
+  rc = sqlite3_prepare_v2(db, zSql, -1, ppStmt, &tail);
+  if (c != NULL) {
+    c->nMiss++;
+    if (rc == SQLITE_OK && *ppStmt != NULL) {
+      /* preparing may have read the schema */
+      if (_awtk_stmt_cache_check_schema(c)) {
+        e = NULL;
+      }
+
+      /* e: the same SQL is in use */
+      if (e == NULL && tail[0] == '\0' && c->nMax > 0) {
+        _awtk_stmt_cache_shrink(c, c->nMax - 1);
+      }
+
+      if (e == NULL && tail[0] == '\0' && c->nEntry < c->nMax) {
+        e = &c->entries[c->nEntry++];
+        e->stmt = *ppStmt;
+        e->hash = hash;
+        e->last_use = ++c->tick;
+        e->busy = TRUE;
+      } else {
+        c->nUncached++;
+      }
+    }
+  }
+  sqlite3_mutex_leave(sqlite3_db_mutex(db));
+
+  return rc;
+}
+
+SQLITE_API int sqlite3_awtk_stmt_release(sqlite3_stmt* pStmt) {
+  int i;
+  int rc = SQLITE_OK;
+  sqlite3* db = NULL;
+  awtk_stmt_cache_t* c = NULL;
+  awtk_stmt_cache_entry_t* e = NULL;
+
+  if (pStmt == NULL) {
+    return SQLITE_OK;
+  }
+
+  db = sqlite3_db_handle(pStmt);
+  sqlite3_mutex_enter(sqlite3_db_mutex(db));
+  c = _awtk_stmt_cache_find(db, FALSE);
+  for (i = 0; c != NULL && i < c->nEntry; i++) {
+    if (c->entries[i].stmt == pStmt) {
+      e = &c->entries[i];
+      break;
+    }
+  }
+
+  if (e != NULL && e->busy && !_awtk_stmt_cache_expired(pStmt) && c->nEntry <= c->nMax) {
+    rc = sqlite3_reset(pStmt);
+    sqlite3_clear_bindings(pStmt);
+    e->busy = FALSE;
+  } else {
+    if (e != NULL) {
+      _awtk_stmt_cache_remove(c, e);
+    }
+    rc = sqlite3_finalize(pStmt);
+  }
+  sqlite3_mutex_leave(sqlite3_db_mutex(db));
+
+  return rc;
+}
+
+SQLITE_API int sqlite3_awtk_stmt_cache_set_max(sqlite3* db, int nMax) {
+  awtk_stmt_cache_t* c = NULL;
+
+  if (db == NULL || nMax < 0) {
+    return SQLITE_MISUSE;
+  }
+
+  sqlite3_mutex_enter(sqlite3_db_mutex(db));
+  c = _awtk_stmt_cache_find(db, TRUE);
+  if (c != NULL) {
+    c->nMax = tk_min(nMax, SQLITE_AWTK_STMT_CACHE_MAX);
+    _awtk_stmt_cache_shrink(c, c->nMax);
+  }
+  sqlite3_mutex_leave(sqlite3_db_mutex(db));
+
+  return c != NULL ? SQLITE_OK : SQLITE_FULL;
+}
+
+SQLITE_API int sqlite3_awtk_stmt_cache_clear(sqlite3* db) {
+  awtk_stmt_cache_t* c = NULL;
+
+  if (db == NULL) {
+    return SQLITE_MISUSE;
+  }
+
+  /* the hook goes with the slot: a later prepare reuses both and adds its own */
+  sqlite3_mutex_enter(sqlite3_db_mutex(db));
+  c = _awtk_stmt_cache_find(db, FALSE);
+  if (c != NULL) {
+    sqlite3_awtk_trace_remove(db, _awtk_stmt_cache_on_close, c);
+    _awtk_stmt_cache_clear(c);
+  }
+  sqlite3_mutex_leave(sqlite3_db_mutex(db));
+
+  return SQLITE_OK;
+}
+
+SQLITE_API int sqlite3_awtk_stmt_cache_stats_get(sqlite3* db, sqlite3_awtk_stmt_cache_stats* pStats,
+                                                 int resetFlag) {
+  awtk_stmt_cache_t* c = NULL;
+
+  if (db == NULL || pStats == NULL) {
+    return SQLITE_MISUSE;
+  }
+
+  memset(pStats, 0x00, sizeof(*pStats));
+  sqlite3_mutex_enter(sqlite3_db_mutex(db));
+  c = _awtk_stmt_cache_find(db, FALSE);
+  if (c != NULL) {
+    pStats->nCached = c->nEntry;
+    pStats->nMax = c->nMax;
+    pStats->nHit = c->nHit;
+    pStats->nMiss = c->nMiss;
+    pStats->nUncached = c->nUncached;
+    pStats->nEvict = c->nEvict;
+    pStats->nInvalidate = c->nInvalidate;
+    if (resetFlag) {
+      c->nHit = c->nMiss = c->nUncached = c->nEvict = c->nInvalidate = 0;
+    }
+  }
+  sqlite3_mutex_leave(sqlite3_db_mutex(db));
+
+  return c != NULL ? SQLITE_OK : SQLITE_NOTFOUND;
+}
+
+#endif /*AWTK_STMT_CACHE_H*/
@@ -0,0 +1,278 @@
+#ifdef SQLITE_AWTK_ENABLE_STMT_PROF
+/*
+** Statement profiler: wall-clock time, VM steps and a latency histogram per
+** statement shape, for every statement run on an attached connection.
+**
+** SQL is normalized before it is aggregated (_awtk_trace_normalize()), so
+** "WHERE id=1" and "WHERE id = 2" share an entry. The table is bounded; on a
+** miss when it is full the least recently run entry is dropped.
+**
+** Run times and VM steps are per run, from the trace multiplexer
+** (awtk_trace.h): from the first step of a statement to its end.
+*/
+#ifndef SQLITE_AWTK_STMT_PROF_MAX
+#define SQLITE_AWTK_STMT_PROF_MAX 64
+#endif /*SQLITE_AWTK_STMT_PROF_MAX*/
+
+#ifndef SQLITE_AWTK_STMT_PROF_SQL_LEN
+#define SQLITE_AWTK_STMT_PROF_SQL_LEN 128
+#endif /*SQLITE_AWTK_STMT_PROF_SQL_LEN*/
+
+#ifndef SQLITE_AWTK_STMT_PROF_TOP
+#define SQLITE_AWTK_STMT_PROF_TOP 10
+#endif /*SQLITE_AWTK_STMT_PROF_TOP*/
+
+typedef struct _awtk_stmt_prof_entry_t {
+  uint32_t hash;
+  uint32_t last_use;
+  char sql[SQLITE_AWTK_STMT_PROF_SQL_LEN];
+  sqlite3_int64 nRun;
+  sqlite3_int64 nTotalUs;
+  sqlite3_int64 mxUs;
+  sqlite3_int64 nStep;
+  sqlite3_int64 aHist[SQLITE_AWTK_STMT_PROF_BUCKETS];
+} awtk_stmt_prof_entry_t;
+
+static struct {
+  tk_mutex_t* mutex;
+  uint32_t tick;
+  uint32_t timer_id;
+  int nEntry;
+  sqlite3_int64 nEvict;
+  awtk_stmt_prof_entry_t entries[SQLITE_AWTK_STMT_PROF_MAX];
+} _awtk_stmt_prof;
+
+static int _awtk_stmt_prof_bucket(sqlite3_int64 us) {
+  int b = 0;
+
+  while (b < SQLITE_AWTK_STMT_PROF_BUCKETS - 1 && us > ((sqlite3_int64)1 << b)) {
+    b++;
+  }
+
+  return b;
+}
+
+/* Called with the profiler mutex held. */
+static awtk_stmt_prof_entry_t* _awtk_stmt_prof_entry(const char* sql) {
+  int i;
+  uint32_t hash = _awtk_trace_hash(sql);
+  awtk_stmt_prof_entry_t* e = NULL;
+
+  for (i = 0; i < _awtk_stmt_prof.nEntry; i++) {
+    e = &_awtk_stmt_prof.entries[i];
+    if (e->hash == hash && strcmp(e->sql, sql) == 0) {
+      return e;
+    }
+  }
+
+  if (_awtk_stmt_prof.nEntry < SQLITE_AWTK_STMT_PROF_MAX) {
+    e = &_awtk_stmt_prof.entries[_awtk_stmt_prof.nEntry++];
+  } else {
+    /* least recently run; the tick wraps, so compare by age */
+    e = &_awtk_stmt_prof.entries[0];
+    for (i = 1; i < SQLITE_AWTK_STMT_PROF_MAX; i++) {
+      awtk_stmt_prof_entry_t* iter = &_awtk_stmt_prof.entries[i];
+
+      if (_awtk_stmt_prof.tick - iter->last_use > _awtk_stmt_prof.tick - e->last_use) {
+        e = iter;
+      }
+    }
+    _awtk_stmt_prof.nEvict++;
+  }
+
+  memset(e, 0x00, sizeof(*e));
+  e->hash = hash;
+  tk_strncpy(e->sql, sql, sizeof(e->sql) - 1);
+
+  return e;
+}
+
+static int _awtk_stmt_prof_on_trace(unsigned mask, void* ctx, void* p, void* x) {
+  char sql[SQLITE_AWTK_STMT_PROF_SQL_LEN];
+  sqlite3_stmt* stmt = (sqlite3_stmt*)p;
+  sqlite3_int64 us = _awtk_trace_run_us(stmt, x);
+  int steps = _awtk_trace_run_status(stmt, SQLITE_STMTSTATUS_VM_STEP);
+  awtk_stmt_prof_entry_t* e = NULL;
+
+  if (_awtk_stmt_prof.mutex == NULL) {
+    return 0;
+  }
+
+  _awtk_trace_normalize(sqlite3_sql(stmt) ? sqlite3_sql(stmt) : "", sql, sizeof(sql));
+
+  tk_mutex_lock(_awtk_stmt_prof.mutex);
+  e = _awtk_stmt_prof_entry(sql);
+  e->last_use = ++_awtk_stmt_prof.tick;
+  e->nRun++;
+  e->nTotalUs += us;
+  e->nStep += steps;
+  e->aHist[_awtk_stmt_prof_bucket(us)]++;
+  if (us > e->mxUs) {
+    e->mxUs = us;
+  }
+  tk_mutex_unlock(_awtk_stmt_prof.mutex);
+
+  return 0;
+}
+
+static ret_t _awtk_stmt_prof_on_timer(const timer_info_t* info) {
+  sqlite3_awtk_stmt_prof_dump(SQLITE_AWTK_STMT_PROF_TOP);
+
+  return RET_REPEAT;
+}
+
+/*
+** Start the profiler. With nIntervalMs > 0 the top statements are logged
+** with log_info() at that interval, from an AWTK timer on the GUI thread.
+*/
+SQLITE_API int sqlite3_awtk_stmt_prof_init(int nIntervalMs) {
+  if (_awtk_stmt_prof.mutex != NULL) {
+    return SQLITE_MISUSE;
+  }
+
+  _awtk_stmt_prof.mutex = tk_mutex_create();
+  if (_awtk_stmt_prof.mutex == NULL) {
+    return SQLITE_NOMEM;
+  }
+
+  if (nIntervalMs > 0) {
+    _awtk_stmt_prof.timer_id = timer_add(_awtk_stmt_prof_on_timer, NULL, nIntervalMs);
+  }
+
+  return SQLITE_OK;
+}
+
+/* Detach every connection before calling it. */
+SQLITE_API void sqlite3_awtk_stmt_prof_deinit(void) {
+  tk_mutex_t* mutex = _awtk_stmt_prof.mutex;
+
+  if (mutex == NULL) {
+    return;
+  }
+
+  if (_awtk_stmt_prof.timer_id != TK_INVALID_ID) {
+    timer_remove(_awtk_stmt_prof.timer_id);
+  }
+
+  tk_mutex_lock(mutex);
+  memset(&_awtk_stmt_prof, 0x00, sizeof(_awtk_stmt_prof));
+  tk_mutex_unlock(mutex);
+  tk_mutex_destroy(mutex);
+}
+
+SQLITE_API int sqlite3_awtk_stmt_prof_attach(sqlite3* db) {
+  return sqlite3_awtk_trace_add(db, SQLITE_TRACE_PROFILE, _awtk_stmt_prof_on_trace, NULL);
+}
+
+SQLITE_API int sqlite3_awtk_stmt_prof_detach(sqlite3* db) {
+  return sqlite3_awtk_trace_remove(db, _awtk_stmt_prof_on_trace, NULL);
+}
+
+SQLITE_API int sqlite3_awtk_stmt_prof_get(int iEntry, sqlite3_awtk_stmt_prof_entry* pEntry,
+                                          char* zSql, int nSql) {
+  int rc = SQLITE_RANGE;
+
+  if (_awtk_stmt_prof.mutex == NULL) {
+    return SQLITE_MISUSE;
+  }
+
+  tk_mutex_lock(_awtk_stmt_prof.mutex);
+  if (iEntry >= 0 && iEntry < _awtk_stmt_prof.nEntry) {
+    awtk_stmt_prof_entry_t* e = &_awtk_stmt_prof.entries[iEntry];
+
+    if (zSql != NULL && nSql > 0) {
+      tk_strncpy(zSql, e->sql, nSql - 1);
+    }
+    pEntry->nRun = e->nRun;
+    pEntry->nTotalUs = e->nTotalUs;
+    pEntry->mxUs = e->mxUs;
+    pEntry->nStep = e->nStep;
+    memcpy(pEntry->aHist, e->aHist, sizeof(pEntry->aHist));
+    rc = SQLITE_OK;
+  }
+  tk_mutex_unlock(_awtk_stmt_prof.mutex);
+
+  return rc;
+}
+
+SQLITE_API void sqlite3_awtk_stmt_prof_reset(void) {
+  if (_awtk_stmt_prof.mutex == NULL) {
+    return;
+  }
+
+  tk_mutex_lock(_awtk_stmt_prof.mutex);
+  _awtk_stmt_prof.nEntry = 0;
+  _awtk_stmt_prof.nEvict = 0;
+  tk_mutex_unlock(_awtk_stmt_prof.mutex);
+}
+
+/* Upper bound (us) of the histogram bucket holding the pct percentile. */
+static sqlite3_int64 _awtk_stmt_prof_percentile(const awtk_stmt_prof_entry_t* e, int pct) {
+  int b;
+  sqlite3_int64 seen = 0;
+
+  for (b = 0; b < SQLITE_AWTK_STMT_PROF_BUCKETS - 1; b++) {
+    seen += e->aHist[b];
+    if (seen * 100 >= e->nRun * pct) {
+      break;
+    }
+  }
+
+  return b < SQLITE_AWTK_STMT_PROF_BUCKETS - 1 ? (sqlite3_int64)1 << b : e->mxUs;
+}
+
+/* Log the nTop statements with the most total time. */
+SQLITE_API void sqlite3_awtk_stmt_prof_dump(int nTop) {
+  int i;
+  int n = 0;
+  sqlite3_int64 nEvict = 0;
+  awtk_stmt_prof_entry_t* top = NULL;
+
+  if (_awtk_stmt_prof.mutex == NULL) {
+    return;
+  }
+
+  if (nTop <= 0 || nTop > SQLITE_AWTK_STMT_PROF_MAX) {
+    nTop = SQLITE_AWTK_STMT_PROF_MAX;
+  }
+
+  top = TKMEM_ZALLOCN(awtk_stmt_prof_entry_t, nTop);
+  if (top == NULL) {
+    return;
+  }
+
+  tk_mutex_lock(_awtk_stmt_prof.mutex);
+  nEvict = _awtk_stmt_prof.nEvict;
+  for (i = 0; i < _awtk_stmt_prof.nEntry; i++) {
+    awtk_stmt_prof_entry_t* e = &_awtk_stmt_prof.entries[i];
+    int j = n < nTop ? n++ : nTop;
+
+    /* insertion sort into the nTop slowest by total time */
+    while (j > 0 && e->nTotalUs > top[j - 1].nTotalUs) {
+      if (j < nTop) {
+        top[j] = top[j - 1];
+      }
+      j--;
+    }
+    if (j < nTop) {
+      top[j] = *e;
+    }
+  }
+  tk_mutex_unlock(_awtk_stmt_prof.mutex);
+
+  log_info("%10s %6s %10s %8s %8s %8s %8s  sql (%lld evicted)\n", "total_us", "runs", "avg_us",
+           "p50_us", "p99_us", "max_us", "steps", (long long)nEvict);
+  for (i = 0; i < n; i++) {
+    awtk_stmt_prof_entry_t* e = &top[i];
+
+    log_info("%10lld %6lld %10lld %8lld %8lld %8lld %8lld  %s\n", (long long)e->nTotalUs,
+             (long long)e->nRun, (long long)(e->nTotalUs / e->nRun),
+             (long long)_awtk_stmt_prof_percentile(e, 50),
+             (long long)_awtk_stmt_prof_percentile(e, 99), (long long)e->mxUs,
+             (long long)(e->nStep / e->nRun), e->sql);
+  }
+
+  TKMEM_FREE(top);
+}
+
+#endif /* SQLITE_AWTK_ENABLE_STMT_PROF */
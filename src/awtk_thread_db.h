@@ -0,0 +1,155 @@
+#ifdef SQLITE_AWTK_ENABLE_THREAD_DB
+/*
+** Per-thread connection registry for the multi-thread profile
+** (SQLITE_THREADSAFE=2), where SQLite no longer serializes calls on a
+** connection and each connection must stay on one thread.
+**
+** sqlite3_awtk_thread_db() returns the calling thread's connection to a
+** file, opening it on first use. With SQLITE_AWTK_THREAD_DB_CHECK (on by
+** default in SQLITE_DEBUG builds) every statement started on a registered
+** connection is checked against the thread that opened it, and violations
+** are logged and counted.
+*/
+#ifndef SQLITE_AWTK_THREAD_DB_MAX
+#define SQLITE_AWTK_THREAD_DB_MAX 16
+#endif /*SQLITE_AWTK_THREAD_DB_MAX*/
+
+#if defined(SQLITE_DEBUG) && !defined(SQLITE_AWTK_THREAD_DB_CHECK)
+#define SQLITE_AWTK_THREAD_DB_CHECK 1
+#endif /*SQLITE_DEBUG*/
+
+typedef struct _awtk_thread_db_t {
+  uint64_t tid;
+  sqlite3* db;
+  char filename[AWTK_MAX_PATHNAME + 1];
+} awtk_thread_db_t;
+
+static struct {
+  awtk_thread_db_t entries[SQLITE_AWTK_THREAD_DB_MAX];
+  sqlite3_int64 nViolation;
+} _awtk_thread_db;
+
+#ifdef SQLITE_AWTK_THREAD_DB_CHECK
+static int _awtk_thread_db_on_trace(unsigned mask, void* ctx, void* p, void* x) {
+  awtk_thread_db_t* e = (awtk_thread_db_t*)ctx;
+  uint64_t tid = tk_thread_self();
+
+  if (e->tid != tid) {
+    sqlite3_mutex* mutex = sqlite3_mutex_alloc(SQLITE_MUTEX_STATIC_VFS1);
+
+    sqlite3_mutex_enter(mutex);
+    _awtk_thread_db.nViolation++;
+    sqlite3_mutex_leave(mutex);
+
+    log_error("sqlite connection %p of thread %llu used by thread %llu: %s\n", (void*)e->db,
+              (unsigned long long)e->tid, (unsigned long long)tid,
+              sqlite3_sql((sqlite3_stmt*)p));
+  }
+
+  return 0;
+}
+#endif /*SQLITE_AWTK_THREAD_DB_CHECK*/
+
+SQLITE_API int sqlite3_awtk_thread_db(const char* zFilename, int flags, sqlite3** ppDb) {
+  int i;
+  int rc = SQLITE_OK;
+  uint64_t tid = tk_thread_self();
+  awtk_thread_db_t* e = NULL;
+  sqlite3_mutex* mutex = sqlite3_mutex_alloc(SQLITE_MUTEX_STATIC_VFS1);
+
+  *ppDb = NULL;
+  if (zFilename == NULL || strlen(zFilename) > AWTK_MAX_PATHNAME) {
+    return SQLITE_MISUSE;
+  }
+
+  sqlite3_mutex_enter(mutex);
+  for (i = 0; i < SQLITE_AWTK_THREAD_DB_MAX; i++) {
+    awtk_thread_db_t* iter = &_awtk_thread_db.entries[i];
+
+    if (iter->db != NULL && iter->tid == tid && tk_str_eq(iter->filename, zFilename)) {
+      *ppDb = iter->db;
+      sqlite3_mutex_leave(mutex);
+      return SQLITE_OK;
+    } else if (iter->db == NULL && e == NULL) {
+      e = iter;
+    }
+  }
+
+  /* reserve the slot, the open itself runs without the registry lock */
+  if (e != NULL) {
+    e->tid = tid;
+    e->db = (sqlite3*)e;
+    tk_strncpy(e->filename, zFilename, AWTK_MAX_PATHNAME);
+  }
+  sqlite3_mutex_leave(mutex);
+
+  if (e == NULL) {
+    return SQLITE_FULL;
+  }
+
+  rc = sqlite3_open_v2(zFilename, ppDb, flags ? flags : SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE,
+                       NULL);
+  if (rc != SQLITE_OK) {
+    sqlite3_close(*ppDb);
+    *ppDb = NULL;
+  }
+
+  sqlite3_mutex_enter(mutex);
+  e->db = *ppDb;
+  sqlite3_mutex_leave(mutex);
+
+#ifdef SQLITE_AWTK_THREAD_DB_CHECK
+  if (*ppDb != NULL) {
+    sqlite3_awtk_trace_add(*ppDb, SQLITE_TRACE_STMT, _awtk_thread_db_on_trace, e);
+  }
+#endif /*SQLITE_AWTK_THREAD_DB_CHECK*/
+
+  return rc;
+}
+
+/* Close the connections the calling thread opened. Call it before the thread exits. */
+SQLITE_API int sqlite3_awtk_thread_db_close(void) {
+  int i;
+  int rc = SQLITE_OK;
+  uint64_t tid = tk_thread_self();
+  sqlite3_mutex* mutex = sqlite3_mutex_alloc(SQLITE_MUTEX_STATIC_VFS1);
+
+  for (i = 0; i < SQLITE_AWTK_THREAD_DB_MAX; i++) {
+    sqlite3* db = NULL;
+    awtk_thread_db_t* e = &_awtk_thread_db.entries[i];
+
+    sqlite3_mutex_enter(mutex);
+    if (e->tid == tid && e->db != NULL && e->db != (sqlite3*)e) {
+      db = e->db;
+    }
+    sqlite3_mutex_leave(mutex);
+
+    if (db != NULL) {
+      int ret = sqlite3_close(db);
+
+      if (ret == SQLITE_OK) {
+        sqlite3_mutex_enter(mutex);
+        e->db = NULL;
+        e->tid = 0;
+        sqlite3_mutex_leave(mutex);
+      } else {
+        rc = ret;
+      }
+    }
+  }
+
+  return rc;
+}
+
+SQLITE_API sqlite3_int64 sqlite3_awtk_thread_db_violations(void) {
+  sqlite3_int64 n = 0;
+  sqlite3_mutex* mutex = sqlite3_mutex_alloc(SQLITE_MUTEX_STATIC_VFS1);
+
+  sqlite3_mutex_enter(mutex);
+  n = _awtk_thread_db.nViolation;
+  sqlite3_mutex_leave(mutex);
+
+  return n;
+}
+
+#endif /* SQLITE_AWTK_ENABLE_THREAD_DB */
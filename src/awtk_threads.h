@@ -0,0 +1,103 @@
+#if SQLITE_MAX_WORKER_THREADS > 0 && SQLITE_THREADSAFE > 0 && !defined(SQLITE_THREADS_IMPLEMENTED)
+/*
+** SQLite's threads interface on tk_thread. With SQLITE_OS_OTHER the amalgamation
+** only has the single-threaded fallback, which runs every task inline when it
+** is joined, so PRAGMA threads never let the sorter use a second core.
+**
+** Defining SQLITE_THREADS_IMPLEMENTED here, ahead of threads.c, replaces that
+** fallback. If a thread cannot be started the task runs inline, as the
+** pthreads version does.
+*/
+#define SQLITE_THREADS_IMPLEMENTED 1
+
+/*
+** Stack size of sorter worker threads. 0 keeps the platform default, which
+** is often too small on RTOS targets for the merge of large sorts.
+*/
+#ifndef SQLITE_AWTK_THREAD_STACK_SIZE
+#define SQLITE_AWTK_THREAD_STACK_SIZE 0
+#endif /*SQLITE_AWTK_THREAD_STACK_SIZE*/
+
+struct SQLiteThread {
+  tk_thread_t* thread;
+  int done; /* Task already ran inline */
+  void* pOut;
+  void* (*xTask)(void*);
+  void* pIn;
+};
+
+static void* _awtk_thread_entry(void* args) {
+  SQLiteThread* p = (SQLiteThread*)args;
+
+  /* tk_thread_join() drops the result, so keep it for sqlite3ThreadJoin() */
+  p->pOut = p->xTask(p->pIn);
+  /* workers come and go with every sort, do not let them keep a trace ring */
+  AWTK_CTRACE_THREAD_END();
+
+  return NULL;
+}
+
+SQLITE_PRIVATE int sqlite3ThreadCreate(SQLiteThread** ppThread, void* (*xTask)(void*), void* pIn) {
+  SQLiteThread* p = NULL;
+
+  assert(ppThread != 0);
+  assert(xTask != 0);
+  /* This routine is never used in single-threaded mode */
+  assert(sqlite3GlobalConfig.bCoreMutex != 0);
+
+  *ppThread = 0;
+  p = (SQLiteThread*)sqlite3Malloc(sizeof(*p));
+  if (p == 0) {
+    return SQLITE_NOMEM;
+  }
+
+  memset(p, 0, sizeof(*p));
+  p->xTask = xTask;
+  p->pIn = pIn;
+
+  if (!sqlite3FaultSim(200)) {
+    p->thread = tk_thread_create(_awtk_thread_entry, p);
+  }
+
+  if (p->thread != NULL) {
+    tk_thread_set_name(p->thread, "sqlite_worker");
+    if (SQLITE_AWTK_THREAD_STACK_SIZE > 0) {
+      tk_thread_set_stack_size(p->thread, SQLITE_AWTK_THREAD_STACK_SIZE);
+    }
+
+    if (tk_thread_start(p->thread) != RET_OK) {
+      tk_thread_destroy(p->thread);
+      p->thread = NULL;
+    }
+  }
+
+  if (p->thread == NULL) {
+    p->done = 1;
+    p->pOut = xTask(pIn);
+  }
+
+  *ppThread = p;
+
+  return SQLITE_OK;
+}
+
+SQLITE_PRIVATE int sqlite3ThreadJoin(SQLiteThread* p, void** ppOut) {
+  int rc = SQLITE_OK;
+
+  assert(ppOut != 0);
+  if (NEVER(p == 0)) {
+    return SQLITE_NOMEM;
+  }
+
+  if (!p->done) {
+    rc = tk_thread_join(p->thread) == RET_OK ? SQLITE_OK : SQLITE_ERROR;
+    tk_thread_destroy(p->thread);
+  }
+
+  *ppOut = p->pOut;
+  sqlite3_free(p);
+
+  return rc;
+}
+
+#endif /* SQLITE_MAX_WORKER_THREADS > 0 && SQLITE_THREADSAFE > 0 */
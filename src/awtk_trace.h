@@ -0,0 +1,378 @@
+#ifndef AWTK_TRACE_H
+#define AWTK_TRACE_H
+/*
+** trace_v2 multiplexer.
+**
+** SQLite keeps a single trace callback per connection, so the profilers of
+** the port (and the application) would replace each other's. Hooks added
+** with sqlite3_awtk_trace_add() share one sqlite3_trace_v2() registration
+** per connection, which also watches SQLITE_TRACE_CLOSE to free its slot.
+**
+** Hooks of a connection are called without a lock: add and remove them on
+** the thread that uses the connection, or while it is idle.
+**
+** SQLite reports SQLITE_TRACE_CLOSE before it checks for unfinalized
+** statements, so the slot is released even when sqlite3_close() then
+** returns SQLITE_BUSY: the hooks of that connection are gone and have to be
+** added again. Events for a connection that no longer owns the slot are
+** ignored, the slot may already serve another connection.
+**
+** Unlike the other modules this one is always compiled: the statement cache
+** (awtk_stmt_cache.h) finalizes its statements from a close hook. It costs
+** SQLITE_AWTK_TRACE_MAX_DB slots of static memory and nothing per statement
+** until a hook is added; mcu-small keeps two slots.
+**
+** When a hook wants SQLITE_TRACE_PROFILE, the multiplexer also notes the
+** start time and the sqlite3_stmt_status() counters of each top-level run
+** at SQLITE_TRACE_STMT, so the PROFILE hooks can read per-run values with
+** _awtk_trace_run_us() and _awtk_trace_run_status() without resetting the
+** statement's counters under each other. The PROFILE time of this SQLite
+** version only has the resolution of the VFS clock.
+**
+** _awtk_trace_normalize() gives the statement shape the profilers aggregate
+** by (awtk_stmt_prof.h, awtk_mem_prof.h).
+*/
+#ifndef SQLITE_AWTK_TRACE_MAX_DB
+#define SQLITE_AWTK_TRACE_MAX_DB 16
+#endif /*SQLITE_AWTK_TRACE_MAX_DB*/
+
+#ifndef SQLITE_AWTK_TRACE_MAX_HOOK
+#define SQLITE_AWTK_TRACE_MAX_HOOK 4
+#endif /*SQLITE_AWTK_TRACE_MAX_HOOK*/
+
+/* statements of one connection between their first step and their end */
+#ifndef SQLITE_AWTK_TRACE_MAX_RUN
+#define SQLITE_AWTK_TRACE_MAX_RUN 4
+#endif /*SQLITE_AWTK_TRACE_MAX_RUN*/
+
+#define AWTK_TRACE_NSTATUS SQLITE_STMTSTATUS_VM_STEP
+
+typedef int (*awtk_trace_cb_t)(unsigned mask, void* ctx, void* p, void* x);
+
+typedef struct _awtk_trace_hook_t {
+  unsigned mask;
+  awtk_trace_cb_t cb;
+  void* ctx;
+} awtk_trace_hook_t;
+
+typedef struct _awtk_trace_run_t {
+  sqlite3_stmt* stmt;
+  uint64_t start_us;
+  int aStatus[AWTK_TRACE_NSTATUS]; /* SQLITE_STMTSTATUS_xxx - 1 at the start */
+} awtk_trace_run_t;
+
+typedef struct _awtk_trace_db_t {
+  sqlite3* db;
+  awtk_trace_hook_t hooks[SQLITE_AWTK_TRACE_MAX_HOOK];
+  awtk_trace_run_t runs[SQLITE_AWTK_TRACE_MAX_RUN];
+} awtk_trace_db_t;
+
+static awtk_trace_db_t _awtk_trace_dbs[SQLITE_AWTK_TRACE_MAX_DB];
+
+/*
+** The run of stmt, on the connection's own thread. create picks a free slot,
+** else the run started longest ago (one that never reported its end).
+*/
+static awtk_trace_run_t* _awtk_trace_run(awtk_trace_db_t* e, sqlite3_stmt* stmt, bool_t create) {
+  int i;
+  awtk_trace_run_t* slot = NULL;
+
+  for (i = 0; i < SQLITE_AWTK_TRACE_MAX_RUN; i++) {
+    awtk_trace_run_t* r = &e->runs[i];
+
+    if (r->stmt == stmt) {
+      return r;
+    } else if (create && (slot == NULL || r->stmt == NULL ||
+                          (slot->stmt != NULL && r->start_us < slot->start_us))) {
+      slot = r;
+    }
+  }
+
+  return slot;
+}
+
+static awtk_trace_run_t* _awtk_trace_run_of(sqlite3_stmt* stmt) {
+  int i;
+  sqlite3* db = sqlite3_db_handle(stmt);
+
+  for (i = 0; i < SQLITE_AWTK_TRACE_MAX_DB; i++) {
+    if (_awtk_trace_dbs[i].db == db) {
+      return _awtk_trace_run(&_awtk_trace_dbs[i], stmt, FALSE);
+    }
+  }
+
+  return NULL;
+}
+
+/* Wall-clock time (us) of the run that is ending, for PROFILE hooks. */
+static sqlite3_int64 _awtk_trace_run_us(sqlite3_stmt* stmt, void* x) {
+  awtk_trace_run_t* r = _awtk_trace_run_of(stmt);
+
+  return r != NULL ? (sqlite3_int64)(time_now_us() - r->start_us) : *(sqlite3_int64*)x / 1000;
+}
+
+/* Counter op (SQLITE_STMTSTATUS_xxx) of the run that is ending, for PROFILE hooks. */
+static int _awtk_trace_run_status(sqlite3_stmt* stmt, int op) {
+  awtk_trace_run_t* r = _awtk_trace_run_of(stmt);
+  int value = sqlite3_stmt_status(stmt, op, 0);
+
+  return r != NULL ? value - r->aStatus[op - 1] : value;
+}
+
+static bool_t _awtk_trace_is_ident(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' ||
+         (c & 0x80) != 0;
+}
+
+/*
+** Copy sql to out with literals and parameters replaced by '?' and
+** whitespace and comments collapsed to one space: the statement shape the
+** profilers aggregate by.
+*/
+static void _awtk_trace_normalize(const char* sql, char* out, int size) {
+  int n = 0;
+  const char* p = sql;
+
+  while (*p != '\0' && n < size - 1) {
+    char c = *p;
+
+    if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || (c == '-' && p[1] == '-')) {
+      if (c == '-') {
+        while (*p != '\0' && *p != '\n') {
+          p++;
+        }
+      } else {
+        p++;
+      }
+      if (n > 0 && out[n - 1] != ' ') {
+        out[n++] = ' ';
+      }
+    } else if (c == '\'' || ((c == 'x' || c == 'X') && p[1] == '\'')) {
+      /* string or blob literal, '' is an escaped quote */
+      p += c == '\'' ? 1 : 2;
+      while (*p != '\0' && !(p[0] == '\'' && p[1] != '\'')) {
+        p += p[0] == '\'' ? 2 : 1;
+      }
+      p += *p != '\0';
+      out[n++] = '?';
+    } else if ((c >= '0' && c <= '9') || (c == '.' && p[1] >= '0' && p[1] <= '9')) {
+      /* numeric literal, hex included */
+      while (_awtk_trace_is_ident(*p) || *p == '.' ||
+             ((*p == '+' || *p == '-') && (p[-1] == 'e' || p[-1] == 'E'))) {
+        p++;
+      }
+      out[n++] = '?';
+    } else if (c == '?' || c == ':' || c == '@' || c == '$') {
+      p++;
+      while (_awtk_trace_is_ident(*p)) {
+        p++;
+      }
+      out[n++] = '?';
+    } else if (_awtk_trace_is_ident(c)) {
+      while (_awtk_trace_is_ident(*p) && n < size - 1) {
+        out[n++] = *p++;
+      }
+    } else if (c == '"' || c == '`' || c == '[') {
+      /* quoted identifier, kept as written */
+      char end = c == '[' ? ']' : c;
+
+      out[n++] = *p++;
+      while (*p != '\0' && *p != end && n < size - 1) {
+        out[n++] = *p++;
+      }
+      if (*p != '\0' && n < size - 1) {
+        out[n++] = *p++;
+      }
+    } else {
+      out[n++] = *p++;
+    }
+  }
+
+  while (n > 0 && out[n - 1] == ' ') {
+    n--;
+  }
+  out[n] = '\0';
+}
+
+static uint32_t _awtk_trace_hash(const char* s) {
+  uint32_t h = 2166136261u;
+
+  while (*s != '\0') {
+    h = (h ^ (uint8_t)*s++) * 16777619u;
+  }
+
+  return h;
+}
+
+static void _awtk_trace_run_begin(awtk_trace_db_t* e, sqlite3_stmt* stmt) {
+  int i;
+  awtk_trace_run_t* r = _awtk_trace_run(e, stmt, TRUE);
+
+  r->stmt = stmt;
+  r->start_us = time_now_us();
+  for (i = 0; i < AWTK_TRACE_NSTATUS; i++) {
+    r->aStatus[i] = sqlite3_stmt_status(stmt, i + 1, 0);
+  }
+}
+
+static int _awtk_trace_dispatch(unsigned mask, void* ctx, void* p, void* x) {
+  int i;
+  awtk_trace_db_t* e = (awtk_trace_db_t*)ctx;
+  sqlite3* db = mask == SQLITE_TRACE_CLOSE ? (sqlite3*)p : sqlite3_db_handle((sqlite3_stmt*)p);
+
+  /* released by a close that returned SQLITE_BUSY */
+  if (e->db != db) {
+    return 0;
+  }
+
+  /* statements inside triggers report "-- ..." and belong to the outer one */
+  if (mask == SQLITE_TRACE_STMT && (((const char*)x)[0] != '-' || ((const char*)x)[1] != '-')) {
+    _awtk_trace_run_begin(e, (sqlite3_stmt*)p);
+  }
+
+  for (i = 0; i < SQLITE_AWTK_TRACE_MAX_HOOK; i++) {
+    awtk_trace_hook_t* h = &e->hooks[i];
+
+    if (h->cb != NULL && (h->mask & mask) != 0) {
+      h->cb(mask, h->ctx, p, x);
+    }
+  }
+
+  if (mask == SQLITE_TRACE_PROFILE) {
+    awtk_trace_run_t* r = _awtk_trace_run(e, (sqlite3_stmt*)p, FALSE);
+
+    if (r != NULL) {
+      r->stmt = NULL;
+    }
+  }
+
+  if (mask == SQLITE_TRACE_CLOSE) {
+    sqlite3_mutex* mutex = sqlite3_mutex_alloc(SQLITE_MUTEX_STATIC_VFS1);
+
+    sqlite3_mutex_enter(mutex);
+    memset(e, 0x00, sizeof(*e));
+    sqlite3_mutex_leave(mutex);
+  }
+
+  return 0;
+}
+
+/*
+** Called with the VFS1 mutex held. Returns the mask to register, 0 when the
+** connection has no hooks left (its slot is then released).
+*/
+static unsigned _awtk_trace_mask(awtk_trace_db_t* e) {
+  int i;
+  unsigned mask = 0;
+
+  for (i = 0; i < SQLITE_AWTK_TRACE_MAX_HOOK; i++) {
+    if (e->hooks[i].cb != NULL) {
+      mask |= e->hooks[i].mask;
+    }
+  }
+
+  if (mask == 0) {
+    memset(e, 0x00, sizeof(*e));
+    return 0;
+  }
+
+  /* runs are timed from their first step */
+  if (mask & SQLITE_TRACE_PROFILE) {
+    mask |= SQLITE_TRACE_STMT;
+  }
+
+  return mask | SQLITE_TRACE_CLOSE;
+}
+
+SQLITE_API int sqlite3_awtk_trace_add(sqlite3* db, unsigned mask,
+                                      int (*xCallback)(unsigned, void*, void*, void*),
+                                      void* pCtx) {
+  int i;
+  awtk_trace_db_t* e = NULL;
+  awtk_trace_db_t* empty = NULL;
+  awtk_trace_hook_t* hook = NULL;
+  sqlite3_mutex* mutex = sqlite3_mutex_alloc(SQLITE_MUTEX_STATIC_VFS1);
+
+  if (db == NULL || xCallback == NULL || mask == 0) {
+    return SQLITE_MISUSE;
+  }
+
+  sqlite3_mutex_enter(mutex);
+  for (i = 0; i < SQLITE_AWTK_TRACE_MAX_DB && e == NULL; i++) {
+    if (_awtk_trace_dbs[i].db == db) {
+      e = &_awtk_trace_dbs[i];
+    } else if (_awtk_trace_dbs[i].db == NULL && empty == NULL) {
+      empty = &_awtk_trace_dbs[i];
+    }
+  }
+
+  if (e == NULL && empty != NULL) {
+    e = empty;
+    e->db = db;
+  }
+
+  /* adding a hook again only changes its mask */
+  for (i = 0; e != NULL && i < SQLITE_AWTK_TRACE_MAX_HOOK; i++) {
+    awtk_trace_hook_t* h = &e->hooks[i];
+
+    if (h->cb == xCallback && h->ctx == pCtx) {
+      hook = h;
+      break;
+    } else if (h->cb == NULL && hook == NULL) {
+      hook = h;
+    }
+  }
+
+  if (hook == NULL) {
+    if (e != NULL) {
+      _awtk_trace_mask(e);
+    }
+    sqlite3_mutex_leave(mutex);
+    return SQLITE_FULL;
+  }
+
+  hook->mask = mask;
+  hook->cb = xCallback;
+  hook->ctx = pCtx;
+  mask = _awtk_trace_mask(e);
+  sqlite3_mutex_leave(mutex);
+
+  /* outside the VFS1 mutex: close runs the dispatcher with the db mutex held */
+  return sqlite3_trace_v2(db, mask, _awtk_trace_dispatch, e);
+}
+
+SQLITE_API int sqlite3_awtk_trace_remove(sqlite3* db,
+                                         int (*xCallback)(unsigned, void*, void*, void*),
+                                         void* pCtx) {
+  int i, j;
+  unsigned mask = 0;
+  awtk_trace_db_t* e = NULL;
+  sqlite3_mutex* mutex = sqlite3_mutex_alloc(SQLITE_MUTEX_STATIC_VFS1);
+
+  sqlite3_mutex_enter(mutex);
+  for (i = 0; i < SQLITE_AWTK_TRACE_MAX_DB && e == NULL; i++) {
+    if (db != NULL && _awtk_trace_dbs[i].db == db) {
+      e = &_awtk_trace_dbs[i];
+    }
+  }
+
+  if (e == NULL) {
+    sqlite3_mutex_leave(mutex);
+    return SQLITE_NOTFOUND;
+  }
+
+  for (j = 0; j < SQLITE_AWTK_TRACE_MAX_HOOK; j++) {
+    awtk_trace_hook_t* h = &e->hooks[j];
+
+    if (h->cb == xCallback && h->ctx == pCtx) {
+      memset(h, 0x00, sizeof(*h));
+    }
+  }
+  mask = _awtk_trace_mask(e);
+  sqlite3_mutex_leave(mutex);
+
+  return mask ? sqlite3_trace_v2(db, mask, _awtk_trace_dispatch, e)
+              : sqlite3_trace_v2(db, 0, NULL, NULL);
+}
+
+#endif /*AWTK_TRACE_H*/
@@ -128,6 +128,11 @@ typedef struct {
   int eFileLock;
   int szChunk;
   tk_semaphore_t* sem;
+  struct _awtk_vfs_lock_t* lock; /* Owner of sem, shared by handles of the path */
+#ifdef SQLITE_AWTK_ENABLE_COMMIT_TIMING
+  void* commit;      /* Commit timing of the main database, see awtk_commit_timing.h */
+  bool_t is_journal; /* Main journal of that database */
+#endif /*SQLITE_AWTK_ENABLE_COMMIT_TIMING*/
 } AWTK_SQLITE_FILE_T;
 
 static const char* _awtk_temp_file_dir(void) {
@@ -193,7 +198,109 @@ static int _awtk_get_temp_name(int nBuf, char* zBuf) {
   return SQLITE_OK;
 }
 
+/*
+** Handles of the same path share one lock semaphore, so connections that
+** open one database exclude each other as SQLite expects (every lock at or
+** above SHARED is exclusive, see _awtk_io_lock()). A semaphore per handle
+** let two writers change the same file at the same time.
+**
+** The list is guarded by SQLITE_MUTEX_STATIC_VFS1, held only around the
+** list itself (the unix VFS keeps its inode list under the same mutex).
+*/
+typedef struct _awtk_vfs_lock_t {
+  struct _awtk_vfs_lock_t* next;
+  tk_semaphore_t* sem;
+  int nRef;
+  char path[1];
+} awtk_vfs_lock_t;
+
+static awtk_vfs_lock_t* _awtk_vfs_locks;
+
+static awtk_vfs_lock_t* _awtk_vfs_lock_get(const char* file_path) {
+  int size = sizeof(awtk_vfs_lock_t) + (int)strlen(file_path);
+  awtk_vfs_lock_t* lock = NULL;
+  awtk_vfs_lock_t* fresh = NULL;
+  sqlite3_mutex* mutex = sqlite3_mutex_alloc(SQLITE_MUTEX_STATIC_VFS1);
+
+  /* allocated up front, not under the mutex */
+  fresh = (awtk_vfs_lock_t*)sqlite3_malloc(size);
+  if (fresh == NULL) {
+    return NULL;
+  }
+
+  sqlite3_mutex_enter(mutex);
+  for (lock = _awtk_vfs_locks; lock != NULL; lock = lock->next) {
+    if (strcmp(lock->path, file_path) == 0) {
+      lock->nRef++;
+      break;
+    }
+  }
+  sqlite3_mutex_leave(mutex);
+
+  if (lock != NULL) {
+    sqlite3_free(fresh);
+    return lock;
+  }
+
+  memset(fresh, 0, size);
+  strcpy(fresh->path, file_path);
+  fresh->nRef = 1;
+  fresh->sem = tk_semaphore_create(1, "vfssem");
+  if (fresh->sem == NULL) {
+    sqlite3_free(fresh);
+    return NULL;
+  }
+
+  /* another handle of the path may have won the race meanwhile */
+  sqlite3_mutex_enter(mutex);
+  for (lock = _awtk_vfs_locks; lock != NULL; lock = lock->next) {
+    if (strcmp(lock->path, file_path) == 0) {
+      lock->nRef++;
+      break;
+    }
+  }
+  if (lock == NULL) {
+    fresh->next = _awtk_vfs_locks;
+    _awtk_vfs_locks = fresh;
+  }
+  sqlite3_mutex_leave(mutex);
+
+  if (lock != NULL) {
+    tk_semaphore_destroy(fresh->sem);
+    sqlite3_free(fresh);
+    return lock;
+  }
+
+  return fresh;
+}
+
+static void _awtk_vfs_lock_put(awtk_vfs_lock_t* lock) {
+  awtk_vfs_lock_t** pp = NULL;
+  sqlite3_mutex* mutex = sqlite3_mutex_alloc(SQLITE_MUTEX_STATIC_VFS1);
+
+  sqlite3_mutex_enter(mutex);
+  if (--lock->nRef > 0) {
+    lock = NULL;
+  } else {
+    for (pp = &_awtk_vfs_locks; *pp != NULL; pp = &(*pp)->next) {
+      if (*pp == lock) {
+        *pp = lock->next;
+        break;
+      }
+    }
+  }
+  sqlite3_mutex_leave(mutex);
+
+  if (lock != NULL) {
+    tk_semaphore_destroy(lock->sem);
+    sqlite3_free(lock);
+  }
+}
+
 #include "awtk_io_methods.h"
+#include "awtk_commit_timing.h"
+#include "awtk_chrome_trace.h"
+#include "awtk_probes.h"
 
 /*
 ** Invoke open().  Do so multiple times, until it either succeeds or
@@ -297,6 +404,7 @@ static int _awtk_vfs_open(sqlite3_vfs* pvfs, const char* file_path, sqlite3_file
       return rc;
     }
     file_path = zTmpname;
+    AWTK_PROBE2(temp_create, file_path, flags);
 
     /* Generated temporary filenames are always double-zero terminated
         ** for use by sqlite3_uri_parameter(). */
@@ -330,6 +438,12 @@ static int _awtk_vfs_open(sqlite3_vfs* pvfs, const char* file_path, sqlite3_file
     return rc;
   }
 
+  p->lock = _awtk_vfs_lock_get(file_path);
+  if (p->lock == NULL) {
+    fs_file_close(fd);
+    return SQLITE_NOMEM;
+  }
+
   if (pOutFlags) {
     *pOutFlags = flags;
   }
@@ -339,11 +453,12 @@ static int _awtk_vfs_open(sqlite3_vfs* pvfs, const char* file_path, sqlite3_file
   }
 
   p->fd = fd;
-  p->pMethod = &_awtk_io_method;
+  p->pMethod = &AWTK_IO_METHOD;
   p->eFileLock = NO_LOCK;
   p->szChunk = 0;
   p->pvfs = pvfs;
-  p->sem = tk_semaphore_create(1, "vfssem");
+  p->sem = p->lock->sem;
+  AWTK_COMMIT_OPEN(p, file_path, flags);
 
   return rc;
 }
@@ -465,8 +580,11 @@ static int _awtk_vfs_randomness(sqlite3_vfs* pvfs, int nByte, char* zOut) {
 
 static int _awtk_vfs_sleep(sqlite3_vfs* pvfs, int microseconds) {
   int millisecond = (microseconds + 999) / 1000;
+  AWTK_CTRACE_START(start);
 
-  sleep_ms(microseconds);
+  AWTK_PROBE2(busy_sleep, microseconds, millisecond * 1000);
+  sleep_ms(millisecond);
+  AWTK_CTRACE_END(AWTK_CTRACE_BUSY_SLEEP, start, millisecond * 1000, microseconds, SQLITE_OK);
 
   return millisecond * 1000;
 }
@@ -508,6 +626,21 @@ static const char* _awtk_vfs_next_system_call(sqlite3_vfs* pvfs, const char* fil
   return 0;
 }
 
+#include "awtk_trace.h"
+#include "awtk_mem_pool.h"
+#include "awtk_mem_prof.h"
+#include "awtk_arena.h"
+#include "awtk_pcache.h"
+#include "awtk_low_memory.h"
+#include "awtk_thread_db.h"
+#include "awtk_boot_prof.h"
+#include "awtk_stmt_prof.h"
+#include "awtk_log_file.h"
+#include "awtk_slow_log.h"
+#include "awtk_scanstatus.h"
+#include "awtk_status_log.h"
+#include "awtk_stmt_cache.h"
+
 /*
 ** Initialize and deinitialize the operating system interface.
 */
@@ -520,7 +653,7 @@ SQLITE_API int sqlite3_os_init(void) {
       "awtk",                       /* zName */
       0,                            /* pAppData */
       _awtk_vfs_open,               /* xOpen */
-      _awtk_vfs_delete,             /* xDelete */
+      AWTK_VFS_DELETE,              /* xDelete */
       _awtk_vfs_access,             /* xAccess */
       _awtk_vfs_fullpathname,       /* xFullPathname */
       0,                            /* xDlOpen */
@@ -536,15 +669,28 @@ SQLITE_API int sqlite3_os_init(void) {
       _awtk_vfs_get_system_call,    /* xGetSystemCall */
       _awtk_vfs_next_system_call,   /* xNextSystemCall */
   };
+  AWTK_BOOT_BEGIN();
+
+  if (_awtk_stmt_cache_init() != SQLITE_OK) {
+    return SQLITE_NOMEM;
+  }
 
   sqlite3_vfs_register(&_awtk_vfs, 1);
+  AWTK_BOOT_END(SQLITE_AWTK_BOOT_OS_INIT);
 
-  sqlite3MemSetDefault();
+  /*
+  ** Do not call sqlite3MemSetDefault() here: sqlite3_initialize() has already
+  ** set up the allocator (the default one, or the methods passed with
+  ** SQLITE_CONFIG_MALLOC such as sqlite3_awtk_mem_pool_install()), and
+  ** replacing it now would free blocks with the wrong allocator.
+  */
 
   return SQLITE_OK;
 }
 
 SQLITE_API int sqlite3_os_end(void) {
+  _awtk_stmt_cache_deinit();
+
   return SQLITE_OK;
 }
 
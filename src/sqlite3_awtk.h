@@ -0,0 +1,517 @@
+/*
+** Extensions of the AWTK port of SQLite.
+**
+** These functions are implemented in sqlite3.c, next to the awtk mutex
+** (awtk_mutex.h) and VFS (awtk_vfs.h) layers.
+*/
+#ifndef _SQLITE3_AWTK_H_
+#define _SQLITE3_AWTK_H_
+#include "sqlite3.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+** Mutex implementations, see sqlite3_awtk_mutex_set_kind().
+**
+** SQLITE_AWTK_MUTEX_PLAIN    tk_mutex_t.
+** SQLITE_AWTK_MUTEX_NEST     tk_mutex_nest_t, the only recursive kind.
+** SQLITE_AWTK_MUTEX_ADAPTIVE atomic lock word, spins before sleeping. Meant
+**                            for mutexes held very briefly by many threads.
+*/
+#define SQLITE_AWTK_MUTEX_PLAIN 1
+#define SQLITE_AWTK_MUTEX_NEST 2
+#define SQLITE_AWTK_MUTEX_ADAPTIVE 3
+
+/*
+** Choose the implementation of mutex type "id" (SQLITE_MUTEX_FAST,
+** SQLITE_MUTEX_STATIC_xxx...). SQLITE_MUTEX_RECURSIVE only accepts
+** SQLITE_AWTK_MUTEX_NEST. Static mutexes can only be changed while SQLite is
+** not initialized, otherwise SQLITE_MISUSE is returned.
+*/
+SQLITE_API int sqlite3_awtk_mutex_set_kind(int id, int kind);
+SQLITE_API int sqlite3_awtk_mutex_get_kind(int id);
+
+#ifdef SQLITE_AWTK_MUTEX_STATS
+/*
+** Contention statistics of the awtk mutex layer, only compiled in when
+** SQLITE_AWTK_MUTEX_STATS is defined. Static mutexes are reported per id,
+** dynamic ones are aggregated under SQLITE_MUTEX_FAST and
+** SQLITE_MUTEX_RECURSIVE. Times are in microseconds; the hold time of a
+** recursive mutex covers the outermost enter/leave pair.
+*/
+typedef struct sqlite3_awtk_mutex_stats sqlite3_awtk_mutex_stats;
+struct sqlite3_awtk_mutex_stats {
+  sqlite3_uint64 nAcquire;   /* Successful enters and try-locks */
+  sqlite3_uint64 nContended; /* Enters that found the mutex held */
+  sqlite3_uint64 nWaitUs;    /* Total time spent waiting */
+  sqlite3_uint64 mxWaitUs;   /* Longest single wait */
+  sqlite3_uint64 nHoldUs;    /* Total time the mutex was held */
+  sqlite3_uint64 mxHoldUs;   /* Longest single hold */
+};
+
+SQLITE_API int sqlite3_awtk_mutex_stats_get(int id, sqlite3_awtk_mutex_stats* pStats);
+SQLITE_API void sqlite3_awtk_mutex_stats_reset(void);
+SQLITE_API void sqlite3_awtk_mutex_stats_dump(void);
+#endif /* SQLITE_AWTK_MUTEX_STATS */
+
+/*
+** Trace hooks (awtk_trace.h). SQLite keeps one sqlite3_trace_v2() callback
+** per connection; hooks added here share it, so the profilers of the port
+** and the application can trace the same connection. Adding the same
+** xCallback/pCtx pair again changes its mask. SQLITE_FULL is returned when
+** SQLITE_AWTK_TRACE_MAX_DB connections or SQLITE_AWTK_TRACE_MAX_HOOK hooks
+** per connection are in use. Do not call sqlite3_trace_v2() directly on a
+** connection that has hooks.
+*/
+SQLITE_API int sqlite3_awtk_trace_add(sqlite3* db, unsigned mask,
+                                      int (*xCallback)(unsigned, void*, void*, void*),
+                                      void* pCtx);
+SQLITE_API int sqlite3_awtk_trace_remove(sqlite3* db,
+                                         int (*xCallback)(unsigned, void*, void*, void*),
+                                         void* pCtx);
+
+/*
+** Prepared statement cache (awtk_stmt_cache.h), an LRU of at most
+** SQLITE_AWTK_STMT_CACHE_MAX statements per connection, keyed by SQL text.
+**
+** sqlite3_awtk_prepare_cached() returns a reset statement without bindings,
+** prepared again when a schema change on the connection expired it. Hand
+** it back with sqlite3_awtk_stmt_release(), never sqlite3_finalize(); the
+** release returns what sqlite3_reset() returns. Statements that can not be
+** cached (SQL already in use, several statements in zSql, a cache full of
+** statements in use, more than SQLITE_AWTK_STMT_CACHE_MAX_DB connections)
+** are finalized by the release. Idle statements are finalized when the
+** connection is closed; the cache uses a close hook of
+** sqlite3_awtk_trace_add().
+**
+** sqlite3_awtk_stmt_cache_set_max() changes the capacity of a connection,
+** 0 disables its cache. sqlite3_awtk_stmt_cache_clear() finalizes the idle
+** statements and drops the cache with its counters. The hit rate is
+** nHit / (nHit + nMiss).
+*/
+typedef struct sqlite3_awtk_stmt_cache_stats sqlite3_awtk_stmt_cache_stats;
+struct sqlite3_awtk_stmt_cache_stats {
+  int nCached;               /* Statements in the cache, idle or in use */
+  int nMax;                  /* Capacity of the connection's cache */
+  sqlite3_int64 nHit;        /* Statements served without preparing */
+  sqlite3_int64 nMiss;       /* Statements prepared */
+  sqlite3_int64 nUncached;   /* Misses that could not be cached */
+  sqlite3_int64 nEvict;      /* Least recently used statements finalized */
+  sqlite3_int64 nInvalidate; /* Statements expired by a schema change */
+};
+
+SQLITE_API int sqlite3_awtk_prepare_cached(sqlite3* db, const char* zSql, sqlite3_stmt** ppStmt);
+SQLITE_API int sqlite3_awtk_stmt_release(sqlite3_stmt* pStmt);
+SQLITE_API int sqlite3_awtk_stmt_cache_set_max(sqlite3* db, int nMax);
+SQLITE_API int sqlite3_awtk_stmt_cache_clear(sqlite3* db);
+SQLITE_API int sqlite3_awtk_stmt_cache_stats_get(sqlite3* db, sqlite3_awtk_stmt_cache_stats* pStats,
+                                                 int resetFlag);
+
+#ifdef SQLITE_AWTK_ENABLE_MEM_POOL
+/*
+** Size-class allocator on top of the AWTK heap (awtk_mem_pool.h).
+**
+** sqlite3_awtk_mem_pool_install() must be called before sqlite3_initialize().
+** nInUse counts whole blocks, nRequested what SQLite asked for, so
+** 1 - nRequested/nReserved is the share of reserved memory that is wasted
+** (rounding up to a class plus free blocks kept in the pool).
+**
+** Freed blocks stay in the pool. sqlite3_awtk_mem_pool_release() returns the
+** slabs without a live block to the AWTK heap and the number of bytes it
+** freed; sqlite3_release_memory() cannot reach the pool, so the low memory
+** handler (SQLITE_AWTK_ENABLE_LOW_MEMORY) calls it after releasing the caches.
+*/
+typedef struct sqlite3_awtk_mem_pool_stats sqlite3_awtk_mem_pool_stats;
+struct sqlite3_awtk_mem_pool_stats {
+  sqlite3_uint64 nReserved;  /* Bytes taken from the AWTK heap */
+  sqlite3_uint64 nInUse;     /* Bytes of blocks handed out */
+  sqlite3_uint64 nRequested; /* Bytes requested by SQLite */
+  sqlite3_uint64 nMalloc;    /* Pool allocations since install */
+  sqlite3_uint64 nLarge;     /* Live blocks too big for the pool */
+};
+
+SQLITE_API int sqlite3_awtk_mem_pool_install(void);
+SQLITE_API sqlite3_int64 sqlite3_awtk_mem_pool_release(void);
+SQLITE_API void sqlite3_awtk_mem_pool_stats_get(sqlite3_awtk_mem_pool_stats* pStats);
+SQLITE_API void sqlite3_awtk_mem_pool_dump(void);
+#endif /* SQLITE_AWTK_ENABLE_MEM_POOL */
+
+#ifdef SQLITE_ENABLE_MEMSYS5
+/*
+** Static-arena memory mode (awtk_arena.h): memsys5 heap, page cache slots
+** and per-connection lookaside, all carved from one block of RAM.
+**
+** Call sqlite3_awtk_arena_init() before sqlite3_initialize(); pConfig may be
+** NULL for the defaults {50, 35, SQLITE_DEFAULT_PAGE_SIZE, 4, 128}. The part
+** left by nHeapPct and nPageCachePct is split evenly into nConn lookaside
+** slices. sqlite3_awtk_arena_attach() hands a slice to a freshly opened
+** connection (SQLITE_FULL when all are taken); close such connections with
+** sqlite3_awtk_arena_close(). sqlite3_awtk_arena_init() returns SQLITE_NOMEM,
+** and configures nothing, when the heap share would be smaller than
+** SQLITE_AWTK_ARENA_MIN_HEAP (16 KB) once the connection table is taken.
+**
+** Run a representative workload, then read the high-water marks with
+** sqlite3_awtk_arena_report_get() or sqlite3_awtk_arena_dump() to size the
+** arena for the device. The heap marks need memory statistics, so
+** sqlite3_awtk_arena_init() turns SQLITE_CONFIG_MEMSTATUS on.
+*/
+typedef struct sqlite3_awtk_arena_config sqlite3_awtk_arena_config;
+struct sqlite3_awtk_arena_config {
+  int nHeapPct;      /* Share of the arena for the memsys5 heap */
+  int nPageCachePct; /* Share of the arena for SQLITE_CONFIG_PAGECACHE */
+  int szPage;        /* Database page size the slots are sized for */
+  int nConn;         /* Connections with a dedicated lookaside slice */
+  int szLookaside;   /* Size of one lookaside slot */
+};
+
+typedef struct sqlite3_awtk_arena_report sqlite3_awtk_arena_report;
+struct sqlite3_awtk_arena_report {
+  sqlite3_int64 nHeap;              /* Bytes given to memsys5 */
+  sqlite3_int64 mxHeapUsed;         /* Peak of SQLITE_STATUS_MEMORY_USED */
+  sqlite3_int64 mxMalloc;           /* Largest single request */
+  int nPageSlot;                    /* Page cache slots */
+  int szPageSlot;                   /* Bytes per page cache slot */
+  sqlite3_int64 mxPageSlotUsed;     /* Peak of page cache slots in use */
+  sqlite3_int64 mxPageOverflow;     /* Peak bytes of pages that fell back to the heap */
+  int nLookaside;                   /* Lookaside slots per connection */
+  int szLookaside;                  /* Bytes per lookaside slot */
+  sqlite3_int64 mxLookasideUsed;    /* Peak slots used by any one connection */
+  sqlite3_int64 nLookasideMissFull; /* Allocations refused because lookaside was full */
+};
+
+SQLITE_API int sqlite3_awtk_arena_init(void* pArena, int nArena,
+                                       const sqlite3_awtk_arena_config* pConfig);
+SQLITE_API int sqlite3_awtk_arena_attach(sqlite3* db);
+SQLITE_API int sqlite3_awtk_arena_close(sqlite3* db);
+SQLITE_API void sqlite3_awtk_arena_report_get(sqlite3_awtk_arena_report* pReport);
+SQLITE_API void sqlite3_awtk_arena_dump(void);
+#endif /* SQLITE_ENABLE_MEMSYS5 */
+
+#ifdef SQLITE_AWTK_ENABLE_PCACHE
+/*
+** Page cache (awtk_pcache.h): pages in contiguous chunks, CLOCK eviction.
+**
+** Call sqlite3_awtk_pcache_install() before sqlite3_initialize(). With
+** nSharedMax 0 each connection keeps its own PRAGMA cache_size. Otherwise
+** all connections together allocate at most nSharedMax page slots; a
+** connection that needs more takes pages (and their memory) from the cache
+** that fetched least recently, never taking one below nMinPerCache pages.
+*/
+typedef struct sqlite3_awtk_pcache_stats sqlite3_awtk_pcache_stats;
+struct sqlite3_awtk_pcache_stats {
+  sqlite3_int64 nHit;   /* Fetches that found the page */
+  sqlite3_int64 nMiss;  /* Fetches that did not */
+  sqlite3_int64 nEvict; /* Pages a cache recycled from itself */
+  sqlite3_int64 nSteal; /* Pages taken from another cache under the shared budget */
+  sqlite3_int64 nPage;  /* Pages currently held by purgeable caches */
+  sqlite3_int64 nChunk; /* Chunks currently allocated */
+};
+
+SQLITE_API int sqlite3_awtk_pcache_install(int nSharedMax, int nMinPerCache);
+SQLITE_API void sqlite3_awtk_pcache_stats_get(sqlite3_awtk_pcache_stats* pStats, int resetFlag);
+SQLITE_API void sqlite3_awtk_pcache_dump(void);
+#endif /* SQLITE_AWTK_ENABLE_PCACHE */
+
+#ifdef SQLITE_AWTK_ENABLE_LOW_MEMORY
+/*
+** Low-memory integration (awtk_low_memory.h).
+**
+** sqlite3_awtk_low_memory_init() subscribes to EVT_LOW_MEMORY on the window
+** manager. On each event, or on sqlite3_awtk_low_memory_trigger() from any
+** thread, the registered connections release their cached pages and the
+** soft heap limit drops to nPressureLimit (0: the usage left after the
+** release) for nCooldownMs milliseconds; the limit is left alone when memory
+** statistics are off (SQLITE_DEFAULT_MEMSTATUS 0). At most
+** SQLITE_AWTK_LOW_MEMORY_MAX_DB connections can be registered; unregister a
+** connection before closing it, without holding its mutex.
+*/
+typedef struct sqlite3_awtk_low_memory_stats sqlite3_awtk_low_memory_stats;
+struct sqlite3_awtk_low_memory_stats {
+  sqlite3_int64 nEvent;         /* Low-memory events handled */
+  sqlite3_int64 nRecovered;     /* Bytes released by all events */
+  sqlite3_int64 nLastRecovered; /* Bytes released by the last event */
+  sqlite3_int64 mxRecovered;    /* Most bytes released by one event */
+  sqlite3_int64 nLastUsed;      /* Bytes SQLite still used after the last event */
+  int nDb;                      /* Registered connections */
+  int bLimited;                 /* Soft heap limit lowered, cool-down running */
+};
+
+SQLITE_API int sqlite3_awtk_low_memory_init(sqlite3_int64 nPressureLimit, int nCooldownMs);
+SQLITE_API void sqlite3_awtk_low_memory_deinit(void);
+SQLITE_API int sqlite3_awtk_low_memory_register(sqlite3* db);
+SQLITE_API int sqlite3_awtk_low_memory_unregister(sqlite3* db);
+SQLITE_API sqlite3_int64 sqlite3_awtk_low_memory_trigger(void);
+SQLITE_API void sqlite3_awtk_low_memory_stats_get(sqlite3_awtk_low_memory_stats* pStats);
+#endif /* SQLITE_AWTK_ENABLE_LOW_MEMORY */
+
+#ifdef SQLITE_AWTK_ENABLE_MEM_PROF
+/*
+** Allocation profiler (awtk_mem_prof.h).
+**
+** sqlite3_awtk_mem_prof_install() wraps the allocator configured so far;
+** call it last, before sqlite3_initialize(). Allocations are charged to the
+** calling thread's tag: the normalized SQL of the statement being stepped
+** on a connection passed to sqlite3_awtk_mem_prof_attach() (a trace hook,
+** see sqlite3_awtk_trace_add()), else the name given to
+** sqlite3_awtk_mem_prof_tag_begin(), else "(untagged)". Statements and tags
+** nest per thread: when the inner one ends the outer one is charged again,
+** and sqlite3_awtk_mem_prof_tag_end() ends the innermost open tag.
+**
+** A run is one execution of a statement, or one tag_begin/tag_end pair;
+** nLastRunPeak and mxRunPeak are the most memory that run held on top of
+** what the tag already had live when it started.
+*/
+typedef struct sqlite3_awtk_mem_prof_tag sqlite3_awtk_mem_prof_tag;
+struct sqlite3_awtk_mem_prof_tag {
+  const char* zName;          /* Tag or normalized SQL, SQLITE_AWTK_MEM_PROF_TAG_LEN - 1 bytes */
+  sqlite3_int64 nLive;        /* Bytes currently allocated */
+  sqlite3_int64 mxLive;       /* Peak of nLive */
+  sqlite3_int64 nAlloc;       /* Allocations since install or reset */
+  sqlite3_int64 nBytes;       /* Bytes allocated since install or reset */
+  sqlite3_int64 nAllocPerSec; /* nAlloc over the time since install or reset */
+  sqlite3_int64 nRun;         /* Finished runs */
+  sqlite3_int64 nLastRunPeak; /* Peak growth of the last run */
+  sqlite3_int64 mxRunPeak;    /* Peak growth of the heaviest run */
+};
+
+SQLITE_API int sqlite3_awtk_mem_prof_install(void);
+SQLITE_API int sqlite3_awtk_mem_prof_attach(sqlite3* db);
+SQLITE_API int sqlite3_awtk_mem_prof_tag_begin(const char* zTag);
+SQLITE_API void sqlite3_awtk_mem_prof_tag_end(int iPrev);
+SQLITE_API int sqlite3_awtk_mem_prof_tag_get(int iTag, sqlite3_awtk_mem_prof_tag* pTag);
+SQLITE_API void sqlite3_awtk_mem_prof_reset(void);
+SQLITE_API void sqlite3_awtk_mem_prof_dump(int nTop);
+#endif /* SQLITE_AWTK_ENABLE_MEM_PROF */
+
+#ifdef SQLITE_AWTK_ENABLE_THREAD_DB
+/*
+** Per-thread connections (awtk_thread_db.h) for the multi-thread profile.
+**
+** sqlite3_awtk_thread_db() returns the calling thread's connection to
+** zFilename, opening it with flags (0: READWRITE|CREATE) on first use.
+** sqlite3_awtk_thread_db_close() closes the calling thread's connections.
+** In SQLITE_DEBUG builds, or with SQLITE_AWTK_THREAD_DB_CHECK, statements
+** started on another thread are logged and counted, see
+** sqlite3_awtk_thread_db_violations(). The check is a trace hook, see
+** sqlite3_awtk_trace_add().
+*/
+SQLITE_API int sqlite3_awtk_thread_db(const char* zFilename, int flags, sqlite3** ppDb);
+SQLITE_API int sqlite3_awtk_thread_db_close(void);
+SQLITE_API sqlite3_int64 sqlite3_awtk_thread_db_violations(void);
+#endif /* SQLITE_AWTK_ENABLE_THREAD_DB */
+
+#ifdef SQLITE_AWTK_ENABLE_BOOT_PROF
+/*
+** Boot-time phases (awtk_boot_prof.h), in microseconds of their last run.
+**
+** SQLITE_AWTK_BOOT_MUTEX_INIT static mutexes of the awtk mutex layer.
+** SQLITE_AWTK_BOOT_OS_INIT    sqlite3_os_init(), the VFS registration.
+** SQLITE_AWTK_BOOT_OPEN       sqlite3_open_v2() in sqlite3_awtk_boot_open().
+** SQLITE_AWTK_BOOT_SCHEMA     reading and parsing sqlite_master after it.
+**
+** sqlite3_awtk_boot_open() is sqlite3_open_v2() (flags 0: READWRITE|CREATE)
+** followed by a schema load, so the cost of the schema is known at boot and
+** not paid by the first statement. sqlite3_awtk_boot_get() returns -1 for
+** an unknown phase.
+*/
+#define SQLITE_AWTK_BOOT_MUTEX_INIT 0
+#define SQLITE_AWTK_BOOT_OS_INIT 1
+#define SQLITE_AWTK_BOOT_OPEN 2
+#define SQLITE_AWTK_BOOT_SCHEMA 3
+#define SQLITE_AWTK_BOOT_N 4
+
+SQLITE_API int sqlite3_awtk_boot_open(const char* zFilename, int flags, const char* zVfs,
+                                      sqlite3** ppDb);
+SQLITE_API sqlite3_int64 sqlite3_awtk_boot_get(int iPhase);
+SQLITE_API void sqlite3_awtk_boot_dump(void);
+#endif /* SQLITE_AWTK_ENABLE_BOOT_PROF */
+
+#ifdef SQLITE_AWTK_ENABLE_STMT_PROF
+/*
+** Statement profiler (awtk_stmt_prof.h).
+**
+** Statements run on connections passed to sqlite3_awtk_stmt_prof_attach()
+** are aggregated by normalized SQL (literals and parameters shown as "?").
+** Bucket i of aHist counts runs of at most 2^i us, the last bucket the
+** longer ones. At most SQLITE_AWTK_STMT_PROF_MAX shapes are kept, the least
+** recently run is dropped first. sqlite3_awtk_stmt_prof_init(nIntervalMs)
+** logs the top statements every nIntervalMs from an AWTK timer (0: never).
+** sqlite3_awtk_stmt_prof_get() copies the normalized SQL of entry iEntry
+** into zSql (nSql bytes, NUL terminated; zSql may be NULL), the entry can be
+** dropped or reused as soon as it returns.
+*/
+#define SQLITE_AWTK_STMT_PROF_BUCKETS 16
+
+typedef struct sqlite3_awtk_stmt_prof_entry sqlite3_awtk_stmt_prof_entry;
+struct sqlite3_awtk_stmt_prof_entry {
+  sqlite3_int64 nRun;      /* Finished runs */
+  sqlite3_int64 nTotalUs;  /* Wall-clock time of all runs */
+  sqlite3_int64 mxUs;      /* Slowest run */
+  sqlite3_int64 nStep;     /* VM steps of all runs */
+  /* Runs by log2 of their time in us */
+  sqlite3_int64 aHist[SQLITE_AWTK_STMT_PROF_BUCKETS];
+};
+
+SQLITE_API int sqlite3_awtk_stmt_prof_init(int nIntervalMs);
+SQLITE_API void sqlite3_awtk_stmt_prof_deinit(void);
+SQLITE_API int sqlite3_awtk_stmt_prof_attach(sqlite3* db);
+SQLITE_API int sqlite3_awtk_stmt_prof_detach(sqlite3* db);
+SQLITE_API int sqlite3_awtk_stmt_prof_get(int iEntry, sqlite3_awtk_stmt_prof_entry* pEntry,
+                                          char* zSql, int nSql);
+SQLITE_API void sqlite3_awtk_stmt_prof_reset(void);
+SQLITE_API void sqlite3_awtk_stmt_prof_dump(int nTop);
+#endif /* SQLITE_AWTK_ENABLE_STMT_PROF */
+
+#ifdef SQLITE_AWTK_ENABLE_SLOW_LOG
+/*
+** Slow-query log (awtk_slow_log.h).
+**
+** sqlite3_awtk_slow_log_init(zPath, nThresholdMs, nMaxBytes, nPerMinute)
+** logs statements of attached connections that run nThresholdMs or longer:
+** expanded SQL, run time, the FULLSCAN_STEP, SORT, AUTOINDEX and VM_STEP
+** counters of the run and the EXPLAIN QUERY PLAN rows. Records go to zPath,
+** rotated to "zPath.1" past nMaxBytes (0: 64 KB), or to log_info() when
+** zPath is NULL. Past nPerMinute records a minute (0: no limit) slow
+** statements are only counted.
+*/
+typedef struct sqlite3_awtk_slow_log_stats sqlite3_awtk_slow_log_stats;
+struct sqlite3_awtk_slow_log_stats {
+  sqlite3_int64 nSlow;    /* Runs over the threshold */
+  sqlite3_int64 nLogged;  /* Records written */
+  sqlite3_int64 nDropped; /* Runs over the threshold not logged, rate limit */
+};
+
+SQLITE_API int sqlite3_awtk_slow_log_init(const char* zPath, int nThresholdMs, int nMaxBytes,
+                                          int nPerMinute);
+SQLITE_API void sqlite3_awtk_slow_log_deinit(void);
+SQLITE_API int sqlite3_awtk_slow_log_attach(sqlite3* db);
+SQLITE_API int sqlite3_awtk_slow_log_detach(sqlite3* db);
+SQLITE_API void sqlite3_awtk_slow_log_stats_get(sqlite3_awtk_slow_log_stats* pStats);
+#endif /* SQLITE_AWTK_ENABLE_SLOW_LOG */
+
+#ifdef SQLITE_ENABLE_STMT_SCANSTATUS
+/*
+** EXPLAIN ANALYZE (awtk_scanstatus.h), in builds with
+** SQLITE_ENABLE_STMT_SCANSTATUS such as the profiling profile.
+**
+** sqlite3_awtk_scanstatus_dump() logs each loop of a statement that has
+** run: the times it was started, the rows it visited, the rows the planner
+** expected and the plan line (table or index used).
+** sqlite3_awtk_explain_analyze() runs every statement of zSql, discarding
+** the rows, and dumps each one with its run time and row count.
+*/
+SQLITE_API void sqlite3_awtk_scanstatus_dump(sqlite3_stmt* pStmt);
+SQLITE_API int sqlite3_awtk_explain_analyze(sqlite3* db, const char* zSql);
+#endif /* SQLITE_ENABLE_STMT_SCANSTATUS */
+
+#ifdef SQLITE_AWTK_ENABLE_STATUS_LOG
+/*
+** Status log (awtk_status_log.h).
+**
+** sqlite3_awtk_status_log_init(zPath, nIntervalMs, nMaxBytes) appends one
+** CSV line per attached connection every nIntervalMs (0: on each
+** sqlite3_awtk_status_log_sample() call) to zPath, rotated to "zPath.1" past
+** nMaxBytes (0: 256 KB), or logs it with log_info() when zPath is NULL. The
+** sample keeps the global sqlite3_status64() values, the connection's
+** memory use and the cache and lookaside counters of the interval.
+** sqlite3_awtk_status_log_get() returns the last sample of a connection.
+*/
+typedef struct sqlite3_awtk_status_sample sqlite3_awtk_status_sample;
+struct sqlite3_awtk_status_sample {
+  sqlite3_int64 iTimeMs;            /* time_now_ms() of the sample */
+  sqlite3_int64 nIntervalMs;        /* Since the previous sample or the attach */
+  sqlite3_int64 nMemUsed;           /* SQLITE_STATUS_MEMORY_USED */
+  sqlite3_int64 mxMemUsed;          /* Its high-water mark */
+  sqlite3_int64 nPageCacheUsed;     /* SQLITE_STATUS_PAGECACHE_USED */
+  sqlite3_int64 nPageCacheOverflow; /* SQLITE_STATUS_PAGECACHE_OVERFLOW */
+  sqlite3_int64 nMallocCount;       /* SQLITE_STATUS_MALLOC_COUNT */
+  int nCacheUsed;                   /* SQLITE_DBSTATUS_CACHE_USED */
+  int nLookasideUsed;               /* SQLITE_DBSTATUS_LOOKASIDE_USED */
+  int nSchemaUsed;                  /* SQLITE_DBSTATUS_SCHEMA_USED */
+  int nStmtUsed;                    /* SQLITE_DBSTATUS_STMT_USED */
+  /* Counted over the interval */
+  int nCacheHit;
+  int nCacheMiss;
+  int nCacheWrite;
+  int nCacheSpill; /* Always 0 before SQLite 3.22 */
+  int nLookasideHit;
+  int nLookasideMiss;
+};
+
+SQLITE_API int sqlite3_awtk_status_log_init(const char* zPath, int nIntervalMs, int nMaxBytes);
+SQLITE_API void sqlite3_awtk_status_log_deinit(void);
+SQLITE_API int sqlite3_awtk_status_log_attach(sqlite3* db);
+SQLITE_API int sqlite3_awtk_status_log_detach(sqlite3* db);
+SQLITE_API void sqlite3_awtk_status_log_sample(void);
+SQLITE_API int sqlite3_awtk_status_log_get(sqlite3* db, sqlite3_awtk_status_sample* pSample);
+#endif /* SQLITE_AWTK_ENABLE_STATUS_LOG */
+
+#ifdef SQLITE_AWTK_ENABLE_COMMIT_TIMING
+/*
+** Commit timing (awtk_commit_timing.h).
+**
+** The awtk VFS splits the I/O time of every rollback-journal commit by
+** phase. sqlite3_awtk_commit_timing_get(iBack) returns the iBack-th most
+** recent commit (0: the last one), of the last 64 kept.
+** sqlite3_awtk_commit_timing_percentile(nPct) fills in the nPct percentile of
+** each phase over them and returns their number.
+*/
+#define SQLITE_AWTK_COMMIT_JOURNAL_WRITE 0
+#define SQLITE_AWTK_COMMIT_JOURNAL_HEADER 1
+#define SQLITE_AWTK_COMMIT_JOURNAL_SYNC 2
+#define SQLITE_AWTK_COMMIT_DB_WRITE 3
+#define SQLITE_AWTK_COMMIT_DB_SYNC 4
+#define SQLITE_AWTK_COMMIT_CLEANUP 5
+#define SQLITE_AWTK_COMMIT_TOTAL 6
+#define SQLITE_AWTK_COMMIT_N 7
+
+typedef struct sqlite3_awtk_commit_timing sqlite3_awtk_commit_timing;
+struct sqlite3_awtk_commit_timing {
+  sqlite3_int64 iEndMs;                    /* time_now_ms() when the lock was released */
+  int nJournalWrite;                       /* xWrite calls on the journal (3 per page) */
+  int nDbWrite;                            /* xWrite calls on the database (1 per page) */
+  sqlite3_int64 aUs[SQLITE_AWTK_COMMIT_N]; /* Time of each SQLITE_AWTK_COMMIT_xxx phase */
+};
+
+SQLITE_API int sqlite3_awtk_commit_timing_get(int iBack, sqlite3_awtk_commit_timing* pCommit);
+SQLITE_API int sqlite3_awtk_commit_timing_percentile(int nPct,
+                                                     sqlite3_awtk_commit_timing* pCommit);
+SQLITE_API void sqlite3_awtk_commit_timing_reset(void);
+SQLITE_API void sqlite3_awtk_commit_timing_dump(void);
+#endif /* SQLITE_AWTK_ENABLE_COMMIT_TIMING */
+
+#ifdef SQLITE_AWTK_ENABLE_CHROME_TRACE
+/*
+** Timeline tracer (awtk_chrome_trace.h).
+**
+** Between sqlite3_awtk_chrome_trace_start() and _stop() the port records
+** statements of attached connections, VFS reads, writes, syncs and lock
+** calls, busy-handler sleeps and contended mutex waits, per thread, with
+** time_now_us() timestamps. sqlite3_awtk_chrome_trace_event() adds a span of
+** the application (a UI frame, say). sqlite3_awtk_chrome_trace_dump() writes
+** the newest events of each thread to zPath in the Chrome trace event format
+** (chrome://tracing, ui.perfetto.dev). Needs the atomics of awtk_atomic.h.
+**
+** Each thread records into one of SQLITE_AWTK_CHROME_TRACE_THREADS rings;
+** a thread that has recorded calls sqlite3_awtk_chrome_trace_thread_end()
+** before it exits so the ring can be reused. Threads that found no free ring
+** are reported as "dropped_threads" (and their events as "dropped") in the
+** otherData of the dump.
+*/
+SQLITE_API void sqlite3_awtk_chrome_trace_start(void);
+SQLITE_API void sqlite3_awtk_chrome_trace_stop(void);
+SQLITE_API int sqlite3_awtk_chrome_trace_attach(sqlite3* db);
+SQLITE_API int sqlite3_awtk_chrome_trace_detach(sqlite3* db);
+SQLITE_API void sqlite3_awtk_chrome_trace_thread_end(void);
+SQLITE_API void sqlite3_awtk_chrome_trace_event(const char* zName, sqlite3_int64 iStartUs,
+                                                sqlite3_int64 nDurUs);
+SQLITE_API int sqlite3_awtk_chrome_trace_dump(const char* zPath);
+#endif /* SQLITE_AWTK_ENABLE_CHROME_TRACE */
+
+#ifdef __cplusplus
+} /* end of the 'extern "C"' block */
+#endif
+
+#endif /*_SQLITE3_AWTK_H_*/
@@ -3,6 +3,191 @@
 /*
 * SQLite compile macro
 */
+
+/*
+* Build profiles. Define one of SQLITE_AWTK_PROFILE_MCU_SMALL,
+* SQLITE_AWTK_PROFILE_EMBEDDED, SQLITE_AWTK_PROFILE_LINUX_THROUGHPUT or
+* SQLITE_AWTK_PROFILE_PROFILING, or build with scons
+* SQLITE_PROFILE=mcu-small|embedded-default|linux-throughput|profiling.
+* Without one the embedded profile is used. Every option below can still be
+* overridden with -D.
+*
+* mcu-small:        single core, well under 1 MB of RAM for SQLite.
+* embedded-default: Linux/RTOS boards with a few MB. Exactly the historical
+*                   configuration (SQLite's own defaults spelled out), so
+*                   behaviour changes such as LIKE not matching BLOBs only
+*                   come with the other profiles.
+* linux-throughput: multi-core Linux, connections pinned to threads.
+* profiling:        embedded-default plus the diagnostics of the port, for
+*                   field builds that look for slow queries and bad plans.
+*                   Code calling the diagnostics needs the same defines.
+*/
+#if defined(SQLITE_AWTK_PROFILE_PROFILING)
+
+#ifndef SQLITE_ENABLE_STMT_SCANSTATUS
+#define SQLITE_ENABLE_STMT_SCANSTATUS 1
+#endif
+
+#ifndef SQLITE_AWTK_ENABLE_STMT_PROF
+#define SQLITE_AWTK_ENABLE_STMT_PROF 1
+#endif
+
+#ifndef SQLITE_AWTK_ENABLE_SLOW_LOG
+#define SQLITE_AWTK_ENABLE_SLOW_LOG 1
+#endif
+
+#ifndef SQLITE_AWTK_ENABLE_BOOT_PROF
+#define SQLITE_AWTK_ENABLE_BOOT_PROF 1
+#endif
+
+#ifndef SQLITE_AWTK_ENABLE_STATUS_LOG
+#define SQLITE_AWTK_ENABLE_STATUS_LOG 1
+#endif
+
+#ifndef SQLITE_AWTK_ENABLE_COMMIT_TIMING
+#define SQLITE_AWTK_ENABLE_COMMIT_TIMING 1
+#endif
+
+#ifndef SQLITE_AWTK_ENABLE_CHROME_TRACE
+#define SQLITE_AWTK_ENABLE_CHROME_TRACE 1
+#endif
+
+#endif /* SQLITE_AWTK_PROFILE_PROFILING */
+
+#if defined(SQLITE_AWTK_PROFILE_MCU_SMALL)
+
+#ifndef SQLITE_DEFAULT_MEMSTATUS
+#define SQLITE_DEFAULT_MEMSTATUS 0
+#endif
+
+#ifndef SQLITE_DEFAULT_PAGE_SIZE
+#define SQLITE_DEFAULT_PAGE_SIZE 1024
+#endif
+
+/* 64 KB of page cache */
+#ifndef SQLITE_DEFAULT_CACHE_SIZE
+#define SQLITE_DEFAULT_CACHE_SIZE -64
+#endif
+
+#ifndef SQLITE_DEFAULT_LOOKASIDE
+#define SQLITE_DEFAULT_LOOKASIDE 64, 32
+#endif
+
+#ifndef SQLITE_MAX_WORKER_THREADS
+#define SQLITE_MAX_WORKER_THREADS 0
+#endif
+
+/* one core: spinning only delays the thread that holds the lock */
+#ifndef SQLITE_AWTK_MUTEX_SPIN
+#define SQLITE_AWTK_MUTEX_SPIN 0
+#endif
+
+#ifndef SQLITE_LIKE_DOESNT_MATCH_BLOBS
+#define SQLITE_LIKE_DOESNT_MATCH_BLOBS 1
+#endif
+
+/* 0 would drop the check, and a deeply nested expression could overflow a small stack */
+#ifndef SQLITE_MAX_EXPR_DEPTH
+#define SQLITE_MAX_EXPR_DEPTH 100
+#endif
+
+/* statement cache (awtk_stmt_cache.h): 8 statements for 2 connections */
+#ifndef SQLITE_AWTK_STMT_CACHE_MAX
+#define SQLITE_AWTK_STMT_CACHE_MAX 8
+#endif
+
+#ifndef SQLITE_AWTK_STMT_CACHE_MAX_DB
+#define SQLITE_AWTK_STMT_CACHE_MAX_DB 2
+#endif
+
+/* trace multiplexer (awtk_trace.h), always compiled for the statement cache */
+#ifndef SQLITE_AWTK_TRACE_MAX_DB
+#define SQLITE_AWTK_TRACE_MAX_DB 2
+#endif
+
+#ifndef SQLITE_OMIT_DEPRECATED
+#define SQLITE_OMIT_DEPRECATED 1
+#endif
+
+#ifndef SQLITE_OMIT_SHARED_CACHE
+#define SQLITE_OMIT_SHARED_CACHE 1
+#endif
+
+#ifndef SQLITE_OMIT_PROGRESS_CALLBACK
+#define SQLITE_OMIT_PROGRESS_CALLBACK 1
+#endif
+
+#ifndef SQLITE_OMIT_DECLTYPE
+#define SQLITE_OMIT_DECLTYPE 1
+#endif
+
+#elif defined(SQLITE_AWTK_PROFILE_LINUX_THROUGHPUT)
+
+#ifndef SQLITE_DEFAULT_MEMSTATUS
+#define SQLITE_DEFAULT_MEMSTATUS 0
+#endif
+
+#ifndef SQLITE_DEFAULT_PAGE_SIZE
+#define SQLITE_DEFAULT_PAGE_SIZE 4096
+#endif
+
+/* 8 MB of page cache */
+#ifndef SQLITE_DEFAULT_CACHE_SIZE
+#define SQLITE_DEFAULT_CACHE_SIZE -8000
+#endif
+
+#ifndef SQLITE_MAX_WORKER_THREADS
+#define SQLITE_MAX_WORKER_THREADS 8
+#endif
+
+#ifndef SQLITE_DEFAULT_WORKER_THREADS
+#define SQLITE_DEFAULT_WORKER_THREADS 4
+#endif
+
+#ifndef SQLITE_TEMP_STORE
+#define SQLITE_TEMP_STORE 2
+#endif
+
+#ifndef SQLITE_LIKE_DOESNT_MATCH_BLOBS
+#define SQLITE_LIKE_DOESNT_MATCH_BLOBS 1
+#endif
+
+#ifndef SQLITE_USE_ALLOCA
+#define SQLITE_USE_ALLOCA 1
+#endif
+
+#ifndef SQLITE_AWTK_MULTI_THREAD
+#define SQLITE_AWTK_MULTI_THREAD 1
+#endif
+
+#ifndef SQLITE_OMIT_DEPRECATED
+#define SQLITE_OMIT_DEPRECATED 1
+#endif
+
+#ifndef SQLITE_OMIT_SHARED_CACHE
+#define SQLITE_OMIT_SHARED_CACHE 1
+#endif
+
+#else /* SQLITE_AWTK_PROFILE_EMBEDDED, SQLITE_AWTK_PROFILE_PROFILING */
+
+#ifndef SQLITE_DEFAULT_PAGE_SIZE
+#define SQLITE_DEFAULT_PAGE_SIZE 4096
+#endif
+
+/* 2 MB of page cache, SQLite's own default */
+#ifndef SQLITE_DEFAULT_CACHE_SIZE
+#define SQLITE_DEFAULT_CACHE_SIZE -2000
+#endif
+
+#ifndef SQLITE_MAX_WORKER_THREADS
+#define SQLITE_MAX_WORKER_THREADS 8
+#endif
+
+#ifndef SQLITE_DEFAULT_WORKER_THREADS
+#define SQLITE_DEFAULT_WORKER_THREADS 0
+#endif
+
+#endif /* SQLITE_AWTK_PROFILE_xxx */
 #ifndef SQLITE_MINIMUM_FILE_DESCRIPTOR
 #define SQLITE_MINIMUM_FILE_DESCRIPTOR 0
 #endif
@@ -21,6 +206,19 @@
 #define SQLITE_TEMP_STORE 1
 #endif
 
+/*
+* SQLITE_AWTK_MULTI_THREAD: every connection stays on the thread that opened
+* it (see sqlite3_awtk_thread_db()), so SQLite can skip the per-connection
+* mutex on each API call. Core mutexes (memory, page cache, VFS) are kept.
+*/
+#if defined(SQLITE_AWTK_MULTI_THREAD) && !defined(SQLITE_THREADSAFE)
+#define SQLITE_THREADSAFE 2
+#endif
+
+#if defined(SQLITE_AWTK_MULTI_THREAD) && !defined(SQLITE_AWTK_ENABLE_THREAD_DB)
+#define SQLITE_AWTK_ENABLE_THREAD_DB 1
+#endif
+
 #ifndef SQLITE_THREADSAFE
 #define SQLITE_THREADSAFE 1
 #endif